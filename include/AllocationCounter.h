@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdlib>
+
+// Heap allocations made by the calling thread. main.cpp replaces the global operator new in debug
+// builds to count them, and Dear ImGUI allocates through imguiAlloc(), so growth of its buffers
+// is counted too. The main loop compares the count before and after a frame.
+namespace AllocationCounter {
+	inline unsigned long long& threadCount() {
+		static thread_local unsigned long long count = 0;
+		return count;
+	}
+
+	inline void add() {
+		threadCount()++;
+	}
+
+	inline unsigned long long get() {
+		return threadCount();
+	}
+
+	// For ImGui::SetAllocatorFunctions(). Only counts: ImGui's windows and buffers live across
+	// frames, so they can't come from the frame arena.
+	inline void* imguiAlloc(size_t size, void* userData) {
+		add();
+		return malloc(size);
+	}
+
+	inline void imguiFree(void* pointer, void* userData) {
+		free(pointer);
+	}
+}
\ No newline at end of file
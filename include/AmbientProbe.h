@@ -0,0 +1,174 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <Light.h>
+#include <vector>
+#include <cmath>
+
+// L2 spherical harmonics irradiance probe at the center of the model that stands in for the light
+// bounced around the scene. Every light is projected once into 9 coefficients and cached; update()
+// only re-projects lights that changed and uploads the sum to a uniform buffer when anything did.
+// main.fs reads it through the AmbientProbe block at binding 0.
+class AmbientProbe {
+private:
+	struct Coefficients {
+		glm::vec3 values[9];
+	};
+
+	std::vector<PointLight> pointLights;
+	std::vector<Coefficients> pointCoefficients;
+	std::vector<SpotLight> spotlights;
+	std::vector<Coefficients> spotCoefficients;
+	DirectionalLight dirLight;
+	Coefficients dirCoefficients;
+	bool hasDirLight = false;
+	glm::vec3 position = glm::vec3(0.0f);
+	float strength = -1.0f;
+	glm::vec3 total[9];
+	unsigned int ubo = 0;
+
+	// Light of the given color arriving from direction, plus a share of it scattered evenly in all
+	// directions so surfaces facing away from every light still get some fill. Already convolved
+	// with the cosine lobe and divided by pi.
+	Coefficients project(const glm::vec3& direction, const glm::vec3& color) {
+		const float band[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+		const float uniformShare = 0.25f;
+		glm::vec3 d = glm::length(direction) > 0.0f ? glm::normalize(direction) : glm::vec3(0.0f, 1.0f, 0.0f);
+		float basis[9] = {
+			0.282095f,
+			0.488603f * d.y,
+			0.488603f * d.z,
+			0.488603f * d.x,
+			1.092548f * d.x * d.y,
+			1.092548f * d.y * d.z,
+			0.315392f * (3.0f * d.z * d.z - 1.0f),
+			1.092548f * d.x * d.z,
+			0.546274f * (d.x * d.x - d.y * d.y)
+		};
+		Coefficients result;
+		for (int k = 0; k < 9; k++) {
+			result.values[k] = color * this->strength * basis[k] * band[k];
+		}
+		// A uniform sphere with the same total flux only has a constant term
+		result.values[0] += color * this->strength * uniformShare * 0.282095f;
+		return result;
+	}
+
+	Coefficients projectPointLight(const PointLight& light) {
+		glm::vec3 toLight = light.position - this->position;
+		float distance = glm::length(toLight);
+		float attenuation = 1.0f / (light.attConstant + light.attLinear * distance + light.attQuadratic * distance * distance);
+		return project(toLight, light.color * attenuation);
+	}
+
+	// Same cone falloff as main.fs, evaluated at the probe
+	Coefficients projectSpotLight(const SpotLight& light) {
+		glm::vec3 toLight = light.position - this->position;
+		float theta = glm::dot(glm::normalize(toLight), glm::normalize(-light.direction));
+		float epsilon = light.cosineInnerCutoff - light.cosineOuterCutoff;
+		float intensity = epsilon != 0.0f ? glm::clamp((theta - light.cosineOuterCutoff) / epsilon, 0.0f, 1.0f) : 0.0f;
+		return project(toLight, light.color * intensity);
+	}
+
+	Coefficients projectDirLight(const DirectionalLight& light) {
+		return project(-light.direction, light.color);
+	}
+
+public:
+	// Without a GL context the probe only keeps its coefficients on the CPU (see getCoefficients())
+	AmbientProbe(bool uploadToGpu = true) {
+		glm::vec4 zero[9];
+		for (int k = 0; k < 9; k++) {
+			zero[k] = glm::vec4(0.0f);
+			this->total[k] = glm::vec3(0.0f);
+		}
+		if (!uploadToGpu) {
+			return;
+		}
+		glGenBuffers(1, &this->ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(zero), zero, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// Re-projects the lights that changed since the last call. Moving the probe or changing the
+	// strength invalidates every light. Returns whether the probe changed.
+	bool update(const std::vector<PointLight>& pointLights, const DirectionalLight& dirLight, const std::vector<SpotLight>& spotlights, const glm::vec3& position, float strength) {
+		bool changed = false;
+		if (position != this->position || strength != this->strength) {
+			this->position = position;
+			this->strength = strength;
+			this->pointLights.clear();
+			this->spotlights.clear();
+			this->hasDirLight = false;
+		}
+
+		bool pointsResized = this->pointLights.size() != pointLights.size();
+		if (pointsResized) {
+			this->pointLights.resize(pointLights.size());
+			this->pointCoefficients.resize(pointLights.size());
+			changed = true;
+		}
+		for (int i = 0; i < pointLights.size(); i++) {
+			if (pointsResized || !(this->pointLights[i] == pointLights[i])) {
+				this->pointLights[i] = pointLights[i];
+				this->pointCoefficients[i] = projectPointLight(pointLights[i]);
+				changed = true;
+			}
+		}
+		bool spotsResized = this->spotlights.size() != spotlights.size();
+		if (spotsResized) {
+			this->spotlights.resize(spotlights.size());
+			this->spotCoefficients.resize(spotlights.size());
+			changed = true;
+		}
+		for (int i = 0; i < spotlights.size(); i++) {
+			if (spotsResized || !(this->spotlights[i] == spotlights[i])) {
+				this->spotlights[i] = spotlights[i];
+				this->spotCoefficients[i] = projectSpotLight(spotlights[i]);
+				changed = true;
+			}
+		}
+		if (!this->hasDirLight || this->dirLight.direction != dirLight.direction || this->dirLight.color != dirLight.color) {
+			this->dirLight = dirLight;
+			this->dirCoefficients = projectDirLight(dirLight);
+			this->hasDirLight = true;
+			changed = true;
+		}
+		if (!changed) {
+			return false;
+		}
+
+		// Re-summing the cached projections is cheap and avoids drift from subtracting old values
+		glm::vec4 padded[9];
+		for (int k = 0; k < 9; k++) {
+			glm::vec3 sum = this->dirCoefficients.values[k];
+			for (int i = 0; i < this->pointCoefficients.size(); i++) {
+				sum += this->pointCoefficients[i].values[k];
+			}
+			for (int i = 0; i < this->spotCoefficients.size(); i++) {
+				sum += this->spotCoefficients[i].values[k];
+			}
+			this->total[k] = sum;
+			// std140 pads vec3 array elements to 16 bytes
+			padded[k] = glm::vec4(sum, 0.0f);
+		}
+		if (this->ubo != 0) {
+			glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(padded), padded);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		return true;
+	}
+
+	void bind() {
+		glBindBufferBase(GL_UNIFORM_BUFFER, 0, this->ubo);
+	}
+
+	// The 9 summed irradiance coefficients, as main.fs sees them in probeSH
+	const glm::vec3* getCoefficients() const {
+		return this->total;
+	}
+};
\ No newline at end of file
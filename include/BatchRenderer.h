@@ -0,0 +1,275 @@
+#pragma once
+
+#include <SoftwareRenderer.h>
+#include <PathTracer.h>
+#include <ImageWriter.h>
+#include <BoundedQueue.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+
+// One line of the batch list: a model and optionally its 5 maps in the order of textureNames
+struct BatchAsset {
+	std::string modelPath;
+	std::string texturePaths[5];
+};
+
+// Renders turntables of many assets without a window:
+//	3DModelViewer --batch <list.txt> <output directory> [--views <count>] [--size <width>x<height>]
+//		[--environment <hdr>] [--threads <count>] [--writers <count>] [--samples <count>]
+// Each line of the list is "<model> [<albedo> <normal> <metallic> <roughness> <ao>]", assets without
+// textures use the stone material. Images are written to <output directory>/<model name>_<view>.png,
+// the directory must exist. Every asset is framed by its bounding sphere and rotated about the
+// vertical axis in <count> steps under the default lights. The work is pipelined in three stages so
+// that the next asset is imported and the previous one is encoded while the current one renders:
+//	- A loader thread imports models and textures while the renderer works, keeping one imported
+//	  asset ready.
+//	- The calling thread renders every view with SoftwareRenderer, or PathTracer with --samples.
+//	- A pool of writer threads encodes the PNGs (and Radiance .hdr files when path tracing).
+class BatchRenderer {
+private:
+	struct LoadedAsset {
+		size_t index;
+		std::unique_ptr<Model> model;
+		std::vector<SoftwareTexture> textures;
+	};
+
+	struct EncodeJob {
+		std::string path;
+		int width, height;
+		std::vector<unsigned char> rgba;
+		std::vector<glm::vec3> hdr;
+	};
+
+	std::vector<BatchAsset> assets;
+	std::string outputDirectory;
+	int width = 512, height = 512;
+	unsigned int views = 8;
+	unsigned int threadCount = 0;
+	unsigned int writerCount = 2;
+	unsigned int sampleCount = 0;
+	std::unique_ptr<Environment> environment;
+
+	// Busy time of every stage in milliseconds, to see which one limits the throughput
+	double loadTime = 0.0, renderTime = 0.0, encodeTime = 0.0;
+	std::mutex encodeTimeMutex;
+
+	static std::string fileStem(const std::string& path) {
+		size_t slash = path.find_last_of("/\\");
+		std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+		size_t dot = name.find_last_of('.');
+		return dot == std::string::npos ? name : name.substr(0, dot);
+	}
+
+	bool readList(const char* listPath) {
+		std::ifstream file(listPath);
+		if (!file) {
+			std::cout << "Failed to open " << listPath << std::endl;
+			return false;
+		}
+		std::string line;
+		while (std::getline(file, line)) {
+			std::istringstream words(line);
+			BatchAsset asset;
+			if (!(words >> asset.modelPath) || asset.modelPath[0] == '#') {
+				continue;
+			}
+			const char* stone[5] = {
+				"assets/stone/stone-albedo.png",
+				"assets/stone/stone-normal.png",
+				"assets/stone/stone-metalness.png",
+				"assets/stone/stone-rough.png",
+				"assets/stone/stone-ao.png"
+			};
+			for (int i = 0; i < 5; i++) {
+				if (!(words >> asset.texturePaths[i])) {
+					asset.texturePaths[i] = stone[i];
+				}
+			}
+			this->assets.push_back(asset);
+		}
+		return true;
+	}
+
+	void load(BoundedQueue<std::unique_ptr<LoadedAsset>>& loaded) {
+		for (size_t i = 0; i < this->assets.size(); i++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::unique_ptr<LoadedAsset> asset(new LoadedAsset());
+			asset->index = i;
+			asset->model.reset(new Model(this->assets[i].modelPath.c_str(), false, false));
+			for (int t = 0; t < 5; t++) {
+				asset->textures.push_back(SoftwareTexture(this->assets[i].texturePaths[t].c_str()));
+			}
+			this->loadTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			loaded.push(std::move(asset));
+		}
+		loaded.close();
+	}
+
+	void encode(BoundedQueue<EncodeJob>& jobs) {
+		EncodeJob job;
+		while (jobs.pop(job)) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::string pngPath = job.path + ".png";
+			bool written = ImageWriter::writePng(pngPath.c_str(), job.rgba.data(), job.width, job.height);
+			if (!job.hdr.empty()) {
+				std::string hdrPath = job.path + ".hdr";
+				written = ImageWriter::writeHdr(hdrPath.c_str(), &job.hdr[0].x, job.width, job.height) && written;
+			}
+			if (!written) {
+				std::cout << "Failed to write " << job.path << std::endl;
+			}
+			std::lock_guard<std::mutex> lock(this->encodeTimeMutex);
+			this->encodeTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	void render(LoadedAsset& asset, SoftwareRenderer& renderer, PathTracer& pathTracer, BoundedQueue<EncodeJob>& jobs) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Model& model = *asset.model;
+		glm::vec4 sphere = model.getBoundingSphere(glm::mat4(1.0f));
+		glm::vec3 center = glm::vec3(sphere);
+		float radius = std::max(sphere.w, 1e-3f);
+
+		// Fit the bounding sphere into the narrower field of view, with a small margin
+		float fov = glm::radians(45.0f);
+		float aspect = (float)this->width / this->height;
+		float narrowest = aspect < 1.0f ? 2.0f * std::atan(std::tan(fov * 0.5f) * aspect) : fov;
+		float distance = radius * 1.1f / std::sin(narrowest * 0.5f);
+		glm::vec3 cameraPosition = center + glm::vec3(0.0f, 0.0f, distance);
+		glm::mat4 viewMatrix = glm::lookAt(cameraPosition, center, glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projectionMatrix = glm::perspective(fov, aspect, std::max(distance - radius * 1.5f, distance * 0.01f), distance + radius * 1.5f);
+		Camera camera = Camera{ viewMatrix, projectionMatrix, cameraPosition, (float)this->height };
+
+		std::vector<PointLight> pointLights;
+		DirectionalLight dirLight;
+		std::vector<SpotLight> spotlights;
+		createDefaultLights(pointLights, dirLight, spotlights);
+		AmbientProbe ambientProbe = AmbientProbe(false);
+		ambientProbe.update(pointLights, dirLight, spotlights, center, 0.02f);
+
+		std::string basePath = this->outputDirectory + "/" + fileStem(this->assets[asset.index].modelPath);
+		for (unsigned int view = 0; view < this->views; view++) {
+			float angle = glm::two_pi<float>() * view / this->views;
+			glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), center) * glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), -center);
+
+			EncodeJob job;
+			char suffix[16];
+			snprintf(suffix, sizeof(suffix), "_%03u", view);
+			job.path = basePath + suffix;
+			job.width = this->width;
+			job.height = this->height;
+			if (this->sampleCount > 0) {
+				pathTracer.setScene(model, modelMatrix, camera, asset.textures.data(), pointLights, dirLight, spotlights, this->environment.get());
+				pathTracer.addSamples(this->sampleCount);
+				job.rgba = pathTracer.getToneMappedImage();
+				job.hdr = pathTracer.getHdrImage();
+			}
+			else {
+				renderer.render(model, modelMatrix, camera, asset.textures.data(), pointLights, dirLight, spotlights, ambientProbe, this->environment.get());
+				job.rgba = renderer.getImage();
+			}
+			jobs.push(std::move(job));
+		}
+		this->renderTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+public:
+	// Returns false and prints the usage when the arguments can't be parsed
+	bool parseArguments(int argc, char** argv) {
+		if (argc < 4) {
+			std::cout << "Usage: " << argv[0] << " --batch <list.txt> <output directory> [--views <count>] [--size <width>x<height>] [--environment <hdr>] [--threads <count>] [--writers <count>] [--samples <count>]" << std::endl;
+			return false;
+		}
+		this->outputDirectory = argv[3];
+		const char* environmentPath = NULL;
+		for (int i = 4; i < argc; i += 2) {
+			if (i + 1 >= argc) {
+				std::cout << "Missing value for " << argv[i] << std::endl;
+				return false;
+			}
+			if (strcmp(argv[i], "--views") == 0) {
+				this->views = (unsigned int)std::max(atoi(argv[i + 1]), 1);
+			}
+			else if (strcmp(argv[i], "--size") == 0) {
+				sscanf(argv[i + 1], "%dx%d", &this->width, &this->height);
+			}
+			else if (strcmp(argv[i], "--environment") == 0) {
+				environmentPath = argv[i + 1];
+			}
+			else if (strcmp(argv[i], "--threads") == 0) {
+				this->threadCount = (unsigned int)atoi(argv[i + 1]);
+			}
+			else if (strcmp(argv[i], "--writers") == 0) {
+				this->writerCount = (unsigned int)std::max(atoi(argv[i + 1]), 1);
+			}
+			else if (strcmp(argv[i], "--samples") == 0) {
+				this->sampleCount = (unsigned int)std::max(atoi(argv[i + 1]), 0);
+			}
+			else {
+				std::cout << "Unknown option " << argv[i] << std::endl;
+				return false;
+			}
+		}
+		if (environmentPath) {
+			this->environment.reset(new Environment(environmentPath));
+		}
+		return readList(argv[2]);
+	}
+
+	void run() {
+		SoftwareRenderer renderer = SoftwareRenderer(this->width, this->height, this->threadCount);
+		this->width = renderer.getWidth();
+		this->height = renderer.getHeight();
+		PathTracer pathTracer = PathTracer(this->sampleCount > 0 ? this->width : 1, this->sampleCount > 0 ? this->height : 1, this->threadCount);
+
+		// One imported asset waits in the queue while the loader works on the next
+		BoundedQueue<std::unique_ptr<LoadedAsset>> loaded(1);
+		// Enough room for every view of one asset, so rendering only stalls when encoding falls behind
+		BoundedQueue<EncodeJob> jobs(this->views);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::thread loader = std::thread(&BatchRenderer::load, this, std::ref(loaded));
+		std::vector<std::thread> writers;
+		for (unsigned int i = 0; i < this->writerCount; i++) {
+			writers.push_back(std::thread(&BatchRenderer::encode, this, std::ref(jobs)));
+		}
+
+		std::unique_ptr<LoadedAsset> asset;
+		size_t rendered = 0;
+		while (loaded.pop(asset)) {
+			render(*asset, renderer, pathTracer, jobs);
+			rendered++;
+			std::cout << "Rendered " << this->assets[asset->index].modelPath << " (" << rendered << "/" << this->assets.size() << ")" << std::endl;
+			asset.reset();
+		}
+		jobs.close();
+		loader.join();
+		for (size_t i = 0; i < writers.size(); i++) {
+			writers[i].join();
+		}
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Batch: " << rendered << " assets, " << rendered * this->views << " views of " << this->width << "x" << this->height << " in " << elapsed << " s, "
+			<< (elapsed > 0.0 ? rendered * 60.0 / elapsed : 0.0) << " assets/minute" << std::endl;
+		std::cout << "	Import: " << this->loadTime / 1000.0 << " s, render: " << this->renderTime / 1000.0 << " s, encode: " << this->encodeTime / 1000.0
+			<< " s over " << this->writerCount << " writers" << std::endl;
+	}
+};
+
+int renderBatch(int argc, char** argv) {
+	BatchRenderer batch;
+	if (!batch.parseArguments(argc, argv)) {
+		return 1;
+	}
+	batch.run();
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <imgui.h>
+#include <imgui_internal.h>
+#include <JobSystem.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <future>
+#include <thread>
+#include <cmath>
+
+// Micro-benchmarks of hot paths, without a window:
+//	3DModelViewer --benchmark <name>
+// Each one times the current code against the implementation it replaced and prints both.
+namespace Benchmarks {
+	// Runs work repeatedly for at least minimumTime seconds, returns the best nanoseconds per call.
+	// The best of several rounds hides interruptions by the OS.
+	template<typename Work>
+	double timeCall(Work work, double minimumTime = 0.2) {
+		double best = 1e30;
+		for (int round = 0; round < 5; round++) {
+			size_t calls = 0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			double elapsed = 0.0;
+			do {
+				for (int i = 0; i < 64; i++) {
+					work();
+				}
+				calls += 64;
+				elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			} while (elapsed < minimumTime / 5);
+			best = std::min(best, elapsed * 1e9 / calls);
+		}
+		return best;
+	}
+
+	// The byte at a time CRC32 that ImHashStr used before CRC32C, for comparison
+	struct TableCrc32 {
+		ImU32 table[256];
+
+		TableCrc32() {
+			for (ImU32 i = 0; i < 256; i++) {
+				ImU32 crc = i;
+				for (int bit = 0; bit < 8; bit++) {
+					crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+				}
+				this->table[i] = crc;
+			}
+		}
+
+		ImU32 hashData(const void* data, size_t size, ImU32 seed) const {
+			ImU32 crc = ~seed;
+			const unsigned char* bytes = (const unsigned char*)data;
+			while (size-- != 0) {
+				crc = (crc >> 8) ^ this->table[(crc & 0xFF) ^ *bytes++];
+			}
+			return ~crc;
+		}
+
+		ImU32 hashStr(const char* data, ImU32 seed) const {
+			seed = ~seed;
+			ImU32 crc = seed;
+			const unsigned char* bytes = (const unsigned char*)data;
+			while (unsigned char c = *bytes++) {
+				if (c == '#' && bytes[0] == '#' && bytes[1] == '#') {
+					crc = seed;
+				}
+				crc = (crc >> 8) ^ this->table[(crc & 0xFF) ^ c];
+			}
+			return ~crc;
+		}
+	};
+
+	// The IDs of one frame of the light editors: every widget hashes its label on top of the ID
+	// stack, every light pushes its index
+	int hashing() {
+		const char* labels[] = { "x", "y", "z", "r", "g", "b", "attConstant", "attLinear", "attQuadratic", "cutOff", "outerCutOff",
+			"Position", "Color", "Attenuation", "Remove", "##PointLightProperties", "Light Settings###LightEditor" };
+		const int labelCount = sizeof(labels) / sizeof(labels[0]);
+		const int lightCount = 32;
+		ImU32 windowId = ImHashStr("Point Light Editor");
+
+		TableCrc32 crc32 = TableCrc32();
+		volatile ImU32 sink = 0;
+		double before = timeCall([&]() {
+			ImU32 result = 0;
+			for (int light = 0; light < lightCount; light++) {
+				ImU32 lightId = crc32.hashData(&light, sizeof(light), windowId);
+				for (int i = 0; i < labelCount; i++) {
+					result ^= crc32.hashStr(labels[i], lightId);
+				}
+			}
+			sink = result;
+		});
+		double after = timeCall([&]() {
+			ImU32 result = 0;
+			for (int light = 0; light < lightCount; light++) {
+				ImU32 lightId = ImHashData(&light, sizeof(light), windowId);
+				for (int i = 0; i < labelCount; i++) {
+					result ^= ImHashStr(labels[i], 0, lightId);
+				}
+			}
+			sink = result;
+		});
+		const int widgetCount = lightCount * labelCount;
+		std::cout << "ID hashing, " << widgetCount << " widgets per frame, CRC32C " << (ImHashIsHardwareAccelerated() ? "with SSE4.2" : "with slice-by-8") << std::endl;
+		std::cout << "	Table CRC32: " << before / widgetCount << " ns/widget" << std::endl;
+		std::cout << "	CRC32C: " << after / widgetCount << " ns/widget, " << before / after << "x" << std::endl;
+
+		// Long labels are where whole words pay off
+		std::string longLabel = "Specular intensity of the selected point light##PointLightProperties";
+		before = timeCall([&]() {
+			sink = crc32.hashStr(longLabel.c_str(), windowId);
+		});
+		after = timeCall([&]() {
+			sink = ImHashStr(longLabel.c_str(), 0, windowId);
+		});
+		std::cout << "	" << longLabel.size() << " character label: " << before << " ns before, " << after << " ns after, " << before / after << "x" << std::endl;
+		return 0;
+	}
+
+	// Text of a property panel at the viewer's font scale, through ImFont::RenderText() with and
+	// without the ASCII fast path
+	int text() {
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO();
+		unsigned char* pixels;
+		int atlasWidth, atlasHeight;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &atlasWidth, &atlasHeight);
+		ImFont* font = io.Fonts->Fonts[0];
+		const float size = font->FontSize * 1.8f;
+
+		// Some lines are wider than the panel, as values often are
+		std::string panel;
+		const char* names[] = { "Position", "Color", "attConstant", "attLinear", "attQuadratic", "cutOff", "outerCutOff", "Intensity" };
+		for (int light = 0; light < 16; light++) {
+			for (int i = 0; i < 8; i++) {
+				char line[128];
+				snprintf(line, sizeof(line), "Point Light %d  %s: %.6f, %.6f, %.6f\n", light + 1, names[i], light * 0.37f, i * 1.25f, -0.5f * light);
+				panel += line;
+			}
+		}
+		const ImVec4 clipRect = ImVec4(0.0f, 0.0f, 420.0f, 4096.0f);
+
+		ImDrawList drawList = ImDrawList(ImGui::GetDrawListSharedData());
+		volatile int sink = 0;
+		auto render = [&]() {
+			drawList.Clear();
+			drawList.PushClipRect(ImVec2(clipRect.x, clipRect.y), ImVec2(clipRect.z, clipRect.w));
+			drawList.PushTextureID(io.Fonts->TexID);
+			font->RenderText(&drawList, size, ImVec2(8.0f, 8.0f), IM_COL32_WHITE, clipRect, panel.c_str(), panel.c_str() + panel.size(), 0.0f, false);
+			sink = drawList.VtxBuffer.Size;
+		};
+
+		ImFontSetAsciiFastPath(false);
+		render();
+		std::vector<ImDrawVert> scalarVertices(drawList.VtxBuffer.begin(), drawList.VtxBuffer.end());
+		double before = timeCall(render);
+		ImFontSetAsciiFastPath(true);
+		render();
+		bool identical = drawList.VtxBuffer.Size == (int)scalarVertices.size() && memcmp(drawList.VtxBuffer.Data, scalarVertices.data(), scalarVertices.size() * sizeof(ImDrawVert)) == 0;
+		double after = timeCall(render);
+
+		size_t vertexCount = scalarVertices.size();
+		std::cout << "Text, " << panel.size() << " characters, " << vertexCount << " vertices at " << size << " px" << (identical ? "" : ", VERTICES DIFFER") << std::endl;
+		std::cout << "	General path: " << vertexCount * 1e3 / before << " million vertices/s" << std::endl;
+		std::cout << "	ASCII fast path: " << vertexCount * 1e3 / after << " million vertices/s, " << before / after << "x" << std::endl;
+		ImGui::DestroyContext();
+		return identical ? 0 : 1;
+	}
+
+	// One frame of a layout with many light editors, with every window's lines and fills
+	// tessellated while its widgets are built, then recorded and tessellated after Render() on
+	// worker threads
+	int tessellation() {
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO();
+		io.DisplaySize = ImVec2(3840.0f, 2160.0f);
+		io.DeltaTime = 1.0f / 60.0f;
+		io.IniFilename = NULL;
+		unsigned char* pixels;
+		int atlasWidth, atlasHeight;
+		io.Fonts->GetTexDataAsAlpha8(&pixels, &atlasWidth, &atlasHeight);
+		ImGuiStyle& style = ImGui::GetStyle();
+		style.FrameRounding = 4.0f;
+		style.GrabRounding = 4.0f;
+		style.FrameBorderSize = 1.0f;
+
+		const int windowCount = 24;
+		float values[windowCount][9] = {};
+		bool enabled[windowCount] = {};
+		auto frame = [&]() {
+			ImGui::NewFrame();
+			for (int w = 0; w < windowCount; w++) {
+				char title[32];
+				snprintf(title, sizeof(title), "Point Light %d", w + 1);
+				ImGui::SetNextWindowPos(ImVec2((float)(w % 8) * 470.0f, (float)(w / 8) * 700.0f));
+				ImGui::Begin(title, NULL, ImGuiWindowFlags_AlwaysAutoResize);
+				ImGui::Checkbox("Enabled", &enabled[w]);
+				ImGui::SliderFloat3("Position", values[w], -10.0f, 10.0f);
+				ImGui::ColorEdit3("Color", values[w] + 3);
+				if (ImGui::CollapsingHeader("Attenuation", ImGuiTreeNodeFlags_DefaultOpen)) {
+					ImGui::SliderFloat("attConstant", &values[w][6], 0.0f, 1.0f);
+					ImGui::SliderFloat("attLinear", &values[w][7], 0.0f, 1.0f);
+					ImGui::SliderFloat("attQuadratic", &values[w][8], 0.0f, 1.0f);
+				}
+				for (int i = 0; i < 4; i++) {
+					ImGui::RadioButton("Point", i == 0);
+					ImGui::SameLine();
+				}
+				ImGui::NewLine();
+				ImGui::Button("Remove");
+				ImGui::End();
+			}
+			ImGui::Render();
+		};
+		// Windows measure their contents over the first frames
+		for (int i = 0; i < 3; i++) {
+			frame();
+		}
+
+		auto copyDrawData = [](std::vector<ImDrawVert>& vertices, std::vector<ImDrawIdx>& indices) {
+			ImDrawData* drawData = ImGui::GetDrawData();
+			vertices.clear();
+			indices.clear();
+			for (int n = 0; n < drawData->CmdListsCount; n++) {
+				const ImDrawList* list = drawData->CmdLists[n];
+				vertices.insert(vertices.end(), list->VtxBuffer.begin(), list->VtxBuffer.end());
+				indices.insert(indices.end(), list->IdxBuffer.begin(), list->IdxBuffer.end());
+			}
+		};
+		std::vector<ImDrawVert> serialVertices, deferredVertices;
+		std::vector<ImDrawIdx> serialIndices, deferredIndices;
+		frame();
+		copyDrawData(serialVertices, serialIndices);
+		double before = timeCall(frame, 1.0);
+
+		JobSystem jobs(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+		io.ConfigDeferTessellation = true;
+		ImDrawData* drawData = ImGui::GetDrawData();
+		auto tessellate = [&]() {
+			jobs.parallelFor(drawData->CmdListsCount, 1, [&](size_t i) {
+				drawData->CmdLists[i]->TessellateDeferred();
+			});
+		};
+		frame();
+		tessellate();
+		copyDrawData(deferredVertices, deferredIndices);
+		bool identical = serialVertices.size() == deferredVertices.size() && serialIndices.size() == deferredIndices.size()
+			&& memcmp(serialVertices.data(), deferredVertices.data(), serialVertices.size() * sizeof(ImDrawVert)) == 0
+			&& memcmp(serialIndices.data(), deferredIndices.data(), serialIndices.size() * sizeof(ImDrawIdx)) == 0;
+		double recording = timeCall(frame, 1.0);
+		double after = timeCall([&]() {
+			frame();
+			tessellate();
+		}, 1.0);
+
+		std::cout << "GUI tessellation, " << windowCount << " windows, " << serialVertices.size() << " vertices, " << jobs.getThreadCount() << " threads" << (identical ? "" : ", OUTPUT DIFFERS") << std::endl;
+		std::cout << "	Serial: " << before / 1e3 << " us/frame" << std::endl;
+		std::cout << "	Deferred: " << after / 1e3 << " us/frame, " << recording / 1e3 << " us until Render(), " << before / after << "x" << std::endl;
+		ImGui::DestroyContext();
+		return identical ? 0 : 1;
+	}
+
+	// How the loops of MeshOptimizer.h and Environment.h were parallelized before the job system:
+	// one new thread per hardware thread and call, each with a fixed share of the range
+	template<typename Body>
+	void threadPerCallFor(unsigned int threadCount, size_t count, const Body& body) {
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++) {
+			threads.push_back(std::thread([&, t]() {
+				for (size_t i = count * t / threadCount; i < count * (t + 1) / threadCount; i++) {
+					body(i);
+				}
+			}));
+		}
+		for (size_t t = 0; t < threads.size(); t++) {
+			threads[t].join();
+		}
+	}
+
+	// Cost of spawning a job against the std::async per mesh Model used, and the scaling of
+	// parallelFor() against threadPerCallFor() from one thread up to 64
+	int jobs() {
+		unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		JobSystem& shared = JobSystem::shared();
+
+		// Empty jobs, so only the scheduling is timed
+		const int spawnCount = 1024;
+		double jobSpawn = timeCall([&]() {
+			JobSystem::Job* root = shared.create([]() {});
+			for (int i = 0; i < spawnCount; i++) {
+				shared.run(shared.create([]() {}, root));
+			}
+			shared.run(root);
+			shared.wait(root);
+		}) / spawnCount;
+		const int asyncCount = 16;
+		double asyncSpawn = timeCall([&]() {
+			std::future<void> futures[asyncCount];
+			for (int i = 0; i < asyncCount; i++) {
+				futures[i] = std::async(std::launch::async, []() {});
+			}
+			for (int i = 0; i < asyncCount; i++) {
+				futures[i].get();
+			}
+		}, 0.5) / asyncCount;
+		std::cout << "Spawning, " << shared.getThreadCount() << " threads" << std::endl;
+		std::cout << "	std::async: " << asyncSpawn << " ns/job" << std::endl;
+		std::cout << "	Job system: " << jobSpawn << " ns/job, " << asyncSpawn / jobSpawn << "x" << std::endl;
+
+		// About a millisecond of arithmetic on one thread, split finer than the threads so stealing
+		// evens out the pieces
+		const size_t count = 1 << 14;
+		std::vector<float> results(count);
+		auto body = [&](size_t i) {
+			float x = (float)i;
+			for (int k = 0; k < 64; k++) {
+				x = std::sqrt(x * 1.0001f + 1.0f);
+			}
+			results[i] = x;
+		};
+		std::vector<unsigned int> threadCounts;
+		for (unsigned int n = 1; n <= 64 && n <= hardwareThreads; n *= 2) {
+			threadCounts.push_back(n);
+		}
+		if (hardwareThreads < 64 && threadCounts.back() != hardwareThreads) {
+			threadCounts.push_back(hardwareThreads);
+		}
+		std::cout << "Scaling, " << count << " iterations, " << hardwareThreads << " hardware threads" << std::endl;
+		double serial = 0.0;
+		for (size_t c = 0; c < threadCounts.size(); c++) {
+			unsigned int n = threadCounts[c];
+			double before = timeCall([&]() { threadPerCallFor(n, count, body); });
+			JobSystem system(n);
+			double after = timeCall([&]() { system.parallelFor(count, 256, body); });
+			if (c == 0) {
+				serial = after;
+			}
+			std::cout << "	" << n << " threads: thread per call " << before / 1e3 << " us, job system " << after / 1e3 << " us, "
+				<< before / after << "x, efficiency " << 100.0 * serial / (after * n) << "%" << std::endl;
+		}
+		if (hardwareThreads < 64) {
+			std::cout << "	Counts above " << hardwareThreads << " threads need a machine with more cores" << std::endl;
+		}
+		return 0;
+	}
+}
+
+int runBenchmark(int argc, char** argv) {
+	struct Entry {
+		const char* name;
+		int (*run)();
+	};
+	const Entry benchmarks[] = {
+		{ "hashing", Benchmarks::hashing },
+		{ "text", Benchmarks::text },
+		{ "tessellation", Benchmarks::tessellation },
+		{ "jobs", Benchmarks::jobs }
+	};
+	const size_t benchmarkCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	for (size_t i = 0; i < benchmarkCount; i++) {
+		if (argc > 2 && strcmp(argv[2], benchmarks[i].name) == 0) {
+			return benchmarks[i].run();
+		}
+	}
+	std::cout << "Usage: " << argv[0] << " --benchmark <name>, where name is one of:" << std::endl;
+	for (size_t i = 0; i < benchmarkCount; i++) {
+		std::cout << "	" << benchmarks[i].name << std::endl;
+	}
+	return 1;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+// Blocking queue between two threads. push() waits while the queue is full, pop() waits
+// while it is empty and returns false once the queue is closed and drained.
+template<typename T>
+class BoundedQueue {
+private:
+	std::deque<T> items;
+	size_t capacity;
+	bool closed = false;
+	std::mutex mutex;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+
+public:
+	BoundedQueue(size_t capacity) {
+		this->capacity = std::max(capacity, (size_t)1);
+	}
+
+	void push(T item) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->notFull.wait(lock, [&]() { return this->items.size() < this->capacity; });
+		this->items.push_back(std::move(item));
+		this->notEmpty.notify_one();
+	}
+
+	// Doesn't wait, item is left untouched when the queue is full
+	bool tryPush(T& item) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->items.size() >= this->capacity) {
+			return false;
+		}
+		this->items.push_back(std::move(item));
+		this->notEmpty.notify_one();
+		return true;
+	}
+
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->notEmpty.wait(lock, [&]() { return this->closed || !this->items.empty(); });
+		if (this->items.empty()) {
+			return false;
+		}
+		item = std::move(this->items.front());
+		this->items.pop_front();
+		this->notFull.notify_one();
+		return true;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->closed = true;
+		this->notEmpty.notify_all();
+	}
+};
\ No newline at end of file
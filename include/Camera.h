@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Everything needed to render the scene from one point of view
+struct Camera {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 position;
+	float viewportHeight;
+};
+
+// Six clip planes extracted from a view-projection matrix (Gribb and Hartmann). Passing a
+// projection * view * model matrix gives the planes in that model's object space.
+struct Frustum {
+	// xyz is the normalized plane normal pointing inside, w the distance
+	glm::vec4 planes[6];
+
+	// Uninitialized, for arrays that are filled afterwards
+	Frustum() {}
+
+	Frustum(const glm::mat4& m) {
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+		}
+		this->planes[0] = rows[3] + rows[0];
+		this->planes[1] = rows[3] - rows[0];
+		this->planes[2] = rows[3] + rows[1];
+		this->planes[3] = rows[3] - rows[1];
+		this->planes[4] = rows[3] + rows[2];
+		this->planes[5] = rows[3] - rows[2];
+		for (int i = 0; i < 6; i++) {
+			this->planes[i] /= glm::length(glm::vec3(this->planes[i]));
+		}
+	}
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const {
+		for (int i = 0; i < 6; i++) {
+			if (glm::dot(glm::vec3(this->planes[i]), center) + this->planes[i].w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
\ No newline at end of file
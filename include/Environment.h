@@ -0,0 +1,549 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <stb_image.h>
+#include <ShaderProgram.h>
+#include <JobSystem.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ENVIRONMENT_SSE 1
+#endif
+
+// Image-based lighting from an equirectangular HDR image: 9 spherical harmonics coefficients for
+// diffuse irradiance, a GGX prefiltered cube map mip chain for specular, and the split-sum BRDF
+// lookup table. Everything is computed on the CPU (so it also works without a GL context) and
+// cached next to the source image in a file named after the hash of its contents.
+// setupTextures() uploads the results and must be called on the thread owning the GL context.
+class Environment {
+private:
+	// Changing any of these (or the algorithms below) must change CACHE_VERSION
+	static const unsigned int CACHE_VERSION = 1;
+	static const int BASE_SIZE = 256;
+	static const int PREFILTERED_LEVELS = 6;
+	static const int PREFILTER_SAMPLES = 128;
+	static const int BRDF_LUT_SIZE = 128;
+	static const int BRDF_LUT_SAMPLES = 256;
+
+	// One face of a cube map level, RGBA floats so a texel is a single SSE register
+	typedef std::vector<float> CubeFace;
+	struct CubeLevel {
+		int size;
+		CubeFace faces[6];
+	};
+
+	unsigned int prefilteredTexture = 0;
+	unsigned int brdfLutTexture = 0;
+
+	// A row is plenty of work for one job
+	template<typename Body>
+	static void parallelFor(size_t count, Body body) {
+		JobSystem::shared().parallelFor(count, 1, body);
+	}
+
+	// OpenGL cube map face conventions, s and t are in [-1, 1]
+	static glm::vec3 faceToDirection(int face, float s, float t) {
+		switch (face) {
+		case 0: return glm::normalize(glm::vec3(1.0f, -t, -s));
+		case 1: return glm::normalize(glm::vec3(-1.0f, -t, s));
+		case 2: return glm::normalize(glm::vec3(s, 1.0f, t));
+		case 3: return glm::normalize(glm::vec3(s, -1.0f, -t));
+		case 4: return glm::normalize(glm::vec3(s, -t, 1.0f));
+		default: return glm::normalize(glm::vec3(-s, -t, -1.0f));
+		}
+	}
+
+	// Inverse of faceToDirection, s and t are returned in [0, 1]
+	static int directionToFace(const glm::vec3& d, float& s, float& t) {
+		glm::vec3 a = glm::abs(d);
+		int face;
+		float sc, tc, ma;
+		if (a.x >= a.y && a.x >= a.z) {
+			face = d.x > 0.0f ? 0 : 1;
+			sc = d.x > 0.0f ? -d.z : d.z;
+			tc = -d.y;
+			ma = a.x;
+		}
+		else if (a.y >= a.z) {
+			face = d.y > 0.0f ? 2 : 3;
+			sc = d.x;
+			tc = d.y > 0.0f ? d.z : -d.z;
+			ma = a.y;
+		}
+		else {
+			face = d.z > 0.0f ? 4 : 5;
+			sc = d.z > 0.0f ? d.x : -d.x;
+			tc = -d.y;
+			ma = a.z;
+		}
+		s = 0.5f * (sc / ma + 1.0f);
+		t = 0.5f * (tc / ma + 1.0f);
+		return face;
+	}
+
+	// Bilinear lookup inside one face, clamped at the face edges. Adds weight * texel to sum.
+	static void accumulateBilinear(const CubeFace& face, int size, float s, float t, float weight, float* sum) {
+		float x = glm::clamp(s * size - 0.5f, 0.0f, (float)(size - 1));
+		float y = glm::clamp(t * size - 0.5f, 0.0f, (float)(size - 1));
+		int x0 = (int)x, y0 = (int)y;
+		int x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+		float fx = x - x0, fy = y - y0;
+		const float* p00 = &face[(y0 * size + x0) * 4];
+		const float* p10 = &face[(y0 * size + x1) * 4];
+		const float* p01 = &face[(y1 * size + x0) * 4];
+		const float* p11 = &face[(y1 * size + x1) * 4];
+		float w00 = (1.0f - fx) * (1.0f - fy) * weight, w10 = fx * (1.0f - fy) * weight;
+		float w01 = (1.0f - fx) * fy * weight, w11 = fx * fy * weight;
+#ifdef ENVIRONMENT_SSE
+		__m128 result = _mm_loadu_ps(sum);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(p00), _mm_set1_ps(w00)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(p10), _mm_set1_ps(w10)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(p01), _mm_set1_ps(w01)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(p11), _mm_set1_ps(w11)));
+		_mm_storeu_ps(sum, result);
+#else
+		for (int c = 0; c < 4; c++) {
+			sum[c] += p00[c] * w00 + p10[c] * w10 + p01[c] * w01 + p11[c] * w11;
+		}
+#endif
+	}
+
+	// Trilinear lookup into a mip chain
+	static void accumulateTrilinear(const std::vector<CubeLevel>& chain, const glm::vec3& direction, float mip, float weight, float* sum) {
+		float s, t;
+		int face = directionToFace(direction, s, t);
+		mip = glm::clamp(mip, 0.0f, (float)(chain.size() - 1));
+		int level = (int)mip;
+		float blend = mip - level;
+		accumulateBilinear(chain[level].faces[face], chain[level].size, s, t, weight * (1.0f - blend), sum);
+		if (blend > 0.0f && level + 1 < (int)chain.size()) {
+			accumulateBilinear(chain[level + 1].faces[face], chain[level + 1].size, s, t, weight * blend, sum);
+		}
+	}
+
+	// Bilinear lookup of one face of the prefiltered output, s and t in [0, 1]
+	glm::vec3 samplePrefilteredLevel(int level, int face, float s, float t) const {
+		int size = BASE_SIZE >> level;
+		const float* texels = &this->prefiltered[level][(size_t)face * size * size * 3];
+		float x = glm::clamp(s * size - 0.5f, 0.0f, (float)(size - 1));
+		float y = glm::clamp(t * size - 0.5f, 0.0f, (float)(size - 1));
+		int x0 = (int)x, y0 = (int)y;
+		int x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+		float fx = x - x0, fy = y - y0;
+		glm::vec3 p00 = glm::make_vec3(&texels[(y0 * size + x0) * 3]);
+		glm::vec3 p10 = glm::make_vec3(&texels[(y0 * size + x1) * 3]);
+		glm::vec3 p01 = glm::make_vec3(&texels[(y1 * size + x0) * 3]);
+		glm::vec3 p11 = glm::make_vec3(&texels[(y1 * size + x1) * 3]);
+		return glm::mix(glm::mix(p00, p10, fx), glm::mix(p01, p11, fx), fy);
+	}
+
+	static glm::vec2 hammersley(unsigned int i, unsigned int count) {
+		unsigned int bits = i;
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return glm::vec2((float)i / count, bits * 2.3283064365386963e-10f);
+	}
+
+	// GGX distributed half vector around +Z
+	static glm::vec3 importanceSampleGGX(const glm::vec2& xi, float roughness) {
+		float a = roughness * roughness;
+		float phi = 2.0f * glm::pi<float>() * xi.x;
+		float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+		float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+		return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+	}
+
+	static unsigned long long hashBytes(const std::vector<unsigned char>& bytes) {
+		// FNV-1a, seeded with the cache version so old cache files are never picked up
+		unsigned long long hash = 14695981039346656037ull ^ CACHE_VERSION;
+		for (size_t i = 0; i < bytes.size(); i++) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void projectIrradiance(const float* pixels, int width, int height) {
+		// Per row sums in double, added in a fixed order so the result doesn't depend on the thread count
+		std::vector<glm::dvec3> rows(height * 9, glm::dvec3(0.0));
+		parallelFor(height, [&](size_t y) {
+			float theta = glm::pi<float>() * (y + 0.5f) / height;
+			double solidAngle = (2.0 * glm::pi<double>() / width) * (glm::pi<double>() / height) * std::sin(theta);
+			for (int x = 0; x < width; x++) {
+				float phi = 2.0f * glm::pi<float>() * ((x + 0.5f) / width - 0.5f);
+				glm::vec3 d = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				const float* p = &pixels[((size_t)y * width + x) * 3];
+				glm::dvec3 radiance = glm::dvec3(p[0], p[1], p[2]) * solidAngle;
+				float basis[9];
+				evaluateBasis(d, basis);
+				for (int k = 0; k < 9; k++) {
+					rows[y * 9 + k] += radiance * (double)basis[k];
+				}
+			}
+		});
+		// Convolve with the clamped cosine lobe and divide by pi, so main.fs only multiplies by albedo
+		const double band[9] = { 1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25 };
+		for (int k = 0; k < 9; k++) {
+			glm::dvec3 sum = glm::dvec3(0.0);
+			for (int y = 0; y < height; y++) {
+				sum += rows[y * 9 + k];
+			}
+			this->irradianceSH[k] = glm::vec3(sum * band[k]);
+		}
+	}
+
+	// Real spherical harmonics up to band 2, same order as shBasis() in main.fs
+	static void evaluateBasis(const glm::vec3& d, float* basis) {
+		basis[0] = 0.282095f;
+		basis[1] = 0.488603f * d.y;
+		basis[2] = 0.488603f * d.z;
+		basis[3] = 0.488603f * d.x;
+		basis[4] = 1.092548f * d.x * d.y;
+		basis[5] = 1.092548f * d.y * d.z;
+		basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+		basis[7] = 1.092548f * d.x * d.z;
+		basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+	}
+
+	// Resamples the equirectangular image into a cube with 2x2 supersampling, then box filters it down to 1x1
+	static std::vector<CubeLevel> buildSourceChain(const float* pixels, int width, int height) {
+		std::vector<CubeLevel> chain(1);
+		chain[0].size = BASE_SIZE;
+		for (int f = 0; f < 6; f++) {
+			chain[0].faces[f].assign(BASE_SIZE * BASE_SIZE * 4, 0.0f);
+		}
+		parallelFor(6 * BASE_SIZE, [&](size_t row) {
+			int f = (int)(row / BASE_SIZE), y = (int)(row % BASE_SIZE);
+			for (int x = 0; x < BASE_SIZE; x++) {
+				float* texel = &chain[0].faces[f][(y * BASE_SIZE + x) * 4];
+				for (int sub = 0; sub < 4; sub++) {
+					float s = (x + 0.25f + 0.5f * (sub & 1)) / BASE_SIZE * 2.0f - 1.0f;
+					float t = (y + 0.25f + 0.5f * (sub >> 1)) / BASE_SIZE * 2.0f - 1.0f;
+					glm::vec3 d = faceToDirection(f, s, t);
+					float u = std::atan2(d.z, d.x) / (2.0f * glm::pi<float>()) + 0.5f;
+					float v = std::acos(glm::clamp(d.y, -1.0f, 1.0f)) / glm::pi<float>();
+					// Bilinear, wrapping horizontally
+					float px = u * width - 0.5f, py = glm::clamp(v * height - 0.5f, 0.0f, (float)(height - 1));
+					int x0 = (int)std::floor(px), y0 = (int)py;
+					float fx = px - x0, fy = py - y0;
+					int y1 = std::min(y0 + 1, height - 1);
+					int x1 = ((x0 + 1) % width + width) % width;
+					x0 = (x0 % width + width) % width;
+					for (int c = 0; c < 3; c++) {
+						float top = pixels[((size_t)y0 * width + x0) * 3 + c] * (1.0f - fx) + pixels[((size_t)y0 * width + x1) * 3 + c] * fx;
+						float bottom = pixels[((size_t)y1 * width + x0) * 3 + c] * (1.0f - fx) + pixels[((size_t)y1 * width + x1) * 3 + c] * fx;
+						texel[c] += 0.25f * (top * (1.0f - fy) + bottom * fy);
+					}
+				}
+			}
+		});
+		while (chain.back().size > 1) {
+			const CubeLevel& previous = chain.back();
+			CubeLevel next;
+			next.size = previous.size / 2;
+			for (int f = 0; f < 6; f++) {
+				next.faces[f].resize(next.size * next.size * 4);
+				for (int y = 0; y < next.size; y++) {
+					for (int x = 0; x < next.size; x++) {
+						for (int c = 0; c < 4; c++) {
+							next.faces[f][(y * next.size + x) * 4 + c] = 0.25f * (
+								previous.faces[f][((2 * y) * previous.size + 2 * x) * 4 + c] +
+								previous.faces[f][((2 * y) * previous.size + 2 * x + 1) * 4 + c] +
+								previous.faces[f][((2 * y + 1) * previous.size + 2 * x) * 4 + c] +
+								previous.faces[f][((2 * y + 1) * previous.size + 2 * x + 1) * 4 + c]
+							);
+						}
+					}
+				}
+			}
+			chain.push_back(next);
+		}
+		return chain;
+	}
+
+	// GGX prefiltering with filtered importance sampling: every sample reads from the source mip whose
+	// texels cover about the solid angle the sample represents, so few samples give a smooth result.
+	// With N = V = R, the sample set only depends on the roughness and is shared by all texels of a level.
+	void prefilter(const std::vector<CubeLevel>& source) {
+		struct Sample {
+			glm::vec3 direction;
+			float weight;
+			float mip;
+		};
+		float texelSolidAngle = 4.0f * glm::pi<float>() / (6.0f * BASE_SIZE * BASE_SIZE);
+
+		this->prefiltered.resize(PREFILTERED_LEVELS);
+		for (int level = 0; level < PREFILTERED_LEVELS; level++) {
+			int size = BASE_SIZE >> level;
+			float roughness = (float)level / (PREFILTERED_LEVELS - 1);
+			std::vector<float>& output = this->prefiltered[level];
+			output.assign((size_t)6 * size * size * 3, 0.0f);
+
+			std::vector<Sample> samples;
+			if (level > 0) {
+				float a2 = std::pow(roughness, 4.0f);
+				for (unsigned int i = 0; i < PREFILTER_SAMPLES; i++) {
+					glm::vec3 h = importanceSampleGGX(hammersley(i, PREFILTER_SAMPLES), roughness);
+					glm::vec3 l = glm::vec3(2.0f * h.z * h.x, 2.0f * h.z * h.y, 2.0f * h.z * h.z - 1.0f);
+					if (l.z <= 0.0f) {
+						continue;
+					}
+					float denominator = h.z * h.z * (a2 - 1.0f) + 1.0f;
+					float pdf = a2 / (glm::pi<float>() * denominator * denominator) / 4.0f;
+					float sampleSolidAngle = 1.0f / (PREFILTER_SAMPLES * pdf + 1e-6f);
+					samples.push_back(Sample{ l, l.z, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f });
+				}
+			}
+
+			parallelFor(6 * size, [&](size_t row) {
+				int f = (int)(row / size), y = (int)(row % size);
+				for (int x = 0; x < size; x++) {
+					glm::vec3 n = faceToDirection(f, (x + 0.5f) / size * 2.0f - 1.0f, (y + 0.5f) / size * 2.0f - 1.0f);
+					float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+					float totalWeight = 0.0f;
+					if (samples.empty()) {
+						// Roughness 0 is a mirror, read the source directly
+						accumulateTrilinear(source, n, (float)level, 1.0f, sum);
+						totalWeight = 1.0f;
+					}
+					else {
+						glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+						glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+						glm::vec3 bitangent = glm::cross(n, tangent);
+						for (size_t i = 0; i < samples.size(); i++) {
+							const Sample& sample = samples[i];
+							glm::vec3 l = tangent * sample.direction.x + bitangent * sample.direction.y + n * sample.direction.z;
+							accumulateTrilinear(source, l, sample.mip, sample.weight, sum);
+							totalWeight += sample.weight;
+						}
+					}
+					float* texel = &output[(((size_t)f * size + y) * size + x) * 3];
+					for (int c = 0; c < 3; c++) {
+						texel[c] = sum[c] / totalWeight;
+					}
+				}
+			});
+		}
+	}
+
+	// Split-sum scale and bias of F0, indexed by NdotV (x) and roughness (y)
+	void integrateBrdf() {
+		this->brdfLut.assign(BRDF_LUT_SIZE * BRDF_LUT_SIZE * 2, 0.0f);
+		parallelFor(BRDF_LUT_SIZE, [&](size_t y) {
+			float roughness = (y + 0.5f) / BRDF_LUT_SIZE;
+			float k = roughness * roughness / 2.0f;
+			for (int x = 0; x < BRDF_LUT_SIZE; x++) {
+				float NdotV = (x + 0.5f) / BRDF_LUT_SIZE;
+				glm::vec3 v = glm::vec3(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+				float scale = 0.0f, bias = 0.0f;
+				for (unsigned int i = 0; i < BRDF_LUT_SAMPLES; i++) {
+					glm::vec3 h = importanceSampleGGX(hammersley(i, BRDF_LUT_SAMPLES), roughness);
+					glm::vec3 l = 2.0f * glm::dot(v, h) * h - v;
+					float NdotL = std::max(l.z, 0.0f);
+					float NdotH = std::max(h.z, 0.0f);
+					float VdotH = std::max(glm::dot(v, h), 0.0f);
+					if (NdotL > 0.0f) {
+						float g = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+						float visibility = g * VdotH / (NdotH * NdotV);
+						float fresnel = std::pow(1.0f - VdotH, 5.0f);
+						scale += (1.0f - fresnel) * visibility;
+						bias += fresnel * visibility;
+					}
+				}
+				this->brdfLut[(y * BRDF_LUT_SIZE + x) * 2] = scale / BRDF_LUT_SAMPLES;
+				this->brdfLut[(y * BRDF_LUT_SIZE + x) * 2 + 1] = bias / BRDF_LUT_SAMPLES;
+			}
+		});
+	}
+
+	bool readCache(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		unsigned int header[4];
+		file.read((char*)header, sizeof(header));
+		if (!file || header[0] != 0x314C4249 || header[1] != CACHE_VERSION || header[2] != BASE_SIZE || header[3] != PREFILTERED_LEVELS) {
+			return false;
+		}
+		file.read((char*)this->irradianceSH, sizeof(this->irradianceSH));
+		this->prefiltered.resize(PREFILTERED_LEVELS);
+		for (int level = 0; level < PREFILTERED_LEVELS; level++) {
+			int size = BASE_SIZE >> level;
+			this->prefiltered[level].resize((size_t)6 * size * size * 3);
+			file.read((char*)&this->prefiltered[level][0], this->prefiltered[level].size() * sizeof(float));
+		}
+		this->brdfLut.resize(BRDF_LUT_SIZE * BRDF_LUT_SIZE * 2);
+		file.read((char*)&this->brdfLut[0], this->brdfLut.size() * sizeof(float));
+		return (bool)file;
+	}
+
+	void writeCache(const std::string& path) {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			std::cout << "Could not write environment cache " << path << std::endl;
+			return;
+		}
+		unsigned int header[4] = { 0x314C4249, CACHE_VERSION, BASE_SIZE, PREFILTERED_LEVELS };
+		file.write((const char*)header, sizeof(header));
+		file.write((const char*)this->irradianceSH, sizeof(this->irradianceSH));
+		for (int level = 0; level < PREFILTERED_LEVELS; level++) {
+			file.write((const char*)&this->prefiltered[level][0], this->prefiltered[level].size() * sizeof(float));
+		}
+		file.write((const char*)&this->brdfLut[0], this->brdfLut.size() * sizeof(float));
+	}
+
+public:
+	bool loaded = false;
+	// Irradiance / pi as 9 spherical harmonics coefficients
+	glm::vec3 irradianceSH[9];
+	// RGB floats, the 6 faces of each level back to back, level i is BASE_SIZE >> i texels wide
+	std::vector<std::vector<float>> prefiltered;
+	// RG floats, BRDF_LUT_SIZE x BRDF_LUT_SIZE
+	std::vector<float> brdfLut;
+
+	Environment(const char* hdrPath) {
+		std::ifstream file(hdrPath, std::ios::binary);
+		if (!file) {
+			std::cout << "Failed to open environment " << hdrPath << std::endl;
+			return;
+		}
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+
+		// The cache lives next to the source image
+		std::string directory = hdrPath;
+		size_t slash = directory.find_last_of("/\\");
+		directory = slash == std::string::npos ? std::string() : directory.substr(0, slash + 1);
+		char name[64];
+		snprintf(name, sizeof(name), "ibl-%016llx.cache", hashBytes(bytes));
+		std::string cachePath = directory + name;
+		if (readCache(cachePath)) {
+			std::cout << "Environment loaded from " << cachePath << std::endl;
+			this->loaded = true;
+			return;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		int width, height, channels;
+		float* pixels = stbi_loadf_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, 3);
+		if (!pixels) {
+			std::cout << "Failed to load environment " << hdrPath << ": " << stbi_failure_reason() << std::endl;
+			return;
+		}
+		projectIrradiance(pixels, width, height);
+		std::vector<CubeLevel> source = buildSourceChain(pixels, width, height);
+		stbi_image_free(pixels);
+		prefilter(source);
+		integrateBrdf();
+		this->loaded = true;
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Environment prefiltered in " << elapsed.count() << " ms, cached to " << cachePath << std::endl;
+		writeCache(cachePath);
+	}
+
+	// Owns GL textures, so it is not copyable
+	Environment(const Environment&) = delete;
+	Environment& operator=(const Environment&) = delete;
+
+	~Environment() {
+		if (this->prefilteredTexture) {
+			glDeleteTextures(1, &this->prefilteredTexture);
+			glDeleteTextures(1, &this->brdfLutTexture);
+		}
+	}
+
+	void setupTextures() {
+		if (!this->loaded) {
+			return;
+		}
+		glGenTextures(1, &this->prefilteredTexture);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, this->prefilteredTexture);
+		for (int level = 0; level < PREFILTERED_LEVELS; level++) {
+			int size = BASE_SIZE >> level;
+			for (int f = 0; f < 6; f++) {
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, level, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT, &this->prefiltered[level][(size_t)f * size * size * 3]);
+			}
+		}
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, PREFILTERED_LEVELS - 1);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+		glGenTextures(1, &this->brdfLutTexture);
+		glBindTexture(GL_TEXTURE_2D, this->brdfLutTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, BRDF_LUT_SIZE, BRDF_LUT_SIZE, 0, GL_RG, GL_FLOAT, &this->brdfLut[0]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// Binds the maps to texture units 8 and 9 and sets the ambient uniforms of main.fs
+	void bind(ShaderProgram& shader) {
+		shader.setUniformInt("environmentEnabled", this->prefilteredTexture != 0);
+		if (!this->prefilteredTexture) {
+			return;
+		}
+		shader.setUniformInt("prefilteredMap", 8);
+		glActiveTexture(GL_TEXTURE8);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, this->prefilteredTexture);
+		shader.setUniformInt("brdfLut", 9);
+		glActiveTexture(GL_TEXTURE9);
+		glBindTexture(GL_TEXTURE_2D, this->brdfLutTexture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setUniformFloat("prefilteredMaxLod", (float)(PREFILTERED_LEVELS - 1));
+		shader.setUniformVec3Array("irradianceSH", 9, this->irradianceSH);
+	}
+
+	// CPU equivalents of the shader lookups for renderers without a GL context. Both filter like
+	// the textures do: trilinear with clamped face edges, and bilinear with clamped edges.
+	glm::vec3 samplePrefiltered(const glm::vec3& direction, float lod) const {
+		float s, t;
+		int face = directionToFace(direction, s, t);
+		lod = glm::clamp(lod, 0.0f, (float)(PREFILTERED_LEVELS - 1));
+		int level = (int)lod;
+		float blend = lod - level;
+		glm::vec3 result = samplePrefilteredLevel(level, face, s, t) * (1.0f - blend);
+		if (blend > 0.0f && level + 1 < PREFILTERED_LEVELS) {
+			result += samplePrefilteredLevel(level + 1, face, s, t) * blend;
+		}
+		return result;
+	}
+
+	glm::vec2 sampleBrdf(float NdotV, float roughness) const {
+		float x = glm::clamp(NdotV * BRDF_LUT_SIZE - 0.5f, 0.0f, (float)(BRDF_LUT_SIZE - 1));
+		float y = glm::clamp(roughness * BRDF_LUT_SIZE - 0.5f, 0.0f, (float)(BRDF_LUT_SIZE - 1));
+		int x0 = (int)x, y0 = (int)y;
+		int x1 = std::min(x0 + 1, BRDF_LUT_SIZE - 1), y1 = std::min(y0 + 1, BRDF_LUT_SIZE - 1);
+		float fx = x - x0, fy = y - y0;
+		const float* lut = &this->brdfLut[0];
+		glm::vec2 top = glm::mix(glm::vec2(lut[(y0 * BRDF_LUT_SIZE + x0) * 2], lut[(y0 * BRDF_LUT_SIZE + x0) * 2 + 1]),
+			glm::vec2(lut[(y0 * BRDF_LUT_SIZE + x1) * 2], lut[(y0 * BRDF_LUT_SIZE + x1) * 2 + 1]), fx);
+		glm::vec2 bottom = glm::mix(glm::vec2(lut[(y1 * BRDF_LUT_SIZE + x0) * 2], lut[(y1 * BRDF_LUT_SIZE + x0) * 2 + 1]),
+			glm::vec2(lut[(y1 * BRDF_LUT_SIZE + x1) * 2], lut[(y1 * BRDF_LUT_SIZE + x1) * 2 + 1]), fx);
+		return glm::mix(top, bottom, fy);
+	}
+
+	float getMaxLod() const {
+		return (float)(PREFILTERED_LEVELS - 1);
+	}
+};
\ No newline at end of file
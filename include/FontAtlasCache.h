@@ -0,0 +1,247 @@
+#pragma once
+
+#include <imgui.h>
+#include <imgui_internal.h>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+// Builds a Dear ImGUI font atlas once and keeps the result on disk. The first build rasterizes the
+// fonts with stb_truetype and packs them as usual, then writes the glyph tables and the single
+// channel pixels to the cache file. Later builds with the same inputs read that back instead.
+// The key covers everything that affects the output: the font data itself, sizes, glyph ranges,
+// oversampling, the atlas flags and the layout of the structures that are written raw. When it
+// doesn't match, the atlas is rebuilt and the file replaced.
+namespace FontAtlasCache {
+	const unsigned int MAGIC = 0x41464D49; // "IMFA"
+	const unsigned int VERSION = 1;
+
+	struct Writer {
+		std::vector<unsigned char> bytes;
+
+		void write(const void* data, size_t size) {
+			const unsigned char* begin = (const unsigned char*)data;
+			this->bytes.insert(this->bytes.end(), begin, begin + size);
+		}
+
+		template<typename T>
+		void write(const T& value) {
+			write(&value, sizeof(T));
+		}
+	};
+
+	struct Reader {
+		const std::vector<unsigned char>& bytes;
+		size_t position = 0;
+
+		Reader(const std::vector<unsigned char>& bytes) : bytes(bytes) {}
+
+		bool read(void* data, size_t size) {
+			if (size > this->bytes.size() - this->position) {
+				return false;
+			}
+			memcpy(data, this->bytes.data() + this->position, size);
+			this->position += size;
+			return true;
+		}
+
+		template<typename T>
+		bool read(T& value) {
+			return read(&value, sizeof(T));
+		}
+	};
+
+	inline int fontIndex(const ImFontAtlas* atlas, const ImFont* font) {
+		for (int i = 0; i < atlas->Fonts.Size; i++) {
+			if (atlas->Fonts[i] == font) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// Everything the build depends on, compared byte for byte with the cached copy
+	inline std::vector<unsigned char> makeKey(ImFontAtlas* atlas) {
+		Writer key;
+		key.write(MAGIC);
+		key.write(VERSION);
+		key.write((int)IMGUI_VERSION_NUM);
+		key.write((int)sizeof(ImFontGlyph));
+		key.write((int)sizeof(ImFontAtlas::CustomRect));
+		key.write(atlas->Flags);
+		key.write(atlas->TexDesiredWidth);
+		key.write(atlas->TexGlyphPadding);
+		key.write(atlas->Fonts.Size);
+		key.write(atlas->ConfigData.Size);
+		for (int i = 0; i < atlas->ConfigData.Size; i++) {
+			const ImFontConfig& config = atlas->ConfigData[i];
+			key.write(config.FontDataSize);
+			key.write(ImHashData(config.FontData, (size_t)config.FontDataSize));
+			key.write(config.FontNo);
+			key.write(config.SizePixels);
+			key.write(config.OversampleH);
+			key.write(config.OversampleV);
+			key.write(config.PixelSnapH);
+			key.write(config.GlyphExtraSpacing);
+			key.write(config.GlyphOffset);
+			key.write(config.GlyphMinAdvanceX);
+			key.write(config.GlyphMaxAdvanceX);
+			key.write(config.MergeMode);
+			key.write(config.RasterizerFlags);
+			key.write(config.RasterizerMultiply);
+			key.write(fontIndex(atlas, config.DstFont));
+			const ImWchar* ranges = config.GlyphRanges ? config.GlyphRanges : atlas->GetGlyphRangesDefault();
+			for (; ranges[0]; ranges += 2) {
+				key.write(ranges[0]);
+				key.write(ranges[1]);
+			}
+			key.write((ImWchar)0);
+		}
+		// Rectangles added by the application, the atlas adds its own during the build
+		key.write(atlas->CustomRects.Size);
+		for (int i = 0; i < atlas->CustomRects.Size; i++) {
+			const ImFontAtlas::CustomRect& rect = atlas->CustomRects[i];
+			key.write(rect.ID);
+			key.write(rect.Width);
+			key.write(rect.Height);
+			key.write(rect.GlyphAdvanceX);
+			key.write(rect.GlyphOffset);
+			key.write(fontIndex(atlas, rect.Font));
+		}
+		return key.bytes;
+	}
+
+	inline bool save(const ImFontAtlas* atlas, const std::vector<unsigned char>& key, const char* path) {
+		Writer file;
+		file.write((unsigned int)key.size());
+		file.write(key.data(), key.size());
+		file.write(atlas->TexWidth);
+		file.write(atlas->TexHeight);
+		file.write(atlas->TexUvWhitePixel);
+		file.write(atlas->CustomRectIds[0]);
+		file.write(atlas->CustomRects.Size);
+		for (int i = 0; i < atlas->CustomRects.Size; i++) {
+			ImFontAtlas::CustomRect rect = atlas->CustomRects[i];
+			int font = fontIndex(atlas, rect.Font);
+			rect.Font = NULL;
+			file.write(rect);
+			file.write(font);
+		}
+		for (int i = 0; i < atlas->Fonts.Size; i++) {
+			const ImFont* font = atlas->Fonts[i];
+			file.write(font->FontSize);
+			file.write(font->Ascent);
+			file.write(font->Descent);
+			file.write(font->MetricsTotalSurface);
+			file.write(font->Glyphs.Size);
+			file.write(font->Glyphs.Data, (size_t)font->Glyphs.size_in_bytes());
+		}
+		file.write(atlas->TexPixelsAlpha8, (size_t)atlas->TexWidth * atlas->TexHeight);
+
+		std::ofstream out(path, std::ios::binary);
+		out.write((const char*)file.bytes.data(), file.bytes.size());
+		return (bool)out;
+	}
+
+	// Fills the fonts and the pixels of atlas from the cache, leaves it untouched on failure
+	inline bool load(ImFontAtlas* atlas, const std::vector<unsigned char>& key, const char* path) {
+		std::ifstream in(path, std::ios::binary);
+		if (!in) {
+			return false;
+		}
+		std::vector<unsigned char> bytes = std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		Reader file = Reader(bytes);
+		unsigned int keySize = 0;
+		if (!file.read(keySize) || keySize != key.size() || keySize > bytes.size() - file.position
+			|| memcmp(bytes.data() + file.position, key.data(), keySize) != 0) {
+			return false;
+		}
+		file.position += keySize;
+
+		int width = 0, height = 0, whitePixelRect = -1, rectCount = 0;
+		ImVec2 whitePixel;
+		if (!file.read(width) || !file.read(height) || !file.read(whitePixel) || !file.read(whitePixelRect) || !file.read(rectCount)
+			|| width <= 0 || height <= 0 || rectCount < 0 || whitePixelRect >= rectCount || (size_t)rectCount > bytes.size() - file.position) {
+			return false;
+		}
+		ImVector<ImFontAtlas::CustomRect> rects;
+		rects.resize(rectCount);
+		for (int i = 0; i < rectCount; i++) {
+			int font = -1;
+			if (!file.read(rects[i]) || !file.read(font) || font >= atlas->Fonts.Size) {
+				return false;
+			}
+			rects[i].Font = font >= 0 ? atlas->Fonts[font] : NULL;
+		}
+		struct FontData {
+			float size, ascent, descent;
+			int surface;
+			ImVector<ImFontGlyph> glyphs;
+		};
+		std::vector<FontData> fonts = std::vector<FontData>(atlas->Fonts.Size);
+		for (size_t i = 0; i < fonts.size(); i++) {
+			int glyphCount = 0;
+			if (!file.read(fonts[i].size) || !file.read(fonts[i].ascent) || !file.read(fonts[i].descent) || !file.read(fonts[i].surface)
+				|| !file.read(glyphCount) || glyphCount < 0 || (size_t)glyphCount > (bytes.size() - file.position) / sizeof(ImFontGlyph)) {
+				return false;
+			}
+			fonts[i].glyphs.resize(glyphCount);
+			file.read(fonts[i].glyphs.Data, (size_t)fonts[i].glyphs.size_in_bytes());
+		}
+		size_t pixelCount = (size_t)width * height;
+		if (bytes.size() - file.position != pixelCount) {
+			return false;
+		}
+
+		// Same end state as ImFontAtlas::Build()
+		atlas->ClearTexData();
+		atlas->TexID = (ImTextureID)NULL;
+		atlas->TexWidth = width;
+		atlas->TexHeight = height;
+		atlas->TexUvScale = ImVec2(1.0f / width, 1.0f / height);
+		atlas->TexUvWhitePixel = whitePixel;
+		atlas->TexPixelsAlpha8 = (unsigned char*)IM_ALLOC(pixelCount);
+		memcpy(atlas->TexPixelsAlpha8, bytes.data() + file.position, pixelCount);
+		atlas->CustomRects.swap(rects);
+		atlas->CustomRectIds[0] = whitePixelRect;
+		for (int i = 0; i < atlas->ConfigData.Size; i++) {
+			ImFontConfig& config = atlas->ConfigData[i];
+			ImFont* font = config.DstFont;
+			if (!config.MergeMode) {
+				font->ClearOutputData();
+				font->ConfigData = &config;
+				font->ConfigDataCount = 0;
+				font->ContainerAtlas = atlas;
+			}
+			font->ConfigDataCount++;
+		}
+		for (int i = 0; i < atlas->Fonts.Size; i++) {
+			ImFont* font = atlas->Fonts[i];
+			font->FontSize = fonts[i].size;
+			font->Ascent = fonts[i].ascent;
+			font->Descent = fonts[i].descent;
+			font->MetricsTotalSurface = fonts[i].surface;
+			font->Glyphs.swap(fonts[i].glyphs);
+			font->BuildLookupTable();
+		}
+		return true;
+	}
+
+	// Builds atlas with the fonts added to it so far, or the default font when there are none, going
+	// through the cache at path. Returns whether the cache was used.
+	inline bool build(ImFontAtlas* atlas, const char* path) {
+		if (atlas->ConfigData.empty()) {
+			atlas->AddFontDefault();
+		}
+		std::vector<unsigned char> key = makeKey(atlas);
+		if (load(atlas, key, path)) {
+			return true;
+		}
+		atlas->Build();
+		if (atlas->TexPixelsAlpha8) {
+			save(atlas, key, path);
+		}
+		return false;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cstdarg>
+#include <cstdio>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+// Scratch memory for things that only live until the end of the frame, e.g. uniform names and
+// labels. allocate() moves a pointer through one block, and reset() at the end of the frame
+// makes all of it available again, nothing is freed one by one.
+// A frame that needs more than the block holds gets extra blocks from the heap. The next reset()
+// replaces them with a single block big enough for that frame, so after the first frames the
+// arena stops touching the heap.
+class FrameArena {
+private:
+	unsigned char* block = NULL;
+	size_t capacity = 0;
+	size_t used = 0;
+	std::vector<unsigned char*> overflowBlocks;
+	size_t overflowBytes = 0;
+
+	void allocateBlock(size_t capacity) {
+		delete[] this->block;
+		this->block = new unsigned char[capacity];
+		this->capacity = capacity;
+	}
+
+public:
+	FrameArena(size_t capacity = 64 * 1024) {
+		allocateBlock(capacity);
+	}
+
+	~FrameArena() {
+		for (size_t i = 0; i < this->overflowBlocks.size(); i++) {
+			delete[] this->overflowBlocks[i];
+		}
+		delete[] this->block;
+	}
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// Valid until the next reset()
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+		assert(alignment <= alignof(std::max_align_t) && (alignment & (alignment - 1)) == 0);
+		size_t start = (this->used + alignment - 1) & ~(alignment - 1);
+		if (start + size <= this->capacity) {
+			this->used = start + size;
+			return this->block + start;
+		}
+		// new[] is aligned for any fundamental type
+		unsigned char* overflow = new unsigned char[std::max<size_t>(size, 1)];
+		this->overflowBlocks.push_back(overflow);
+		this->overflowBytes += size + alignment;
+		return overflow;
+	}
+
+	// Uninitialized, the destructors are never called
+	template<typename T>
+	T* allocateArray(size_t count) {
+		static_assert(std::is_trivially_destructible<T>::value, "Arena memory is released without calling destructors");
+		return (T*)allocate(count * sizeof(T), alignof(T));
+	}
+
+	// printf into the arena, e.g. for uniform names
+	const char* format(const char* fmt, ...) {
+		va_list args, argsCopy;
+		va_start(args, fmt);
+		va_copy(argsCopy, args);
+		int length = vsnprintf(NULL, 0, fmt, args);
+		va_end(args);
+		char* text = (char*)allocate(length > 0 ? (size_t)length + 1 : 1, 1);
+		if (length > 0) {
+			vsnprintf(text, (size_t)length + 1, fmt, argsCopy);
+		}
+		else {
+			text[0] = '\0';
+		}
+		va_end(argsCopy);
+		return text;
+	}
+
+	// Call at the end of every frame, everything allocated so far becomes invalid
+	void reset() {
+		if (!this->overflowBlocks.empty()) {
+			for (size_t i = 0; i < this->overflowBlocks.size(); i++) {
+				delete[] this->overflowBlocks[i];
+			}
+			this->overflowBlocks.clear();
+			// Room for the whole frame that just ended, with some to spare
+			size_t needed = this->used + this->overflowBytes;
+			allocateBlock(needed + needed / 2);
+			this->overflowBytes = 0;
+		}
+		this->used = 0;
+	}
+
+	size_t getCapacity() const {
+		return this->capacity;
+	}
+
+	size_t getUsed() const {
+		return this->used + this->overflowBytes;
+	}
+};
\ No newline at end of file
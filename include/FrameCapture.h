@@ -0,0 +1,248 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <ImageWriter.h>
+#include <BoundedQueue.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// Screenshots and frame sequences without stalling the GPU. glReadPixels into a pixel pack buffer
+// returns immediately, the copy happens when the GPU gets to it. A fence after every read tells
+// when the buffer can be mapped, usually RING_SIZE - 1 frames later, and the pixels are then
+// handed to encoder threads that write the PNGs.
+// When the encoders fall behind, frames stay in the ring; once every buffer is busy, frames of a
+// recording are dropped instead of waiting, and counted.
+class FrameCapture {
+public:
+	static const int RING_SIZE = 3;
+
+private:
+	struct EncodeJob {
+		std::string path;
+		int width, height;
+		std::vector<unsigned char> rgba;
+	};
+
+	struct Slot {
+		GLuint buffer = 0;
+		size_t size = 0;
+		GLsync fence = 0;
+		// Order of submission, the oldest slot is retired first
+		unsigned long long sequence = 0;
+		EncodeJob job;
+		bool busy = false;
+		bool copied = false;
+	};
+
+	Slot slots[RING_SIZE];
+	unsigned long long nextSequence = 0;
+	BoundedQueue<EncodeJob> jobs;
+	std::vector<std::thread> encoders;
+
+	std::string screenshotPath;
+	std::string recordingDirectory;
+	bool recording = false;
+	unsigned int recordedFrames = 0;
+	unsigned int droppedFrames = 0;
+
+	void encode() {
+		EncodeJob job;
+		while (this->jobs.pop(job)) {
+			// GL rows go from bottom to top, and the default framebuffer's alpha is undefined
+			size_t rowSize = (size_t)job.width * 4;
+			std::vector<unsigned char> row(rowSize);
+			for (int y = 0; y < job.height / 2; y++) {
+				unsigned char* top = &job.rgba[y * rowSize];
+				unsigned char* bottom = &job.rgba[(job.height - 1 - y) * rowSize];
+				memcpy(row.data(), top, rowSize);
+				memcpy(top, bottom, rowSize);
+				memcpy(bottom, row.data(), rowSize);
+			}
+			for (size_t i = 3; i < job.rgba.size(); i += 4) {
+				job.rgba[i] = 255;
+			}
+			if (!ImageWriter::writePng(job.path.c_str(), job.rgba.data(), job.width, job.height)) {
+				std::cout << "Failed to write " << job.path << std::endl;
+			}
+		}
+	}
+
+	// Copies the pixels out of a finished buffer, and queues them once an encoder has room.
+	// wait blocks on the fence instead of polling it.
+	bool retire(Slot& slot, bool wait) {
+		if (!slot.copied) {
+			GLenum status;
+			do {
+				status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+			} while (wait && status == GL_TIMEOUT_EXPIRED);
+			// When waiting failed, mapping the buffer still waits for the copy
+			if (status == GL_TIMEOUT_EXPIRED) {
+				return false;
+			}
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+			if (pixels) {
+				slot.job.rgba.assign(pixels, pixels + slot.size);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slot.copied = true;
+		}
+		if (wait) {
+			this->jobs.push(std::move(slot.job));
+		}
+		else if (!this->jobs.tryPush(slot.job)) {
+			return false;
+		}
+		slot.busy = false;
+		slot.copied = false;
+		return true;
+	}
+
+	Slot* oldestBusySlot() {
+		Slot* oldest = NULL;
+		for (int i = 0; i < RING_SIZE; i++) {
+			if (this->slots[i].busy && (!oldest || this->slots[i].sequence < oldest->sequence)) {
+				oldest = &this->slots[i];
+			}
+		}
+		return oldest;
+	}
+
+	void read(Slot& slot, GLuint framebuffer, int width, int height, const std::string& path) {
+		size_t size = (size_t)width * height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		if (slot.size != size) {
+			glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+			slot.size = size;
+		}
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glReadBuffer(framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+		// Rows of RGBA8 are always 4 byte aligned, the default pack alignment is fine
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.sequence = this->nextSequence++;
+		slot.job.path = path;
+		slot.job.width = width;
+		slot.job.height = height;
+		slot.busy = true;
+	}
+
+public:
+	FrameCapture(unsigned int encoderCount = 2) : jobs(RING_SIZE * 2) {
+		for (int i = 0; i < RING_SIZE; i++) {
+			glGenBuffers(1, &this->slots[i].buffer);
+		}
+		for (unsigned int i = 0; i < std::max(encoderCount, 1u); i++) {
+			this->encoders.push_back(std::thread(&FrameCapture::encode, this));
+		}
+	}
+
+	// Writes out every frame still in flight, needs the GL context to be current
+	~FrameCapture() {
+		for (Slot* slot = oldestBusySlot(); slot; slot = oldestBusySlot()) {
+			retire(*slot, true);
+		}
+		this->jobs.close();
+		for (size_t i = 0; i < this->encoders.size(); i++) {
+			this->encoders[i].join();
+		}
+		for (int i = 0; i < RING_SIZE; i++) {
+			glDeleteBuffers(1, &this->slots[i].buffer);
+		}
+	}
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// The next frame is written to path
+	void requestScreenshot(const std::string& path) {
+		this->screenshotPath = path;
+	}
+
+	// Every following frame is written to directory/frame_<number>.png
+	void startRecording(const std::string& directory) {
+		this->recordingDirectory = directory;
+		this->recording = true;
+		this->recordedFrames = 0;
+		this->droppedFrames = 0;
+	}
+
+	void stopRecording() {
+		if (this->recording) {
+			std::cout << "Recorded " << this->recordedFrames << " frames to " << this->recordingDirectory << ", dropped " << this->droppedFrames << std::endl;
+		}
+		this->recording = false;
+	}
+
+	bool isRecording() const {
+		return this->recording;
+	}
+
+	// Whether frames have to keep coming, to record or to retire buffers in flight
+	bool isBusy() const {
+		if (this->recording || !this->screenshotPath.empty()) {
+			return true;
+		}
+		for (int i = 0; i < RING_SIZE; i++) {
+			if (this->slots[i].busy) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Call once per frame after drawing what should be captured, before swapping buffers
+	void endFrame(GLuint framebuffer, int width, int height) {
+		// Buffers are retired in submission order so frames reach the encoders in order
+		for (Slot* slot = oldestBusySlot(); slot; slot = oldestBusySlot()) {
+			if (!retire(*slot, false)) {
+				break;
+			}
+		}
+
+		if (width <= 0 || height <= 0) {
+			return;
+		}
+		std::vector<std::string> paths;
+		if (!this->screenshotPath.empty()) {
+			paths.push_back(this->screenshotPath);
+			this->screenshotPath.clear();
+		}
+		if (this->recording) {
+			char name[32];
+			snprintf(name, sizeof(name), "/frame_%06u.png", this->recordedFrames + this->droppedFrames);
+			paths.push_back(this->recordingDirectory + name);
+		}
+		for (size_t i = 0; i < paths.size(); i++) {
+			Slot* available = NULL;
+			for (int s = 0; s < RING_SIZE && !available; s++) {
+				if (!this->slots[s].busy) {
+					available = &this->slots[s];
+				}
+			}
+			if (available) {
+				read(*available, framebuffer, width, height, paths[i]);
+				if (this->recording && i == paths.size() - 1) {
+					this->recordedFrames++;
+				}
+			}
+			else if (this->recording && i == paths.size() - 1) {
+				this->droppedFrames++;
+			}
+			else {
+				// A screenshot is worth a stall, wait for the oldest buffer
+				retire(*oldestBusySlot(), true);
+				i--;
+			}
+		}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <imgui.h>
+#include <Light.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <functional>
+#include <cstring>
+
+// Everything the render thread needs to draw one frame, filled by the UI thread. Once published
+// a packet isn't changed until the render thread hands it back, so it's read without locks.
+// Packets are slots of a ring and are refilled in place; the vectors and the GUI's draw lists
+// keep their capacity, so a steady frame doesn't allocate.
+struct FramePacket {
+	// Scene
+	glm::mat4 modelMatrix;
+	std::vector<PointLight> pointLights;
+	DirectionalLight dirLight;
+	std::vector<SpotLight> spotlights;
+	float ambientFillStrength;
+	bool shadowsEnabled;
+	bool meshletCulling;
+	// Presentation
+	bool fastUiRenderer;
+	bool cacheUiLayer;
+	// Whether the render thread keeps drawing this packet until the next one arrives
+	bool continuous;
+	int framebufferWidth, framebufferHeight;
+	// Hash of the GUI's draw data, for the steady-state allocation check of debug builds
+	unsigned long long uiHash;
+	// Work that needs the GL context, e.g. uploading a texture the UI thread decoded. Run once,
+	// in order, before the packet is drawn.
+	std::vector<std::function<void()>> commands;
+
+	// A copy of the GUI's ImDrawData, pointing into drawLists
+	ImDrawData drawData;
+	ImVector<ImDrawList*> drawLists;
+
+	FramePacket() {}
+
+	~FramePacket() {
+		for (int i = 0; i < this->drawLists.Size; i++) {
+			IM_DELETE(this->drawLists[i]);
+		}
+	}
+
+	FramePacket(const FramePacket&) = delete;
+	FramePacket& operator=(const FramePacket&) = delete;
+
+	// ImGui reuses its lists every frame, their buffers are copied into lists owned by the packet
+	void copyDrawData(const ImDrawData* source) {
+		while (this->drawLists.Size < source->CmdListsCount) {
+			this->drawLists.push_back(IM_NEW(ImDrawList)(NULL));
+		}
+		for (int n = 0; n < source->CmdListsCount; n++) {
+			const ImDrawList* from = source->CmdLists[n];
+			ImDrawList* to = this->drawLists[n];
+			copyVector(to->CmdBuffer, from->CmdBuffer);
+			copyVector(to->IdxBuffer, from->IdxBuffer);
+			copyVector(to->VtxBuffer, from->VtxBuffer);
+			to->Flags = from->Flags;
+		}
+		this->drawData = *source;
+		this->drawData.CmdLists = this->drawLists.Data;
+	}
+
+private:
+	// Unlike ImVector's assignment, keeps the memory it already has
+	template<typename T>
+	static void copyVector(ImVector<T>& to, const ImVector<T>& from) {
+		to.resize(from.Size);
+		if (from.Size > 0) {
+			memcpy(to.Data, from.Data, (size_t)from.Size * sizeof(T));
+		}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <SoftwareRenderer.h>
+#include <PathTracer.h>
+#include <ImageWriter.h>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <cmath>
+
+// Renders one image with the CPU renderer and writes it as a PNG, without creating a window:
+//	3DModelViewer --render <model> <output.png> [--size <width>x<height>] [--environment <hdr>] [--threads <count>]
+//		[--samples <count> [--compare]]
+// The scene matches the viewer at startup: default camera, lights and stone material. With --samples
+// the image is path traced instead and the HDR result is also written next to the PNG; --compare then
+// rasterizes the scene as well and writes the difference between the two.
+int renderHeadless(int argc, char** argv) {
+	auto usage = [&]() {
+		std::cout << "Usage: " << argv[0] << " --render <model> <output.png> [--size <width>x<height>] [--environment <hdr>] [--threads <count>] [--samples <count> [--compare]]" << std::endl;
+		return 1;
+	};
+	if (argc < 4) {
+		return usage();
+	}
+	const char* modelPath = argv[2];
+	const char* outputPath = argv[3];
+	int width = 1024, height = 1024;
+	const char* environmentPath = NULL;
+	unsigned int threadCount = 0;
+	unsigned int sampleCount = 0;
+	bool compare = false;
+	for (int i = 4; i < argc; i += 2) {
+		if (strcmp(argv[i], "--compare") == 0) {
+			compare = true;
+			i--;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			std::cout << "Missing value for " << argv[i] << std::endl;
+			return 1;
+		}
+		if (strcmp(argv[i], "--size") == 0) {
+			sscanf(argv[i + 1], "%dx%d", &width, &height);
+		}
+		else if (strcmp(argv[i], "--environment") == 0) {
+			environmentPath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--threads") == 0) {
+			threadCount = (unsigned int)atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--samples") == 0) {
+			sampleCount = (unsigned int)std::max(atoi(argv[i + 1]), 1);
+		}
+		else {
+			std::cout << "Unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+	// The comparison is against the path traced image
+	if (compare && sampleCount == 0) {
+		std::cout << "--compare needs --samples" << std::endl;
+		return usage();
+	}
+
+	SoftwareRenderer renderer = SoftwareRenderer(width, height, threadCount);
+	width = renderer.getWidth();
+	height = renderer.getHeight();
+
+	// Same camera as main.cpp, with the aspect ratio of the image
+	glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 10.0f);
+	glm::mat4 viewMatrix = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projectionMatrix = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
+	Camera camera = Camera{ viewMatrix, projectionMatrix, cameraPosition, (float)height };
+	glm::mat4 modelMatrix = glm::mat4(1.0f);
+
+	std::vector<PointLight> pointLights;
+	DirectionalLight dirLight;
+	std::vector<SpotLight> spotlights;
+	createDefaultLights(pointLights, dirLight, spotlights);
+
+	Model model = Model(modelPath, false, false);
+	SoftwareTexture textures[5] = {
+		SoftwareTexture("assets/stone/stone-albedo.png"),
+		SoftwareTexture("assets/stone/stone-normal.png"),
+		SoftwareTexture("assets/stone/stone-metalness.png"),
+		SoftwareTexture("assets/stone/stone-rough.png"),
+		SoftwareTexture("assets/stone/stone-ao.png")
+	};
+	std::unique_ptr<Environment> environment;
+	if (environmentPath) {
+		environment.reset(new Environment(environmentPath));
+	}
+	AmbientProbe ambientProbe = AmbientProbe(false);
+	ambientProbe.update(pointLights, dirLight, spotlights, glm::vec3(model.getBoundingSphere(modelMatrix)), 0.02f);
+
+	if (sampleCount == 0) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		renderer.render(model, modelMatrix, camera, textures, pointLights, dirLight, spotlights, ambientProbe, environment.get());
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Rendered " << width << "x" << height << " in " << elapsed.count() << " ms" << std::endl;
+
+		if (!ImageWriter::writePng(outputPath, renderer.getImage().data(), width, height)) {
+			std::cout << "Failed to write " << outputPath << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	PathTracer pathTracer = PathTracer(width, height, threadCount);
+	pathTracer.setScene(model, modelMatrix, camera, textures, pointLights, dirLight, spotlights, environment.get());
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pathTracer.addSamples(sampleCount);
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Path traced " << width << "x" << height << " with " << sampleCount << " samples per pixel in " << elapsed.count() << " ms" << std::endl;
+
+	std::string basePath = outputPath;
+	size_t extension = basePath.find_last_of('.');
+	if (extension != std::string::npos && basePath.find_first_of("/\\", extension) == std::string::npos) {
+		basePath = basePath.substr(0, extension);
+	}
+	std::vector<glm::vec3> hdr = pathTracer.getHdrImage();
+	std::vector<unsigned char> image = pathTracer.getToneMappedImage();
+	std::string hdrPath = basePath + ".hdr";
+	if (!ImageWriter::writePng(outputPath, image.data(), width, height) || !ImageWriter::writeHdr(hdrPath.c_str(), &hdr[0].x, width, height)) {
+		std::cout << "Failed to write " << outputPath << std::endl;
+		return 1;
+	}
+	if (!compare) {
+		return 0;
+	}
+
+	// Compares the tone mapped images, the difference is scaled up 4 times to make it visible
+	renderer.render(model, modelMatrix, camera, textures, pointLights, dirLight, spotlights, ambientProbe, environment.get());
+	const std::vector<unsigned char>& raster = renderer.getImage();
+	std::vector<unsigned char> difference(image.size());
+	double squaredError = 0.0;
+	for (size_t i = 0; i < image.size(); i++) {
+		if (i % 4 == 3) {
+			difference[i] = 255;
+			continue;
+		}
+		int delta = (int)raster[i] - (int)image[i];
+		squaredError += (double)delta * delta;
+		difference[i] = (unsigned char)std::min(std::abs(delta) * 4, 255);
+	}
+	double rmse = std::sqrt(squaredError / ((double)width * height * 3)) / 255.0;
+	double psnr = rmse > 0.0 ? 20.0 * std::log10(1.0 / rmse) : INFINITY;
+	std::cout << "Rasterized vs path traced: RMSE " << rmse << ", PSNR " << psnr << " dB" << std::endl;
+	std::string differencePath = basePath + "-diff.png";
+	if (!ImageWriter::writePng(differencePath.c_str(), difference.data(), width, height)) {
+		std::cout << "Failed to write " << differencePath << std::endl;
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
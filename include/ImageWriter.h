@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+
+// Minimal PNG encoder for 8-bit RGBA images. The image data is stored in uncompressed deflate
+// blocks, which keeps the encoder tiny and the output byte-for-byte deterministic. HDR images are
+// written as Radiance RGBE files, which stb_image and most image tools can read.
+namespace ImageWriter {
+	inline std::array<unsigned int, 256> makeCrc32Table() {
+		std::array<unsigned int, 256> table;
+		for (unsigned int i = 0; i < 256; i++) {
+			unsigned int c = i;
+			for (int k = 0; k < 8; k++) {
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+		return table;
+	}
+
+	// Called by several encoder threads at once, the table is built by the thread-safe initialization of a local static
+	inline unsigned int crc32(const unsigned char* data, size_t length, unsigned int crc = 0) {
+		static const std::array<unsigned int, 256> table = makeCrc32Table();
+		crc = ~crc;
+		for (size_t i = 0; i < length; i++) {
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	inline void appendBigEndian(std::vector<unsigned char>& out, unsigned int value) {
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	inline void appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+		appendBigEndian(out, (unsigned int)data.size());
+		size_t typeStart = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		appendBigEndian(out, crc32(&out[typeStart], out.size() - typeStart));
+	}
+
+	// Encodes width x height RGBA pixels, rows top to bottom
+	inline std::vector<unsigned char> encodePng(const unsigned char* rgba, int width, int height) {
+		// Every row starts with filter type 0
+		std::vector<unsigned char> raw;
+		raw.reserve((size_t)height * (width * 4 + 1));
+		for (int y = 0; y < height; y++) {
+			raw.push_back(0);
+			raw.insert(raw.end(), rgba + (size_t)y * width * 4, rgba + (size_t)(y + 1) * width * 4);
+		}
+
+		// zlib stream of stored blocks
+		std::vector<unsigned char> compressed;
+		compressed.push_back(0x78);
+		compressed.push_back(0x01);
+		size_t offset = 0;
+		do {
+			size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+			bool last = offset + blockSize == raw.size();
+			compressed.push_back(last ? 1 : 0);
+			compressed.push_back((unsigned char)blockSize);
+			compressed.push_back((unsigned char)(blockSize >> 8));
+			compressed.push_back((unsigned char)~blockSize);
+			compressed.push_back((unsigned char)(~blockSize >> 8));
+			compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+			offset += blockSize;
+		} while (offset < raw.size());
+		unsigned int a = 1, b = 0;
+		for (size_t i = 0; i < raw.size(); i++) {
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		appendBigEndian(compressed, (b << 16) | a);
+
+		std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		std::vector<unsigned char> header;
+		appendBigEndian(header, width);
+		appendBigEndian(header, height);
+		// 8 bits per channel, RGBA, deflate, no filtering extensions, no interlacing
+		header.push_back(8);
+		header.push_back(6);
+		header.push_back(0);
+		header.push_back(0);
+		header.push_back(0);
+		appendChunk(png, "IHDR", header);
+		appendChunk(png, "IDAT", compressed);
+		appendChunk(png, "IEND", std::vector<unsigned char>());
+		return png;
+	}
+
+	inline bool writePng(const char* path, const unsigned char* rgba, int width, int height) {
+		std::vector<unsigned char> png = encodePng(rgba, width, height);
+		std::ofstream file(path, std::ios::binary);
+		file.write((const char*)png.data(), png.size());
+		return (bool)file;
+	}
+
+	// rgb holds 3 floats per pixel, rows from top to bottom. Scanlines are stored flat, without
+	// run length encoding.
+	inline bool writeHdr(const char* path, const float* rgb, int width, int height) {
+		std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+		std::vector<unsigned char> data(header.begin(), header.end());
+		data.reserve(data.size() + (size_t)width * height * 4);
+		for (size_t i = 0; i < (size_t)width * height; i++) {
+			float r = std::max(rgb[i * 3], 0.0f), g = std::max(rgb[i * 3 + 1], 0.0f), b = std::max(rgb[i * 3 + 2], 0.0f);
+			float brightest = std::max(r, std::max(g, b));
+			if (brightest < 1e-32f) {
+				data.insert(data.end(), { 0, 0, 0, 0 });
+				continue;
+			}
+			int exponent;
+			float scale = std::frexp(brightest, &exponent) * 256.0f / brightest;
+			data.insert(data.end(), { (unsigned char)(r * scale), (unsigned char)(g * scale), (unsigned char)(b * scale), (unsigned char)(exponent + 128) });
+		}
+		std::ofstream file(path, std::ios::binary);
+		file.write((const char*)data.data(), data.size());
+		return (bool)file;
+	}
+}
\ No newline at end of file
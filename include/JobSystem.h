@@ -0,0 +1,349 @@
+#pragma once
+
+#include <WorkStealingDeque.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+#include <new>
+
+// Work-stealing job scheduler, shared by everything that runs in parallel: loading models and
+// textures, prefiltering environments, the CPU renderers and per-frame work like tessellating the GUI.
+//	- Every worker thread has a Chase-Lev deque (WorkStealingDeque.h). Jobs run() on a worker go
+//	  to its own deque, idle workers steal from the others. Other threads, e.g. the UI and render
+//	  threads, hand their jobs over through a small locked queue.
+//	- A job is a function with up to DATA_SIZE bytes of captures, stored inside the job. Jobs come
+//	  from a ring of memory per thread, so creating and running one doesn't allocate. A finished
+//	  job's memory is only reused after its thread went through the whole ring, so wait() can still
+//	  look at it for a while, but don't hold on to jobs beyond that.
+//	- A job created with a parent counts as unfinished work of the parent until it's done, so
+//	  wait() on the parent waits for the whole tree. A waiting thread runs other jobs meanwhile,
+//	  which lets jobs wait for the jobs they spawned.
+//	- continueWith() makes a job start only once other jobs finished. There are no fibers to suspend
+//	  a job half way in portable C++, work that has to wait for others is split into a continuation.
+//	- parallelFor() halves the range down to the grain size, the halves are split further by
+//	  whichever thread takes them, so the splitting is spread over the workers too.
+class JobSystem {
+public:
+	// Bytes of captures a job's function can hold
+	static const size_t DATA_SIZE = 64;
+	static const int MAX_CONTINUATIONS = 4;
+	// Jobs a thread can have unfinished at once. Their memory is reused in creation order, skipping
+	// jobs that didn't finish yet.
+	static const size_t JOBS_PER_THREAD = 4096;
+	// Jobs waiting in one worker's deque, beyond that run() calls the job directly
+	static const size_t QUEUE_SIZE = 4096;
+
+	// Made by create(), the memory belongs to the job system
+	struct Job {
+		void (*function)(Job* job);
+		Job* parent;
+		// The job itself and its unfinished children
+		std::atomic<int> unfinished;
+		// The run() call and the unfinished jobs it continues
+		std::atomic<int> dependencies;
+		int continuationCount;
+		Job* continuations[MAX_CONTINUATIONS];
+		alignas(std::max_align_t) unsigned char data[DATA_SIZE];
+	};
+
+private:
+	// Idle workers look for jobs this many times before they sleep
+	static const int IDLE_SPINS = 64;
+
+	struct Worker {
+		WorkStealingDeque<Job, QUEUE_SIZE> deque;
+		std::thread thread;
+	};
+
+	// The job system the calling thread is a worker of, if any
+	struct ThreadState {
+		JobSystem* system;
+		Worker* worker;
+		unsigned int random;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	// Jobs run() by threads that aren't workers, a ring of QUEUE_SIZE
+	std::mutex injectedMutex;
+	std::vector<Job*> injected;
+	size_t injectedHead = 0;
+	std::atomic<size_t> injectedCount;
+	// Jobs in the deques and the injected queue. Only a hint for the workers when to sleep, it's
+	// counted up before a job is queued and down after it's taken.
+	std::atomic<int> queuedJobs;
+	std::atomic<int> sleepingWorkers;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<bool> quit;
+
+	static ThreadState& threadState() {
+		static thread_local ThreadState state = { NULL, NULL, 1 };
+		return state;
+	}
+
+	static Job* allocateJob() {
+		static thread_local std::unique_ptr<Job[]> jobs;
+		static thread_local size_t next = 0;
+		if (!jobs) {
+			jobs.reset(new Job[JOBS_PER_THREAD]());
+		}
+		for (size_t i = 0; i < JOBS_PER_THREAD; i++) {
+			Job* job = &jobs[next++ % JOBS_PER_THREAD];
+			// Acquire, the thread that finished the job may have used it until then
+			if (job->unfinished.load(std::memory_order_acquire) == 0) {
+				return job;
+			}
+		}
+		assert(false && "A thread has more than JOBS_PER_THREAD unfinished jobs");
+		return NULL;
+	}
+
+	template<typename Function>
+	static void invoke(Job* job) {
+		Function* function = (Function*)job->data;
+		(*function)();
+		function->~Function();
+	}
+
+	void submit(Job* job) {
+		this->queuedJobs.fetch_add(1);
+		bool queued = false;
+		ThreadState& state = threadState();
+		if (state.system == this) {
+			queued = state.worker->deque.push(job);
+		}
+		else {
+			std::lock_guard<std::mutex> lock(this->injectedMutex);
+			size_t count = this->injectedCount.load(std::memory_order_relaxed);
+			if (count < QUEUE_SIZE) {
+				this->injected[(this->injectedHead + count) % QUEUE_SIZE] = job;
+				this->injectedCount.store(count + 1, std::memory_order_relaxed);
+				queued = true;
+			}
+		}
+		if (!queued) {
+			this->queuedJobs.fetch_sub(1);
+			execute(job);
+			return;
+		}
+		// Pairs with the check in work(), either the worker sees the job or this sees the worker
+		if (this->sleepingWorkers.load() > 0) {
+			std::lock_guard<std::mutex> lock(this->sleepMutex);
+			this->wake.notify_one();
+		}
+	}
+
+	Job* findJob() {
+		ThreadState& state = threadState();
+		Worker* self = state.system == this ? state.worker : NULL;
+		Job* job = NULL;
+		if (self) {
+			job = self->deque.pop();
+		}
+		if (!job && this->injectedCount.load(std::memory_order_relaxed) > 0) {
+			std::lock_guard<std::mutex> lock(this->injectedMutex);
+			size_t count = this->injectedCount.load(std::memory_order_relaxed);
+			if (count > 0) {
+				job = this->injected[this->injectedHead];
+				this->injectedHead = (this->injectedHead + 1) % QUEUE_SIZE;
+				this->injectedCount.store(count - 1, std::memory_order_relaxed);
+			}
+		}
+		if (!job && !this->workers.empty()) {
+			// Starting at a random victim spreads the thieves over the workers
+			state.random ^= state.random << 13;
+			state.random ^= state.random >> 17;
+			state.random ^= state.random << 5;
+			size_t start = state.random % this->workers.size();
+			for (size_t i = 0; i < this->workers.size() && !job; i++) {
+				Worker* victim = this->workers[(start + i) % this->workers.size()].get();
+				if (victim != self) {
+					job = victim->deque.steal();
+				}
+			}
+		}
+		if (job) {
+			this->queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	void execute(Job* job) {
+		job->function(job);
+		finish(job);
+	}
+
+	void finish(Job* job) {
+		// Read first, the job's memory may be reused as soon as it's finished
+		Job* parent = job->parent;
+		int continuationCount = job->continuationCount;
+		Job* continuations[MAX_CONTINUATIONS];
+		for (int i = 0; i < continuationCount; i++) {
+			continuations[i] = job->continuations[i];
+		}
+		if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			return;
+		}
+		for (int i = 0; i < continuationCount; i++) {
+			run(continuations[i]);
+		}
+		if (parent) {
+			finish(parent);
+		}
+	}
+
+	void work(Worker* worker, unsigned int index) {
+		ThreadState& state = threadState();
+		state.system = this;
+		state.worker = worker;
+		state.random = index * 2654435761u + 1;
+		int idle = 0;
+		while (!this->quit.load(std::memory_order_relaxed)) {
+			if (Job* job = findJob()) {
+				execute(job);
+				idle = 0;
+				continue;
+			}
+			if (++idle < IDLE_SPINS) {
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(this->sleepMutex);
+			this->sleepingWorkers.fetch_add(1);
+			this->wake.wait(lock, [&]() { return this->quit.load() || this->queuedJobs.load() > 0; });
+			this->sleepingWorkers.fetch_sub(1);
+			idle = 0;
+		}
+	}
+
+	template<typename Body>
+	void split(size_t begin, size_t end, size_t grainSize, const Body* body, Job* parent) {
+		// The upper half goes to the deque where a thief takes it, this thread goes on with the lower
+		while (end - begin > grainSize) {
+			size_t middle = begin + (end - begin) / 2;
+			run(create([this, middle, end, grainSize, body, parent]() {
+				split(middle, end, grainSize, body, parent);
+			}, parent));
+			end = middle;
+		}
+		for (size_t i = begin; i < end; i++) {
+			(*body)(i);
+		}
+	}
+
+public:
+	// 0 uses one thread per hardware thread. The thread calling wait() works too, so there are
+	// threadCount - 1 workers.
+	JobSystem(unsigned int threadCount = 0) {
+		this->injected.resize(QUEUE_SIZE);
+		this->injectedCount = 0;
+		this->queuedJobs = 0;
+		this->sleepingWorkers = 0;
+		this->quit = false;
+		if (threadCount == 0) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+		// All deques exist before any worker can steal from them
+		for (unsigned int t = 1; t < threadCount; t++) {
+			this->workers.push_back(std::unique_ptr<Worker>(new Worker()));
+		}
+		for (size_t t = 0; t < this->workers.size(); t++) {
+			this->workers[t]->thread = std::thread(&JobSystem::work, this, this->workers[t].get(), (unsigned int)t + 1);
+		}
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Everything that was run has to be waited for before
+	~JobSystem() {
+		{
+			std::lock_guard<std::mutex> lock(this->sleepMutex);
+			this->quit = true;
+		}
+		this->wake.notify_all();
+		for (size_t t = 0; t < this->workers.size(); t++) {
+			this->workers[t]->thread.join();
+		}
+	}
+
+	// One thread per hardware thread, for everything that doesn't need a thread count of its own
+	static JobSystem& shared() {
+		static JobSystem system;
+		return system;
+	}
+
+	unsigned int getThreadCount() const {
+		return (unsigned int)this->workers.size() + 1;
+	}
+
+	// A job that calls function once it's run(). With a parent, the parent only finishes after
+	// it, so create children while the parent runs or before it's run.
+	template<typename Function>
+	Job* create(Function function, Job* parent = NULL) {
+		static_assert(sizeof(Function) <= DATA_SIZE, "Jobs store their function inline, capture less or a pointer to the data");
+		static_assert(alignof(Function) <= alignof(std::max_align_t), "Jobs store their function inline, it can't be over-aligned");
+		Job* job = allocateJob();
+		job->function = &invoke<Function>;
+		job->parent = parent;
+		job->unfinished.store(1, std::memory_order_relaxed);
+		job->dependencies.store(1, std::memory_order_relaxed);
+		job->continuationCount = 0;
+		new (job->data) Function(std::move(function));
+		if (parent) {
+			parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	// after starts once before finished and after was run(). Call it before run(before).
+	void continueWith(Job* before, Job* after) {
+		assert(before->continuationCount < MAX_CONTINUATIONS && "Too many continuations, make them children of one job");
+		before->continuations[before->continuationCount++] = after;
+		after->dependencies.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// The job is queued once this was called and the jobs it continues finished
+	void run(Job* job) {
+		if (job->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			submit(job);
+		}
+	}
+
+	// Runs other jobs until job and its children finished
+	void wait(const Job* job) {
+		while (job->unfinished.load(std::memory_order_acquire) > 0) {
+			if (Job* next = findJob()) {
+				execute(next);
+			}
+			else {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Calls body(i) for every i in [0, count) and returns once all calls are done. The range is
+	// split into pieces of at most grainSize indices, 0 picks about four pieces per thread.
+	template<typename Body>
+	void parallelFor(size_t count, size_t grainSize, const Body& body) {
+		if (grainSize == 0) {
+			grainSize = std::max<size_t>(1, count / (getThreadCount() * 4));
+		}
+		if (count <= grainSize) {
+			for (size_t i = 0; i < count; i++) {
+				body(i);
+			}
+			return;
+		}
+		Job* root = create([]() {});
+		split(0, count, grainSize, &body, root);
+		execute(root);
+		wait(root);
+	}
+};
\ No newline at end of file
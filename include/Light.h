@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <vector>
 
 struct PointLight {
 	glm::vec3 position;
@@ -48,4 +49,25 @@ bool operator== (SpotLight a1, SpotLight a2) {
 	else {
 		return false;
 	}
+}
+
+// The lights the viewer starts with: one point light, directional light and spotlight
+void createDefaultLights(std::vector<PointLight>& pointLights, DirectionalLight& dirLight, std::vector<SpotLight>& spotlights) {
+	pointLights.clear();
+	pointLights.push_back(PointLight{
+		glm::vec3(-10.0f, 10.0f, 10.0f),
+		glm::vec3(100.0f, 100.0f, 100.0f)
+	});
+	dirLight = DirectionalLight{
+		glm::vec3(-10.0f, -10.0f, 0.0f),
+		glm::vec3(100.0f, 50.0f, 31.0f)
+	};
+	spotlights.clear();
+	spotlights.push_back(SpotLight{
+		glm::vec3(0.0f, 0.0f, 10.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::cos(glm::radians(10.0f)),
+		glm::cos(glm::radians(20.0f)),
+		glm::vec3(100.0f, 50.0f, 31.0f)
+	});
 }
\ No newline at end of file
@@ -1,21 +1,142 @@
 #pragma once
 
 #include <ShaderProgram.h>
+#include <Vertex.h>
+#include <Meshlets.h>
+#include <Camera.h>
 #include <vector>
+#include <algorithm>
 
-struct Vertex {
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec3 textureCoord;
+// Arguments of glDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	unsigned int baseVertex;
+	unsigned int baseInstance;
+};
+
+// One level of detail: a range of the mesh's index buffer and its simplification error in object space
+struct MeshLod {
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	float error;
 };
 
 class Mesh {
 private:
 	std::vector<Vertex> vertices;
+	// Index buffers of all levels of detail, one after the other
 	std::vector<unsigned int> indices;
+	std::vector<MeshLod> lods;
+	unsigned int currentLod = 0;
+
+	// Object space bounding sphere used for LOD selection
+	glm::vec3 boundingCenter;
+	float boundingRadius;
+
+	// Clusters of LOD 0 for GPU culling, empty for small meshes
+	std::vector<Meshlet> meshlets;
+	unsigned int cullVAO, meshletBuffer, meshletIndexBuffer, meshletOffsetBuffer, visibleIndexBuffer, drawCommandBuffer;
+
+	// Compact vertices, only filled if the mesh uses them
+	std::vector<PackedVertex> packedVertices;
+	glm::vec3 positionOffset;
+	glm::vec3 positionScale;
 
 	unsigned int VAO, VBO, EBO;
-	
+	// Meshes with few enough vertices are drawn with 16-bit indices
+	GLenum indexType;
+	unsigned int indexSize;
+
+	void computeBounds() {
+		glm::vec3 minimum = glm::vec3(0.0f);
+		glm::vec3 maximum = glm::vec3(0.0f);
+		if (!this->vertices.empty()) {
+			minimum = maximum = this->vertices[0].position;
+		}
+		for (int i = 0; i < this->vertices.size(); i++) {
+			minimum = glm::min(minimum, this->vertices[i].position);
+			maximum = glm::max(maximum, this->vertices[i].position);
+		}
+		this->boundingCenter = (minimum + maximum) * 0.5f;
+		this->boundingRadius = 0.0f;
+		for (int i = 0; i < this->vertices.size(); i++) {
+			this->boundingRadius = std::max(this->boundingRadius, glm::length(this->vertices[i].position - this->boundingCenter));
+		}
+		this->positionOffset = minimum;
+		this->positionScale = glm::max(maximum - minimum, glm::vec3(1e-20f));
+	}
+
+	// Returns false if the mesh can't be represented by PackedVertex without visible precision loss
+	bool packVertices() {
+		for (int i = 0; i < this->vertices.size(); i++) {
+			// Half floats are spaced 1/1024 apart in [0.5, 1) and 1/512 in [1, 2), the spacing doubles
+			// with every power of two beyond, so tiled UVs would visibly snap to texels
+			if (std::abs(this->vertices[i].textureCoord.x) > 2.0f || std::abs(this->vertices[i].textureCoord.y) > 2.0f) {
+				return false;
+			}
+		}
+
+		this->packedVertices.resize(this->vertices.size());
+		for (int i = 0; i < this->vertices.size(); i++) {
+			const Vertex& v = this->vertices[i];
+			PackedVertex& packed = this->packedVertices[i];
+			glm::vec3 position = glm::clamp((v.position - this->positionOffset) / this->positionScale, 0.0f, 1.0f);
+			packed.position[0] = glm::packUnorm1x16(position.x);
+			packed.position[1] = glm::packUnorm1x16(position.y);
+			packed.position[2] = glm::packUnorm1x16(position.z);
+			packed.position[3] = 0;
+			glm::vec2 normal = octahedralEncode(glm::length(v.normal) > 0.0f ? v.normal : glm::vec3(0.0f, 0.0f, 1.0f));
+			packed.normal[0] = (short)glm::packSnorm1x16(normal.x);
+			packed.normal[1] = (short)glm::packSnorm1x16(normal.y);
+			packed.textureCoord[0] = glm::packHalf1x16(v.textureCoord.x);
+			packed.textureCoord[1] = glm::packHalf1x16(v.textureCoord.y);
+			packed.tangent = glm::packSnorm3x10_1x2(v.tangent);
+		}
+		return true;
+	}
+public:
+	// compactVertices opts the mesh into the PackedVertex format, it still falls back
+	// to the full format if its attributes don't fit
+	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<MeshLod> lods, std::vector<Meshlet> meshlets, bool compactVertices = false) {
+		this->vertices = vertices;
+		this->indices = indices;
+		this->lods = lods;
+		this->meshlets = meshlets;
+		computeBounds();
+		if (compactVertices) {
+			packVertices();
+		}
+	}
+
+	// Sets up the vertex attributes of the bound vertex array
+	void setupVertexAttributes() {
+		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+		if (!this->packedVertices.empty()) {
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, textureCoord));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+			glEnableVertexAttribArray(3);
+		}
+		else {
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoord));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+			glEnableVertexAttribArray(3);
+		}
+	}
+
+	// Uploads the mesh to the GPU. This is separate from the constructor so that meshes
+	// can be built on worker threads, it must be called on the thread owning the GL context.
 	void setupMesh() {
 		glGenVertexArrays(1, &this->VAO);
 		glGenBuffers(1, &this->VBO);
@@ -23,28 +144,155 @@ private:
 
 		glBindVertexArray(this->VAO);
 		glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		if (!this->packedVertices.empty()) {
+			glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), &packedVertices[0], GL_STATIC_DRAW);
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+		}
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		if (vertices.size() <= 65536) {
+			std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+			this->indexType = GL_UNSIGNED_SHORT;
+			this->indexSize = sizeof(unsigned short);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(unsigned short), &shortIndices[0], GL_STATIC_DRAW);
+		}
+		else {
+			this->indexType = GL_UNSIGNED_INT;
+			this->indexSize = sizeof(unsigned int);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		}
+		setupVertexAttributes();
+		glBindVertexArray(0);
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoord));
-		glEnableVertexAttribArray(2);
+		// The culled draw has its own vertex array, its element buffer is filled by cull.cs
+		if (!this->meshlets.empty()) {
+			const MeshLod& lod = this->lods[0];
+			DrawElementsIndirectCommand command = { 0, 1, 0, 0, 0 };
+			glGenBuffers(1, &this->meshletBuffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->meshletBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, this->meshlets.size() * sizeof(Meshlet), &this->meshlets[0], GL_STATIC_DRAW);
+			glGenBuffers(1, &this->meshletIndexBuffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->meshletIndexBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, lod.indexCount * sizeof(unsigned int), &this->indices[lod.indexOffset], GL_STATIC_DRAW);
+			glGenBuffers(1, &this->meshletOffsetBuffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->meshletOffsetBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, this->meshlets.size() * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+			glGenBuffers(1, &this->drawCommandBuffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->drawCommandBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-		glBindVertexArray(0);
+			glGenVertexArrays(1, &this->cullVAO);
+			glGenBuffers(1, &this->visibleIndexBuffer);
+			glBindVertexArray(this->cullVAO);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->visibleIndexBuffer);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, lod.indexCount * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+			setupVertexAttributes();
+			glBindVertexArray(0);
+		}
 	}
-public:
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices) {
-		this->vertices = vertices;
-		this->indices = indices;
-		setupMesh();
+
+	// CPU side geometry for renderers without a GL context
+	const std::vector<Vertex>& getVertices() const {
+		return this->vertices;
+	}
+
+	const std::vector<unsigned int>& getIndices() const {
+		return this->indices;
+	}
+
+	const MeshLod& getCurrentLod() const {
+		return this->lods[this->currentLod];
+	}
+
+	const MeshLod& getLod(unsigned int level) const {
+		return this->lods[level];
+	}
+
+	// Bounding sphere in object space, xyz is the center and w the radius
+	glm::vec4 getBoundingSphere() {
+		return glm::vec4(this->boundingCenter, this->boundingRadius);
+	}
+
+	bool isVisible(const Frustum& objectFrustum) {
+		return objectFrustum.intersectsSphere(this->boundingCenter, this->boundingRadius);
 	}
 
-	void draw() {
+	// Picks the coarsest level of detail whose simplification error projects to less than
+	// maxPixelError pixels. Switching to a coarser level needs some extra headroom so that
+	// meshes sitting right at a threshold don't pop back and forth every frame.
+	// Returns whether the level changed.
+	bool selectLod(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight, float maxPixelError = 1.0f) {
+		const float hysteresis = 0.75f;
+
+		glm::vec3 viewCenter = glm::vec3(modelView * glm::vec4(this->boundingCenter, 1.0f));
+		float scale = std::max(glm::length(glm::vec3(modelView[0])), std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+		float distance = std::max(-viewCenter.z - this->boundingRadius * scale, 1e-4f);
+		// Pixels covered by one object space unit at the nearest point of the bounding sphere
+		float pixelsPerUnit = scale * projection[1][1] * 0.5f * viewportHeight / distance;
+
+		unsigned int desired = 0;
+		for (unsigned int i = 0; i < this->lods.size(); i++) {
+			float limit = i > this->currentLod ? maxPixelError * hysteresis : maxPixelError;
+			if (this->lods[i].error * pixelsPerUnit <= limit) {
+				desired = i;
+			}
+		}
+		bool changed = desired != this->currentLod;
+		this->currentLod = desired;
+		return changed;
+	}
+
+	void setVertexFormatUniforms(ShaderProgram& shader) {
+		// Tell main.vs how to decode the vertices
+		shader.setUniformInt("packedVertices", !this->packedVertices.empty());
+		if (!this->packedVertices.empty()) {
+			shader.setUniformVec3("positionOffset", this->positionOffset);
+			shader.setUniformVec3("positionScale", this->positionScale);
+		}
+	}
+
+	void draw(ShaderProgram& shader) {
+		const MeshLod& lod = this->lods[this->currentLod];
+		setVertexFormatUniforms(shader);
 		glBindVertexArray(this->VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+		glDrawElements(GL_TRIANGLES, lod.indexCount, this->indexType, (void*)((size_t)lod.indexOffset * this->indexSize));
+	}
+
+	// Only the full detail level is split into meshlets
+	bool canCullMeshlets() {
+		return !this->meshlets.empty() && this->currentLod == 0;
+	}
+
+	// Culls the meshlets with cullShader (cull.cs) and draws the surviving triangles indirectly, without
+	// reading anything back. The triangles keep their order, a prefix sum over the visible meshlets
+	// gives every one its place. objectFrustum is in this mesh's object space.
+	void drawCulled(ShaderProgram& shader, ShaderProgram& cullShader, const Frustum& objectFrustum) {
+		cullShader.use();
+		cullShader.setUniformVec4Array("frustumPlanes", 6, objectFrustum.planes);
+		cullShader.setUniformUint("meshletCount", (unsigned int)this->meshlets.size());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->meshletBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->meshletIndexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->visibleIndexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, this->drawCommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, this->meshletOffsetBuffer);
+		// Visibility and offsets in a single work group, then the copy with one group per meshlet
+		cullShader.setUniformUint("cullPass", 0);
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		cullShader.setUniformUint("cullPass", 1);
+		// Dispatches are limited to 65535 work groups per dimension
+		unsigned int groupsX = std::min((unsigned int)this->meshlets.size(), 65535u);
+		unsigned int groupsY = ((unsigned int)this->meshlets.size() + groupsX - 1) / groupsX;
+		glDispatchCompute(groupsX, groupsY, 1);
+		glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+		shader.use();
+		setVertexFormatUniforms(shader);
+		glBindVertexArray(this->cullVAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->drawCommandBuffer);
+		glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 	}
 };
\ No newline at end of file
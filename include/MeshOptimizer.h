@@ -0,0 +1,377 @@
+#pragma once
+
+#include <Mesh.h>
+#include <JobSystem.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// Post-transform vertex cache efficiency of an index buffer, measured with a FIFO cache
+//	ACMR: average cache misses per triangle, 0.5 is the best case on large regular meshes, 3.0 the worst
+//	ATVR: average transformed vertices per referenced vertex, 1.0 is optimal
+struct VertexCacheStatistics {
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+inline VertexCacheStatistics analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16) {
+	VertexCacheStatistics statistics;
+	if (indexCount == 0) {
+		return statistics;
+	}
+
+	// Each vertex remembers when it entered the FIFO, it's still cached while fewer than cacheSize misses happened since
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int misses = 0;
+	unsigned int uniqueVertices = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		unsigned int v = indices[i];
+		if (timestamp - cacheTimestamps[v] > cacheSize) {
+			cacheTimestamps[v] = timestamp++;
+			misses++;
+		}
+		if (!referenced[v]) {
+			referenced[v] = true;
+			uniqueVertices++;
+		}
+	}
+
+	statistics.acmr = (float)misses / (float)(indexCount / 3);
+	statistics.atvr = (float)misses / (float)uniqueVertices;
+	return statistics;
+}
+
+// Reorders triangles for the post-transform vertex cache with Tipsify (Sander, Nehab and Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007), then groups them into
+// clusters that are sorted front-to-back from the mesh's outside in so that heavy fragment shading
+// is rejected by early depth testing more often.
+inline void optimizeVertexCacheAndOverdraw(
+	unsigned int* indices,
+	size_t indexCount,
+	const std::vector<Vertex>& vertices,
+	unsigned int cacheSize = 16,
+	float overdrawThreshold = 1.05f
+) {
+	size_t vertexCount = vertices.size();
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// Vertex -> triangle adjacency and the number of not yet emitted triangles per vertex
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < indexCount; i++) {
+		liveTriangles[indices[i]]++;
+	}
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++) {
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+	}
+	std::vector<unsigned int> adjacency(indexCount);
+	{
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indexCount; i++) {
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+	}
+
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> order;
+	order.reserve(triangleCount);
+	// Triangles at which the cache had to be restarted from an arbitrary vertex
+	std::vector<unsigned int> hardBoundaries;
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int cursor = 0;
+	int fanningVertex = indices[0];
+
+	while (fanningVertex >= 0) {
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (unsigned int a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++) {
+			unsigned int triangle = adjacency[a];
+			if (emitted[triangle]) {
+				continue;
+			}
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = indices[triangle * 3 + k];
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (timestamp - cacheTimestamps[v] > cacheSize) {
+					cacheTimestamps[v] = timestamp++;
+				}
+			}
+			emitted[triangle] = true;
+			order.push_back(triangle);
+		}
+
+		// Continue with the candidate that will still be in the cache after its remaining triangles are emitted
+		int next = -1;
+		int bestPriority = -1;
+		for (size_t c = 0; c < candidates.size(); c++) {
+			unsigned int v = candidates[c];
+			if (liveTriangles[v] == 0) {
+				continue;
+			}
+			int priority = 0;
+			if (timestamp - cacheTimestamps[v] + 2 * liveTriangles[v] <= cacheSize) {
+				priority = timestamp - cacheTimestamps[v];
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		// Dead end, backtrack through recently used vertices and finally fall back to input order
+		if (next == -1) {
+			while (!deadEnds.empty() && next == -1) {
+				unsigned int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[v] > 0) {
+					next = v;
+				}
+			}
+			while (next == -1 && cursor < indexCount) {
+				unsigned int v = indices[cursor++];
+				if (liveTriangles[v] > 0) {
+					next = v;
+					hardBoundaries.push_back((unsigned int)order.size());
+				}
+			}
+		}
+		fanningVertex = next;
+	}
+
+	std::vector<unsigned int> reordered(indexCount);
+	for (size_t t = 0; t < triangleCount; t++) {
+		reordered[t * 3 + 0] = indices[order[t] * 3 + 0];
+		reordered[t * 3 + 1] = indices[order[t] * 3 + 1];
+		reordered[t * 3 + 2] = indices[order[t] * 3 + 2];
+	}
+
+	// Split the cache-ordered triangles into clusters. Besides the hard boundaries, a cluster is also ended
+	// wherever its own ACMR is already within the threshold of the whole mesh's, so reordering clusters
+	// later costs at most that much vertex cache efficiency.
+	float meshAcmr = analyzeVertexCache(reordered.data(), indexCount, vertexCount, cacheSize).acmr;
+	std::vector<unsigned int> clusterStarts;
+	{
+		std::fill(cacheTimestamps.begin(), cacheTimestamps.end(), 0);
+		timestamp = cacheSize + 1;
+		size_t nextHardBoundary = 0;
+		unsigned int clusterMisses = 0;
+		unsigned int clusterTriangles = 0;
+		for (unsigned int t = 0; t < triangleCount; t++) {
+			bool hardBoundary = nextHardBoundary < hardBoundaries.size() && hardBoundaries[nextHardBoundary] == t;
+			if (hardBoundary) {
+				nextHardBoundary++;
+			}
+			bool softBoundary = clusterTriangles >= 8 && (float)clusterMisses / clusterTriangles <= meshAcmr * overdrawThreshold;
+			if (t == 0 || hardBoundary || softBoundary) {
+				clusterStarts.push_back(t);
+				clusterMisses = 0;
+				clusterTriangles = 0;
+				// Clusters may end up anywhere, so each one is measured starting from an empty cache
+				timestamp += cacheSize + 1;
+			}
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = reordered[t * 3 + k];
+				if (timestamp - cacheTimestamps[v] > cacheSize) {
+					cacheTimestamps[v] = timestamp++;
+					clusterMisses++;
+				}
+			}
+			clusterTriangles++;
+		}
+		clusterStarts.push_back((unsigned int)triangleCount);
+	}
+
+	// Sort clusters so that the ones facing away from the mesh centroid the most are drawn first
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	for (size_t i = 0; i < indexCount; i++) {
+		meshCentroid += vertices[reordered[i]].position;
+	}
+	meshCentroid /= (float)indexCount;
+
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<float> clusterSortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (unsigned int t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			glm::vec3 p0 = vertices[reordered[t * 3 + 0]].position;
+			glm::vec3 p1 = vertices[reordered[t * 3 + 1]].position;
+			glm::vec3 p2 = vertices[reordered[t * 3 + 2]].position;
+			glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(triangleNormal);
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+		float normalLength = glm::length(normal);
+		if (area <= 0.0f || normalLength <= 0.0f) {
+			clusterSortKeys[c] = 0.0f;
+			continue;
+		}
+		clusterSortKeys[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+	}
+	std::vector<unsigned int> clusterOrder(clusterCount);
+	for (unsigned int c = 0; c < clusterCount; c++) {
+		clusterOrder[c] = c;
+	}
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](unsigned int l, unsigned int r) {
+		return clusterSortKeys[l] > clusterSortKeys[r];
+	});
+
+	size_t write = 0;
+	for (size_t c = 0; c < clusterCount; c++) {
+		unsigned int cluster = clusterOrder[c];
+		for (unsigned int i = clusterStarts[cluster] * 3; i < clusterStarts[cluster + 1] * 3; i++) {
+			indices[write++] = reordered[i];
+		}
+	}
+}
+
+// Reorders the vertex buffer in the order vertices are first referenced by the index buffer so that
+// vertex fetches walk memory linearly. Vertices that aren't referenced at all are dropped.
+inline void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertices.size(), unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused) {
+			newIndex = (unsigned int)reordered.size();
+			reordered.push_back(vertices[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+	vertices.swap(reordered);
+}
+
+// Welds vertices whose position, normal and texture coordinate are equal after quantisation and rewrites
+// the index buffer to reference the welded vertices. Unindexed formats such as STL arrive with three unique
+// vertices per triangle, this brings them down to roughly one per position. The first vertex of every
+// group is kept as is, so welding never moves a vertex that had no duplicates.
+//	Positions are quantised to 2^-20 of the mesh's extent, normals and texture coordinates to 2^-12
+inline void weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	struct VertexKey {
+		int values[8];
+		bool operator== (const VertexKey& o) const {
+			return memcmp(this->values, o.values, sizeof(this->values)) == 0;
+		}
+	};
+	size_t vertexCount = vertices.size();
+	if (vertexCount == 0) {
+		return;
+	}
+
+	glm::vec3 minimum = vertices[0].position;
+	glm::vec3 maximum = vertices[0].position;
+	for (size_t i = 0; i < vertexCount; i++) {
+		minimum = glm::min(minimum, vertices[i].position);
+		maximum = glm::max(maximum, vertices[i].position);
+	}
+	glm::vec3 extent = maximum - minimum;
+	float positionScale = (float)(1 << 20) / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+	const float attributeScale = (float)(1 << 12);
+
+	// The per vertex loops are cheap, they're split into pieces of a few thousand vertices
+	JobSystem& jobs = JobSystem::shared();
+	const size_t grainSize = 4096;
+	unsigned int threadCount = std::max(1u, std::min(jobs.getThreadCount(), (unsigned int)(vertexCount / 16384 + 1)));
+
+	// Quantise and hash every vertex
+	std::vector<VertexKey> keys(vertexCount);
+	std::vector<unsigned int> hashes(vertexCount);
+	jobs.parallelFor(vertexCount, grainSize, [&](size_t i) {
+		const Vertex& v = vertices[i];
+		glm::vec3 p = (v.position - minimum) * positionScale;
+		VertexKey& key = keys[i];
+		key.values[0] = (int)std::floor(p.x + 0.5f);
+		key.values[1] = (int)std::floor(p.y + 0.5f);
+		key.values[2] = (int)std::floor(p.z + 0.5f);
+		key.values[3] = (int)std::floor(v.normal.x * attributeScale + 0.5f);
+		key.values[4] = (int)std::floor(v.normal.y * attributeScale + 0.5f);
+		key.values[5] = (int)std::floor(v.normal.z * attributeScale + 0.5f);
+		key.values[6] = (int)std::floor(v.textureCoord.x * attributeScale + 0.5f);
+		key.values[7] = (int)std::floor(v.textureCoord.y * attributeScale + 0.5f);
+		// FNV-1a over the quantised key
+		unsigned int hash = 2166136261u;
+		const unsigned char* bytes = (const unsigned char*)key.values;
+		for (size_t b = 0; b < sizeof(key.values); b++) {
+			hash = (hash ^ bytes[b]) * 16777619u;
+		}
+		hashes[i] = hash;
+	});
+
+	// Every thread owns the vertices of one hash partition and finds, with its own open-addressing table,
+	// the first vertex of each group of equal keys. Partitions are disjoint so no synchronisation is needed
+	// and the result doesn't depend on the thread count.
+	const unsigned int empty = ~0u;
+	std::vector<unsigned int> representative(vertexCount);
+	std::vector<size_t> partitionSizes(threadCount, 0);
+	for (size_t i = 0; i < vertexCount; i++) {
+		partitionSizes[hashes[i] % threadCount]++;
+	}
+	jobs.parallelFor(threadCount, 1, [&](size_t partition) {
+		size_t capacity = 1;
+		while (capacity < partitionSizes[partition] * 2) {
+			capacity *= 2;
+		}
+		std::vector<unsigned int> table(capacity, empty);
+		for (size_t i = 0; i < vertexCount; i++) {
+			if (hashes[i] % threadCount != partition) {
+				continue;
+			}
+			// Linear probing, the high bits are used as the partition already consumed the low ones
+			size_t slot = (hashes[i] >> 8) & (capacity - 1);
+			while (table[slot] != empty && !(keys[table[slot]] == keys[i])) {
+				slot = (slot + 1) & (capacity - 1);
+			}
+			if (table[slot] == empty) {
+				table[slot] = (unsigned int)i;
+			}
+			representative[i] = table[slot];
+		}
+	});
+
+	// Compact the representatives, keeping their original order
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<Vertex> welded;
+	for (size_t i = 0; i < vertexCount; i++) {
+		if (representative[i] == i) {
+			remap[i] = (unsigned int)welded.size();
+			welded.push_back(vertices[i]);
+		}
+	}
+	jobs.parallelFor(vertexCount, grainSize, [&](size_t i) {
+		if (representative[i] != i) {
+			remap[i] = remap[representative[i]];
+		}
+	});
+	jobs.parallelFor(indices.size(), grainSize, [&](size_t i) {
+		indices[i] = remap[indices[i]];
+	});
+	vertices.swap(welded);
+
+	// Triangles smaller than the quantisation step collapse, drop them
+	size_t write = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		if (a != b && b != c && c != a) {
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+	}
+	indices.resize(write);
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <Mesh.h>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// Symmetric 4x4 error quadric (Garland & Heckbert) stored as its 10 unique coefficients.
+// The weight is the accumulated triangle area, so evaluate() returns an area-averaged squared distance.
+struct Quadric {
+	double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+	double b2 = 0.0, bc = 0.0, bd = 0.0;
+	double c2 = 0.0, cd = 0.0;
+	double d2 = 0.0;
+	double weight = 0.0;
+
+	static Quadric fromPlane(double a, double b, double c, double d, double w) {
+		Quadric q;
+		q.a2 = w * a * a; q.ab = w * a * b; q.ac = w * a * c; q.ad = w * a * d;
+		q.b2 = w * b * b; q.bc = w * b * c; q.bd = w * b * d;
+		q.c2 = w * c * c; q.cd = w * c * d;
+		q.d2 = w * d * d;
+		q.weight = w;
+		return q;
+	}
+
+	void add(const Quadric& o) {
+		a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+		b2 += o.b2; bc += o.bc; bd += o.bd;
+		c2 += o.c2; cd += o.cd;
+		d2 += o.d2;
+		weight += o.weight;
+	}
+
+	double evaluate(const glm::vec3& p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double error =
+			a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x +
+			b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y +
+			c2 * z * z + 2.0 * cd * z +
+			d2;
+		return weight > 0.0 ? std::fabs(error) / weight : 0.0;
+	}
+};
+
+// Simplifies a triangle list with quadric-error edge collapses until at most targetIndexCount indices remain.
+// Vertices are only ever collapsed onto other existing vertices, so the result is a new index buffer that
+// can share the original vertex buffer. Vertices on open borders or on attribute seams (the same position
+// used by several vertices) are locked so that the silhouette and UV layout are preserved.
+// resultError receives the largest collapse error as an object-space distance.
+inline std::vector<unsigned int> simplifyMesh(
+	const std::vector<Vertex>& vertices,
+	const std::vector<unsigned int>& indices,
+	size_t targetIndexCount,
+	float& resultError
+) {
+	size_t vertexCount = vertices.size();
+	std::vector<unsigned int> result = indices;
+	resultError = 0.0f;
+	if (result.size() <= targetIndexCount || vertexCount == 0) {
+		return result;
+	}
+
+	// Find vertices that share a position with another vertex, these lie on attribute seams
+	std::vector<unsigned int> positionRemap(vertexCount);
+	{
+		struct PositionHash {
+			size_t operator()(const glm::vec3& p) const {
+				unsigned int h[3];
+				memcpy(h, &p, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}
+		};
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> firstWithPosition;
+		firstWithPosition.reserve(vertexCount);
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			positionRemap[i] = firstWithPosition.emplace(vertices[i].position, i).first->second;
+		}
+	}
+	std::vector<bool> locked(vertexCount, false);
+	for (unsigned int i = 0; i < vertexCount; i++) {
+		if (positionRemap[i] != i) {
+			locked[i] = true;
+			locked[positionRemap[i]] = true;
+		}
+	}
+
+	// Lock vertices on open borders, i.e. edges that are used by only one triangle
+	{
+		std::unordered_map<unsigned long long, int> edgeUses;
+		edgeUses.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				unsigned long long a = positionRemap[result[i + e]];
+				unsigned long long b = positionRemap[result[i + (e + 1) % 3]];
+				edgeUses[a < b ? (a << 32) | b : (b << 32) | a]++;
+			}
+		}
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				unsigned int a = result[i + e];
+				unsigned int b = result[i + (e + 1) % 3];
+				unsigned long long pa = positionRemap[a];
+				unsigned long long pb = positionRemap[b];
+				if (edgeUses[pa < pb ? (pa << 32) | pb : (pb << 32) | pa] == 1) {
+					locked[a] = true;
+					locked[b] = true;
+				}
+			}
+		}
+	}
+
+	// Accumulate the plane quadric of every triangle into its vertices
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		glm::dvec3 p0 = vertices[result[i]].position;
+		glm::dvec3 p1 = vertices[result[i + 1]].position;
+		glm::dvec3 p2 = vertices[result[i + 2]].position;
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double area = glm::length(normal);
+		if (area <= 0.0) {
+			continue;
+		}
+		normal /= area;
+		Quadric q = Quadric::fromPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0), area * 0.5);
+		quadrics[result[i]].add(q);
+		quadrics[result[i + 1]].add(q);
+		quadrics[result[i + 2]].add(q);
+	}
+
+	struct Collapse {
+		unsigned int from;
+		unsigned int to;
+		double error;
+	};
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> triangleOffsets(vertexCount + 1);
+	std::vector<unsigned int> vertexTriangles;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	double maxError = 0.0;
+
+	while (result.size() > targetIndexCount) {
+		// Rebuild vertex -> triangle adjacency for the flip checks
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (size_t i = 0; i < result.size(); i++) {
+			triangleOffsets[result[i] + 1]++;
+		}
+		for (size_t i = 0; i < vertexCount; i++) {
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		}
+		vertexTriangles.resize(result.size());
+		{
+			std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++) {
+				vertexTriangles[fill[result[i]]++] = (unsigned int)(i / 3);
+			}
+		}
+
+		// Gather every candidate collapse along triangle edges and order them by error
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				unsigned int a = result[i + e];
+				unsigned int b = result[i + (e + 1) % 3];
+				Quadric q = quadrics[a];
+				q.add(quadrics[b]);
+				if (!locked[a]) {
+					collapses.push_back(Collapse{ a, b, q.evaluate(vertices[b].position) });
+				}
+				if (!locked[b]) {
+					collapses.push_back(Collapse{ b, a, q.evaluate(vertices[a].position) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) {
+			return l.error < r.error;
+		});
+
+		// Greedily apply independent collapses, each one removes roughly two triangles
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			remap[i] = i;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+		size_t collapseBudget = std::max<size_t>((result.size() - targetIndexCount) / 6, 1);
+		size_t collapsed = 0;
+		for (size_t c = 0; c < collapses.size() && collapsed < collapseBudget; c++) {
+			const Collapse& collapse = collapses[c];
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+
+			// Reject the collapse if any remaining triangle around the source vertex would flip
+			bool flips = false;
+			glm::vec3 target = vertices[collapse.to].position;
+			for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; t++) {
+				const unsigned int* tri = &result[vertexTriangles[t] * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) {
+					continue;
+				}
+				glm::vec3 p[3], q[3];
+				for (int k = 0; k < 3; k++) {
+					p[k] = vertices[tri[k]].position;
+					q[k] = tri[k] == collapse.from ? target : p[k];
+				}
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				flips = glm::dot(before, after) <= 0.0f;
+			}
+			if (flips) {
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			maxError = std::max(maxError, collapse.error);
+			collapsed++;
+			// Neighbours keep their current position this pass so the flip checks above stay valid
+			for (unsigned int t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++) {
+				const unsigned int* tri = &result[vertexTriangles[t] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		}
+		if (collapsed == 0) {
+			break;
+		}
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			unsigned int a = remap[result[i]];
+			unsigned int b = remap[result[i + 1]];
+			unsigned int c = remap[result[i + 2]];
+			if (a != b && b != c && c != a) {
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+		result.resize(write);
+	}
+
+	resultError = (float)std::sqrt(maxError);
+	return result;
+}
+
+// Builds up to maxLevels levels of detail for a mesh. LOD 0 is the original index buffer and every
+// following level halves the triangle count of the previous one. All levels are concatenated into
+// indices and described by the returned MeshLod ranges.
+inline std::vector<MeshLod> buildLodChain(
+	const std::vector<Vertex>& vertices,
+	std::vector<unsigned int>& indices,
+	int maxLevels = 5
+) {
+	std::vector<MeshLod> lods;
+	lods.push_back(MeshLod{ 0, (unsigned int)indices.size(), 0.0f });
+
+	// Small meshes are cheap enough already
+	if (indices.size() < 3 * 256) {
+		return lods;
+	}
+
+	std::vector<unsigned int> previous = indices;
+	float previousError = 0.0f;
+	for (int level = 1; level < maxLevels; level++) {
+		size_t target = (previous.size() / 2) / 3 * 3;
+		float error;
+		std::vector<unsigned int> simplified = simplifyMesh(vertices, previous, target, error);
+		// Stop when the simplifier is stuck on locked vertices or the mesh has become trivially small
+		if (simplified.size() > previous.size() * 8 / 10 || simplified.size() < 3 * 16) {
+			break;
+		}
+		// Errors of consecutive levels are measured against the previous level, so they add up
+		previousError += error;
+		lods.push_back(MeshLod{ (unsigned int)indices.size(), (unsigned int)simplified.size(), previousError });
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		previous.swap(simplified);
+	}
+	return lods;
+}
\ No newline at end of file
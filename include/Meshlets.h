@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Vertex.h>
+#include <vector>
+#include <algorithm>
+
+// A small cluster of a mesh's triangles with the bounds used to cull it on the GPU.
+// The layout matches the std430 Meshlet struct in cull.cs.
+struct Meshlet {
+	// xyz is the center of the bounding sphere, w its radius. There is no normal cone, the viewer
+	// draws both sides of every triangle so meshlets are never backface culled.
+	glm::vec4 sphere;
+	unsigned int triangleOffset;
+	unsigned int triangleCount;
+	unsigned int padding[2];
+};
+
+// Greedily splits a triangle list into meshlets of at most maxVertices unique vertices and maxTriangles
+// triangles. Consecutive triangles are grouped together, so the index buffer should already be ordered
+// for vertex locality, and each meshlet refers to a range of triangles in it.
+inline std::vector<Meshlet> buildMeshlets(
+	const std::vector<Vertex>& vertices,
+	const unsigned int* indices,
+	size_t indexCount,
+	unsigned int maxVertices = 64,
+	unsigned int maxTriangles = 124
+) {
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned int> meshletVertices;
+	unsigned int start = 0;
+	auto finishMeshlet = [&](unsigned int end) {
+		if (end == start) {
+			return;
+		}
+		Meshlet meshlet;
+		meshlet.triangleOffset = start;
+		meshlet.triangleCount = end - start;
+		meshlet.padding[0] = meshlet.padding[1] = 0;
+
+		// Bounding sphere around the meshlet's bounding box
+		glm::vec3 minimum = vertices[meshletVertices[0]].position;
+		glm::vec3 maximum = minimum;
+		for (size_t i = 0; i < meshletVertices.size(); i++) {
+			minimum = glm::min(minimum, vertices[meshletVertices[i]].position);
+			maximum = glm::max(maximum, vertices[meshletVertices[i]].position);
+		}
+		glm::vec3 center = (minimum + maximum) * 0.5f;
+		float radius = 0.0f;
+		for (size_t i = 0; i < meshletVertices.size(); i++) {
+			radius = std::max(radius, glm::length(vertices[meshletVertices[i]].position - center));
+		}
+		meshlet.sphere = glm::vec4(center, radius);
+
+		meshlets.push_back(meshlet);
+		meshletVertices.clear();
+		start = end;
+	};
+
+	maxTriangles = std::min(maxTriangles, 128u);
+	size_t triangleCount = indexCount / 3;
+	for (unsigned int t = 0; t < triangleCount; t++) {
+		unsigned int newVertices = 0;
+		for (int k = 0; k < 3; k++) {
+			if (std::find(meshletVertices.begin(), meshletVertices.end(), indices[t * 3 + k]) == meshletVertices.end()) {
+				newVertices++;
+			}
+		}
+		if (meshletVertices.size() + newVertices > maxVertices || t - start >= maxTriangles) {
+			finishMeshlet(t);
+		}
+		for (int k = 0; k < 3; k++) {
+			if (std::find(meshletVertices.begin(), meshletVertices.end(), indices[t * 3 + k]) == meshletVertices.end()) {
+				meshletVertices.push_back(indices[t * 3 + k]);
+			}
+		}
+	}
+	finishMeshlet((unsigned int)triangleCount);
+	return meshlets;
+}
\ No newline at end of file
@@ -4,6 +4,13 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <Mesh.h>
+#include <MeshSimplifier.h>
+#include <MeshOptimizer.h>
+#include <TangentSpace.h>
+#include <JobSystem.h>
+#include <memory>
+#include <cfloat>
+#include <cassert>
 
 class Model {
 private:
@@ -25,20 +32,41 @@ private:
 		std::cout << "	6. Textures: " << scene->mNumTextures << std::endl;
 		std::cout << std::endl;
 
-		processNode(scene->mRootNode, scene);
+		// Meshes are processed (and simplified) as one job each, then uploaded on this thread which owns the
+		// GL context. Their own loops are jobs too, so a single big mesh still uses every thread.
+		std::vector<aiMesh*> sceneMeshes;
+		processNode(scene->mRootNode, scene, sceneMeshes);
+		std::vector<std::unique_ptr<Mesh>> processed(sceneMeshes.size());
+		std::vector<VertexCacheStatistics> cacheBefore(sceneMeshes.size()), cacheAfter(sceneMeshes.size());
+		JobSystem::shared().parallelFor(sceneMeshes.size(), 1, [&](size_t i) {
+			processed[i].reset(new Mesh(processMesh(sceneMeshes[i], scene, &cacheBefore[i], &cacheAfter[i])));
+		});
+		for (int i = 0; i < processed.size(); i++) {
+			this->meshes.push_back(std::move(*processed[i]));
+			if (this->uploadToGpu) {
+				this->meshes.back().setupMesh();
+			}
+		}
+
+		std::cout << "Vertex cache optimization (ACMR / ATVR, 16 entry FIFO): " << std::endl;
+		for (int i = 0; i < sceneMeshes.size(); i++) {
+			std::cout << "	Mesh " << i + 1 << ": "
+				<< cacheBefore[i].acmr << " / " << cacheBefore[i].atvr << " -> "
+				<< cacheAfter[i].acmr << " / " << cacheAfter[i].atvr << std::endl;
+		}
+		std::cout << std::endl;
 	}
 
-	void processNode(aiNode* node, const aiScene* scene) {
+	void processNode(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& sceneMeshes) {
 		for (int i = 0; i < node->mNumMeshes; i++) {
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			this->meshes.push_back(processMesh(mesh, scene));
+			sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
 		}
 		for (int i = 0; i < node->mNumChildren; i++) {
-			processNode(node->mChildren[i], scene);
+			processNode(node->mChildren[i], scene, sceneMeshes);
 		}
 	}
 
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
+	Mesh processMesh(aiMesh* mesh, const aiScene* scene, VertexCacheStatistics* cacheBefore, VertexCacheStatistics* cacheAfter) {
 		// Get all positions, normals and texture coordinates
 		std::vector<Vertex> vertices;
 		for (int i = 0; i < mesh->mNumVertices; i++) {
@@ -78,18 +106,152 @@ private:
 		// Get all materials
 		// TODO
 
-		return Mesh(vertices, indices);
+		// Merge duplicated vertices of unindexed formats
+		weldVertices(vertices, indices);
+
+		// Tangent frames for normal mapping, this may split vertices on mirrored UVs
+		generateTangents(vertices, indices);
+
+		// Generate the simplified levels of detail
+		std::vector<MeshLod> lods = buildLodChain(vertices, indices);
+
+		// Reorder every level for the vertex cache and overdraw, then the vertex buffer for fetch locality
+		*cacheBefore = analyzeVertexCache(&indices[0], lods[0].indexCount, vertices.size());
+		for (int i = 0; i < lods.size(); i++) {
+			optimizeVertexCacheAndOverdraw(&indices[lods[i].indexOffset], lods[i].indexCount, vertices);
+		}
+		optimizeVertexFetch(vertices, indices);
+		*cacheAfter = analyzeVertexCache(&indices[0], lods[0].indexCount, vertices.size());
+
+		// Split big meshes into clusters for GPU culling
+		std::vector<Meshlet> meshlets;
+		if (lods[0].indexCount >= 3 * 4096) {
+			meshlets = buildMeshlets(vertices, &indices[0], lods[0].indexCount);
+		}
+
+		return Mesh(vertices, indices, lods, meshlets, this->compactVertices);
 	}
 
 public:
 	std::vector<Mesh> meshes;
-	Model(const char* path) {
+	// Whether meshes should use the compact PackedVertex format where possible
+	bool compactVertices;
+	// Incremented whenever the drawn geometry changes, i.e. a mesh switches its level of detail
+	unsigned int geometryVersion = 0;
+	// Whether the meshes were uploaded, models for the CPU renderers are loaded without a GL context
+	bool uploadToGpu;
+
+	Model(const char* path, bool compactVertices = false, bool uploadToGpu = true) {
+		this->compactVertices = compactVertices;
+		this->uploadToGpu = uploadToGpu;
 		loadModel(path);
 	}
 
-	void draw() {
+	// Uploads a model that was loaded with uploadToGpu = false, e.g. on a thread without the GL
+	// context. Must be called on the thread owning it.
+	void setupMeshes() {
+		if (this->uploadToGpu) {
+			return;
+		}
+		for (int i = 0; i < this->meshes.size(); i++) {
+			this->meshes[i].setupMesh();
+		}
+		this->uploadToGpu = true;
+	}
+
+	// Picks every mesh's level of detail for the camera without drawing anything
+	void selectLods(const glm::mat4& model, const Camera& camera) {
+		glm::mat4 modelView = camera.view * model;
+		for (int i = 0; i < this->meshes.size(); i++) {
+			if (meshes[i].selectLod(modelView, camera.projection, camera.viewportHeight)) {
+				this->geometryVersion++;
+			}
+		}
+	}
+
+	// Draws every mesh inside the camera's frustum at the level of detail suited to its size on screen.
+	// If a cull shader is given, big meshes are additionally culled per meshlet on the GPU.
+	void draw(ShaderProgram& shader, const glm::mat4& model, const Camera& camera, ShaderProgram* cullShader = NULL) {
+		glm::mat4 modelView = camera.view * model;
+		Frustum objectFrustum = Frustum(camera.projection * modelView);
+		for (int i = 0; i < this->meshes.size(); i++) {
+			if (!meshes[i].isVisible(objectFrustum)) {
+				continue;
+			}
+			if (meshes[i].selectLod(modelView, camera.projection, camera.viewportHeight)) {
+				this->geometryVersion++;
+			}
+			if (cullShader && meshes[i].canCullMeshlets()) {
+				meshes[i].drawCulled(shader, *cullShader, objectFrustum);
+			}
+			else {
+				meshes[i].draw(shader);
+			}
+		}
+	}
+
+	// Depth only draw for shadow maps. Meshes outside the light's frustum are skipped and the others
+	// use the level of detail picked for the camera, so no extra LOD selection is needed per light.
+	void drawDepth(ShaderProgram& shader, const glm::mat4& model, const glm::mat4& lightViewProjection) {
+		Frustum objectFrustum = Frustum(lightViewProjection * model);
+		for (int i = 0; i < this->meshes.size(); i++) {
+			if (meshes[i].isVisible(objectFrustum)) {
+				meshes[i].draw(shader);
+			}
+		}
+	}
+
+	// Bit i of the result is set if any mesh intersects the frustum of viewProjections[i]
+	unsigned int findOccupiedFrustums(const glm::mat4& model, const glm::mat4* viewProjections, int count) {
+		unsigned int occupied = 0;
+		for (int f = 0; f < count; f++) {
+			Frustum objectFrustum = Frustum(viewProjections[f] * model);
+			for (int i = 0; i < this->meshes.size() && !(occupied & (1u << f)); i++) {
+				if (meshes[i].isVisible(objectFrustum)) {
+					occupied |= 1u << f;
+				}
+			}
+		}
+		return occupied;
+	}
+
+	// Depth only draw into several layers at once (see shadowcube.gs). Every mesh is only sent to the
+	// layers in layerMask whose frustum it intersects, through the shader's faceMask uniform.
+	void drawDepthLayered(ShaderProgram& shader, const glm::mat4& model, const glm::mat4* viewProjections, int count, unsigned int layerMask) {
+		// One layer per bit of layerMask, at most 32
+		assert(count <= 32 && "drawDepthLayered takes at most 32 layers, one per bit of layerMask");
+		Frustum objectFrustums[32];
+		for (int f = 0; f < count; f++) {
+			objectFrustums[f] = Frustum(viewProjections[f] * model);
+		}
+		for (int i = 0; i < this->meshes.size(); i++) {
+			unsigned int meshMask = 0;
+			for (int f = 0; f < count; f++) {
+				if ((layerMask & (1u << f)) && meshes[i].isVisible(objectFrustums[f])) {
+					meshMask |= 1u << f;
+				}
+			}
+			if (meshMask) {
+				shader.setUniformInt("faceMask", meshMask);
+				meshes[i].draw(shader);
+			}
+		}
+	}
+
+	// World space sphere around all meshes, xyz is the center and w the radius
+	glm::vec4 getBoundingSphere(const glm::mat4& model) {
+		if (this->meshes.empty()) {
+			return glm::vec4(glm::vec3(model[3]), 0.0f);
+		}
+		glm::vec3 minimum = glm::vec3(FLT_MAX), maximum = glm::vec3(-FLT_MAX);
 		for (int i = 0; i < this->meshes.size(); i++) {
-			meshes[i].draw();
+			glm::vec4 sphere = meshes[i].getBoundingSphere();
+			minimum = glm::min(minimum, glm::vec3(sphere) - sphere.w);
+			maximum = glm::max(maximum, glm::vec3(sphere) + sphere.w);
 		}
+		glm::vec3 center = (minimum + maximum) * 0.5f;
+		float radius = glm::length(maximum - center);
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		return glm::vec4(glm::vec3(model * glm::vec4(center, 1.0f)), radius * scale);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,824 @@
+#pragma once
+
+#include <Model.h>
+#include <Light.h>
+#include <Environment.h>
+#include <SoftwareTexture.h>
+#include <JobSystem.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <cassert>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PATH_TRACER_SSE 1
+#endif
+
+// Progressive path tracer used as ground truth for the rasterized PBR shading. It shares the
+// materials (the 5 maps of main.fs) and the light definitions of the viewer:
+//	- All triangles of the full detail level are put in a bounding volume hierarchy built with
+//	  the surface area heuristic.
+//	- Camera rays are traced as 2x2 packets with SSE, bounces and shadow rays one at a time.
+//	- Every bounce samples all lights directly with a shadow ray (next-event estimation) and then
+//	  continues along a sample of the GGX or diffuse lobe. Rays escaping after a bounce see the
+//	  environment if one is loaded.
+//	- Samples are accumulated into an HDR buffer, one pass over 16x16 tiles at a time.
+// Unlike main.fs the distribution term uses the halfway vector, and the AO map and ambient probe
+// are left out since the bounced light is actually traced.
+class PathTracer {
+public:
+	static const int TILE_SIZE = 16;
+	static const int MAX_BOUNCES = 8;
+
+private:
+	static const int LEAF_TRIANGLES = 4;
+	static const int SAH_BINS = 12;
+	// Nodes waiting in a traversal's stack. A traversal holds at most one node per level of the
+	// path it's on plus two children, so the tree is at most TRAVERSAL_STACK_SIZE - 2 levels deep.
+	static const int TRAVERSAL_STACK_SIZE = 64;
+	static const unsigned int MAX_DEPTH = TRAVERSAL_STACK_SIZE - 2;
+	// Halving fewer than 2^31 triangles this many times fits them into leaves of 0xFFFF
+	static const unsigned int MEDIAN_SPLIT_LEVELS = 16;
+
+	struct BvhNode {
+		glm::vec3 minimum;
+		// First triangle of a leaf, or the left child of an inner node (the right one follows it)
+		unsigned int offset;
+		glm::vec3 maximum;
+		unsigned short count;
+		unsigned short axis;
+	};
+
+	// Precomputed for Moller-Trumbore intersection
+	struct Triangle {
+		glm::vec3 v0, edge1, edge2;
+	};
+
+	struct WorldVertex {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec3 tangent;
+		float bitangentSign;
+		glm::vec2 textureCoord;
+	};
+
+	struct Hit {
+		float t;
+		float u, v;
+		unsigned int triangle;
+	};
+
+	// PCG hash based generator, seeded per pixel and pass so that images don't depend on scheduling
+	struct Random {
+		unsigned int state;
+
+		Random(unsigned int pixel, unsigned int pass) {
+			this->state = hash(pixel ^ hash(pass + 0x9E3779B9u));
+		}
+
+		static unsigned int hash(unsigned int x) {
+			unsigned int state = x * 747796405u + 2891336453u;
+			unsigned int word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+			return (word >> 22) ^ word;
+		}
+
+		float next() {
+			this->state = hash(this->state);
+			return (this->state >> 8) * (1.0f / 16777216.0f);
+		}
+	};
+
+	struct Material {
+		glm::vec3 albedo;
+		float metallic;
+		float roughness;
+		glm::vec3 normal;
+		glm::vec3 geometricNormal;
+	};
+
+	int width, height;
+	int tilesX, tilesY;
+	// Shared, unless a thread count was asked for
+	std::unique_ptr<JobSystem> ownJobs;
+	JobSystem* jobs;
+
+	std::vector<BvhNode> nodes;
+	std::vector<Triangle> triangles;
+	// Vertices of every triangle in BVH order
+	std::vector<unsigned int> triangleVertices;
+	std::vector<WorldVertex> vertices;
+	float sceneRadius = 1.0f;
+
+	glm::mat4 inverseViewProjection;
+	const SoftwareTexture* textures = NULL;
+	std::vector<PointLight> pointLights;
+	DirectionalLight dirLight;
+	std::vector<SpotLight> spotlights;
+	const Environment* environment = NULL;
+
+	std::vector<glm::vec3> accumulation;
+	unsigned int sampleCount = 0;
+
+	// Bounding volume hierarchy
+	struct BuildReference {
+		glm::vec3 minimum, maximum, centroid;
+		unsigned int triangle;
+	};
+
+	static float surfaceArea(const glm::vec3& minimum, const glm::vec3& maximum) {
+		glm::vec3 extent = glm::max(maximum - minimum, glm::vec3(0.0f));
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+
+	// Splits references [first, first + count) at the cheapest of SAH_BINS planes per axis, or
+	// makes a leaf when no split is cheaper than intersecting every triangle. The last
+	// MEDIAN_SPLIT_LEVELS levels above MAX_DEPTH only split leaves that are too big, in the middle.
+	void buildNode(unsigned int nodeIndex, std::vector<BuildReference>& references, unsigned int first, unsigned int count, unsigned int depth) {
+		glm::vec3 minimum = glm::vec3(FLT_MAX), maximum = glm::vec3(-FLT_MAX);
+		glm::vec3 centroidMinimum = glm::vec3(FLT_MAX), centroidMaximum = glm::vec3(-FLT_MAX);
+		for (unsigned int i = first; i < first + count; i++) {
+			minimum = glm::min(minimum, references[i].minimum);
+			maximum = glm::max(maximum, references[i].maximum);
+			centroidMinimum = glm::min(centroidMinimum, references[i].centroid);
+			centroidMaximum = glm::max(centroidMaximum, references[i].centroid);
+		}
+		this->nodes[nodeIndex].minimum = minimum;
+		this->nodes[nodeIndex].maximum = maximum;
+		this->nodes[nodeIndex].offset = first;
+		this->nodes[nodeIndex].count = (unsigned short)count;
+		this->nodes[nodeIndex].axis = 0;
+		if (count <= LEAF_TRIANGLES) {
+			return;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestAxis = -1, bestSplit = 0;
+		bool deep = depth >= MAX_DEPTH - MEDIAN_SPLIT_LEVELS;
+		for (int axis = 0; axis < 3 && !deep; axis++) {
+			float extent = centroidMaximum[axis] - centroidMinimum[axis];
+			if (extent <= 0.0f) {
+				continue;
+			}
+			glm::vec3 binMinimum[SAH_BINS], binMaximum[SAH_BINS];
+			unsigned int binCount[SAH_BINS];
+			for (int b = 0; b < SAH_BINS; b++) {
+				binMinimum[b] = glm::vec3(FLT_MAX);
+				binMaximum[b] = glm::vec3(-FLT_MAX);
+				binCount[b] = 0;
+			}
+			for (unsigned int i = first; i < first + count; i++) {
+				int b = std::min(SAH_BINS - 1, (int)((references[i].centroid[axis] - centroidMinimum[axis]) / extent * SAH_BINS));
+				binMinimum[b] = glm::min(binMinimum[b], references[i].minimum);
+				binMaximum[b] = glm::max(binMaximum[b], references[i].maximum);
+				binCount[b]++;
+			}
+			// Sweep from the right to get the cost of every right side, then from the left
+			float rightArea[SAH_BINS];
+			unsigned int rightCount[SAH_BINS];
+			glm::vec3 sweepMinimum = glm::vec3(FLT_MAX), sweepMaximum = glm::vec3(-FLT_MAX);
+			unsigned int sweepCount = 0;
+			for (int b = SAH_BINS - 1; b > 0; b--) {
+				sweepMinimum = glm::min(sweepMinimum, binMinimum[b]);
+				sweepMaximum = glm::max(sweepMaximum, binMaximum[b]);
+				sweepCount += binCount[b];
+				rightArea[b] = surfaceArea(sweepMinimum, sweepMaximum);
+				rightCount[b] = sweepCount;
+			}
+			sweepMinimum = glm::vec3(FLT_MAX);
+			sweepMaximum = glm::vec3(-FLT_MAX);
+			sweepCount = 0;
+			for (int b = 0; b < SAH_BINS - 1; b++) {
+				sweepMinimum = glm::min(sweepMinimum, binMinimum[b]);
+				sweepMaximum = glm::max(sweepMaximum, binMaximum[b]);
+				sweepCount += binCount[b];
+				if (sweepCount == 0 || rightCount[b + 1] == 0) {
+					continue;
+				}
+				float cost = surfaceArea(sweepMinimum, sweepMaximum) * sweepCount + rightArea[b + 1] * rightCount[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+		// Traversing a node costs about one triangle test
+		float leafCost = surfaceArea(minimum, maximum) * count;
+		bool tooBig = count > 0xFFFF;
+		if (bestAxis < 0 || (bestCost + surfaceArea(minimum, maximum) >= leafCost && !tooBig)) {
+			if (!tooBig) {
+				return;
+			}
+			// Identical centroids or too deep for SAH, split in the middle
+			bestAxis = -1;
+		}
+
+		unsigned int middle;
+		if (bestAxis >= 0) {
+			float extent = centroidMaximum[bestAxis] - centroidMinimum[bestAxis];
+			BuildReference* split = std::partition(&references[first], &references[first] + count, [&](const BuildReference& r) {
+				return std::min(SAH_BINS - 1, (int)((r.centroid[bestAxis] - centroidMinimum[bestAxis]) / extent * SAH_BINS)) <= bestSplit;
+			});
+			middle = (unsigned int)(split - &references[0]);
+		}
+		else {
+			middle = first + count / 2;
+		}
+
+		unsigned int left = (unsigned int)this->nodes.size();
+		this->nodes.resize(left + 2);
+		this->nodes[nodeIndex].offset = left;
+		this->nodes[nodeIndex].count = 0;
+		this->nodes[nodeIndex].axis = (unsigned short)std::max(bestAxis, 0);
+		assert(depth < MAX_DEPTH);
+		buildNode(left, references, first, middle - first, depth + 1);
+		buildNode(left + 1, references, middle, first + count - middle, depth + 1);
+	}
+
+	void buildBvh(const std::vector<unsigned int>& sourceVertices) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		unsigned int triangleCount = (unsigned int)(sourceVertices.size() / 3);
+		std::vector<BuildReference> references(triangleCount);
+		for (unsigned int t = 0; t < triangleCount; t++) {
+			const glm::vec3& a = this->vertices[sourceVertices[t * 3]].position;
+			const glm::vec3& b = this->vertices[sourceVertices[t * 3 + 1]].position;
+			const glm::vec3& c = this->vertices[sourceVertices[t * 3 + 2]].position;
+			references[t].minimum = glm::min(a, glm::min(b, c));
+			references[t].maximum = glm::max(a, glm::max(b, c));
+			references[t].centroid = (references[t].minimum + references[t].maximum) * 0.5f;
+			references[t].triangle = t;
+		}
+
+		this->nodes.clear();
+		this->nodes.reserve(triangleCount * 2 + 1);
+		this->nodes.resize(1);
+		buildNode(0, references, 0, triangleCount, 0);
+
+		// Store the triangles in leaf order
+		this->triangles.resize(triangleCount);
+		this->triangleVertices.resize(triangleCount * 3);
+		for (unsigned int i = 0; i < triangleCount; i++) {
+			unsigned int t = references[i].triangle;
+			for (int k = 0; k < 3; k++) {
+				this->triangleVertices[i * 3 + k] = sourceVertices[t * 3 + k];
+			}
+			const glm::vec3& a = this->vertices[sourceVertices[t * 3]].position;
+			this->triangles[i].v0 = a;
+			this->triangles[i].edge1 = this->vertices[sourceVertices[t * 3 + 1]].position - a;
+			this->triangles[i].edge2 = this->vertices[sourceVertices[t * 3 + 2]].position - a;
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Path tracer BVH: " << triangleCount << " triangles, " << this->nodes.size() << " nodes in " << elapsed.count() << " ms" << std::endl;
+	}
+
+	// Single ray traversal
+	static bool intersectBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxT, float& entry) {
+		glm::vec3 t0 = (node.minimum - origin) * inverseDirection;
+		glm::vec3 t1 = (node.maximum - origin) * inverseDirection;
+		glm::vec3 closest = glm::min(t0, t1), farthest = glm::max(t0, t1);
+		entry = std::max(std::max(closest.x, closest.y), std::max(closest.z, 0.0f));
+		float exit = std::min(std::min(farthest.x, farthest.y), std::min(farthest.z, maxT));
+		return entry <= exit;
+	}
+
+	bool intersectTriangle(unsigned int index, const glm::vec3& origin, const glm::vec3& direction, Hit& hit) const {
+		const Triangle& triangle = this->triangles[index];
+		glm::vec3 p = glm::cross(direction, triangle.edge2);
+		float determinant = glm::dot(triangle.edge1, p);
+		if (std::abs(determinant) < 1e-12f) {
+			return false;
+		}
+		float inverse = 1.0f / determinant;
+		glm::vec3 s = origin - triangle.v0;
+		float u = glm::dot(s, p) * inverse;
+		if (u < 0.0f || u > 1.0f) {
+			return false;
+		}
+		glm::vec3 q = glm::cross(s, triangle.edge1);
+		float v = glm::dot(direction, q) * inverse;
+		if (v < 0.0f || u + v > 1.0f) {
+			return false;
+		}
+		float t = glm::dot(triangle.edge2, q) * inverse;
+		if (t <= 0.0f || t >= hit.t) {
+			return false;
+		}
+		hit.t = t;
+		hit.u = u;
+		hit.v = v;
+		hit.triangle = index;
+		return true;
+	}
+
+	// Closest hit, or any hit before hit.t for shadow rays
+	bool trace(const glm::vec3& origin, const glm::vec3& direction, Hit& hit, bool anyHit) const {
+		glm::vec3 inverseDirection = 1.0f / direction;
+		unsigned int stack[TRAVERSAL_STACK_SIZE];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		bool found = false;
+		while (stackSize > 0) {
+			const BvhNode& node = this->nodes[stack[--stackSize]];
+			float entry;
+			if (!intersectBox(node, origin, inverseDirection, hit.t, entry)) {
+				continue;
+			}
+			if (node.count > 0) {
+				for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+					if (intersectTriangle(i, origin, direction, hit)) {
+						found = true;
+						if (anyHit) {
+							return true;
+						}
+					}
+				}
+			}
+			else {
+				// Visit the child on the ray's side of the split first
+				bool reversed = direction[node.axis] < 0.0f;
+				stack[stackSize++] = node.offset + (reversed ? 0 : 1);
+				stack[stackSize++] = node.offset + (reversed ? 1 : 0);
+			}
+		}
+		return found;
+	}
+
+	// Four camera rays traced together, lanes share one traversal and each keeps its own hit
+	void tracePacket(const glm::vec3* origins, const glm::vec3* directions, Hit* hits) const {
+#ifdef PATH_TRACER_SSE
+		float ox[4], oy[4], oz[4], dx[4], dy[4], dz[4], tMax[4];
+		for (int i = 0; i < 4; i++) {
+			ox[i] = origins[i].x;
+			oy[i] = origins[i].y;
+			oz[i] = origins[i].z;
+			dx[i] = directions[i].x;
+			dy[i] = directions[i].y;
+			dz[i] = directions[i].z;
+			tMax[i] = FLT_MAX;
+			hits[i].t = FLT_MAX;
+			hits[i].triangle = 0xFFFFFFFF;
+		}
+		__m128 originX = _mm_loadu_ps(ox), originY = _mm_loadu_ps(oy), originZ = _mm_loadu_ps(oz);
+		__m128 directionX = _mm_loadu_ps(dx), directionY = _mm_loadu_ps(dy), directionZ = _mm_loadu_ps(dz);
+		__m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+		__m128 inverseX = _mm_div_ps(one, directionX), inverseY = _mm_div_ps(one, directionY), inverseZ = _mm_div_ps(one, directionZ);
+		__m128 nearest = _mm_loadu_ps(tMax);
+		__m128 hitU = zero, hitV = zero;
+		__m128i hitTriangle = _mm_set1_epi32(-1);
+
+		unsigned int stack[TRAVERSAL_STACK_SIZE];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const BvhNode& node = this->nodes[stack[--stackSize]];
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum.x), originX), inverseX);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum.x), originX), inverseX);
+			__m128 entry = _mm_max_ps(zero, _mm_min_ps(t0, t1));
+			__m128 exit = _mm_min_ps(nearest, _mm_max_ps(t0, t1));
+			t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum.y), originY), inverseY);
+			t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum.y), originY), inverseY);
+			entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+			exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+			t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.minimum.z), originZ), inverseZ);
+			t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.maximum.z), originZ), inverseZ);
+			entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+			exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+			if (!_mm_movemask_ps(_mm_cmple_ps(entry, exit))) {
+				continue;
+			}
+
+			if (node.count > 0) {
+				for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+					const Triangle& triangle = this->triangles[i];
+					__m128 e1x = _mm_set1_ps(triangle.edge1.x), e1y = _mm_set1_ps(triangle.edge1.y), e1z = _mm_set1_ps(triangle.edge1.z);
+					__m128 e2x = _mm_set1_ps(triangle.edge2.x), e2y = _mm_set1_ps(triangle.edge2.y), e2z = _mm_set1_ps(triangle.edge2.z);
+					// p = direction x edge2
+					__m128 px = _mm_sub_ps(_mm_mul_ps(directionY, e2z), _mm_mul_ps(directionZ, e2y));
+					__m128 py = _mm_sub_ps(_mm_mul_ps(directionZ, e2x), _mm_mul_ps(directionX, e2z));
+					__m128 pz = _mm_sub_ps(_mm_mul_ps(directionX, e2y), _mm_mul_ps(directionY, e2x));
+					__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+					__m128 inverse = _mm_div_ps(one, determinant);
+					__m128 sx = _mm_sub_ps(originX, _mm_set1_ps(triangle.v0.x));
+					__m128 sy = _mm_sub_ps(originY, _mm_set1_ps(triangle.v0.y));
+					__m128 sz = _mm_sub_ps(originZ, _mm_set1_ps(triangle.v0.z));
+					__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverse);
+					// q = s x edge1
+					__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+					__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+					__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+					__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qx), _mm_mul_ps(directionY, qy)), _mm_mul_ps(directionZ, qz)), inverse);
+					__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse);
+					__m128 absoluteDeterminant = _mm_andnot_ps(_mm_set1_ps(-0.0f), determinant);
+					__m128 valid = _mm_cmpge_ps(absoluteDeterminant, _mm_set1_ps(1e-12f));
+					valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+					valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+					valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+					valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, zero));
+					valid = _mm_and_ps(valid, _mm_cmplt_ps(t, nearest));
+					if (!_mm_movemask_ps(valid)) {
+						continue;
+					}
+					nearest = _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, nearest));
+					hitU = _mm_or_ps(_mm_and_ps(valid, u), _mm_andnot_ps(valid, hitU));
+					hitV = _mm_or_ps(_mm_and_ps(valid, v), _mm_andnot_ps(valid, hitV));
+					__m128i validMask = _mm_castps_si128(valid);
+					hitTriangle = _mm_or_si128(_mm_and_si128(validMask, _mm_set1_epi32((int)i)), _mm_andnot_si128(validMask, hitTriangle));
+				}
+			}
+			else {
+				// Order by the first ray's direction, the packet's rays are nearly parallel
+				bool reversed = dx[0] * (node.axis == 0) + dy[0] * (node.axis == 1) + dz[0] * (node.axis == 2) < 0.0f;
+				stack[stackSize++] = node.offset + (reversed ? 0 : 1);
+				stack[stackSize++] = node.offset + (reversed ? 1 : 0);
+			}
+		}
+
+		float t[4], u[4], v[4];
+		unsigned int index[4];
+		_mm_storeu_ps(t, nearest);
+		_mm_storeu_ps(u, hitU);
+		_mm_storeu_ps(v, hitV);
+		_mm_storeu_si128((__m128i*)index, hitTriangle);
+		for (int i = 0; i < 4; i++) {
+			hits[i].t = t[i];
+			hits[i].u = u[i];
+			hits[i].v = v[i];
+			hits[i].triangle = index[i];
+		}
+#else
+		for (int i = 0; i < 4; i++) {
+			hits[i].t = FLT_MAX;
+			hits[i].triangle = 0xFFFFFFFF;
+			trace(origins[i], directions[i], hits[i], false);
+		}
+#endif
+	}
+
+	// Textures and normal mapping as in main.fs, at the finest mip level
+	Material evaluateMaterial(const Hit& hit, const glm::vec3& outgoing) const {
+		const WorldVertex& v0 = this->vertices[this->triangleVertices[hit.triangle * 3]];
+		const WorldVertex& v1 = this->vertices[this->triangleVertices[hit.triangle * 3 + 1]];
+		const WorldVertex& v2 = this->vertices[this->triangleVertices[hit.triangle * 3 + 2]];
+		float w = 1.0f - hit.u - hit.v;
+		glm::vec2 uv = v0.textureCoord * w + v1.textureCoord * hit.u + v2.textureCoord * hit.v;
+		glm::vec2 noDerivative = glm::vec2(0.0f);
+
+		Material material;
+		material.albedo = glm::pow(glm::vec3(this->textures[0].sample(uv, noDerivative, noDerivative)), glm::vec3(2.2f));
+		material.metallic = this->textures[2].sample(uv, noDerivative, noDerivative).r;
+		// A perfectly smooth GGX lobe is a delta and can't be sampled, keep a little roughness
+		material.roughness = std::max(this->textures[3].sample(uv, noDerivative, noDerivative).r, 0.03f);
+
+		const Triangle& triangle = this->triangles[hit.triangle];
+		material.geometricNormal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+		if (glm::dot(material.geometricNormal, outgoing) < 0.0f) {
+			material.geometricNormal = -material.geometricNormal;
+		}
+		glm::vec3 N = glm::normalize(v0.normal * w + v1.normal * hit.u + v2.normal * hit.v);
+		glm::vec3 T = glm::normalize(v0.tangent * w + v1.tangent * hit.u + v2.tangent * hit.v);
+		glm::vec3 B = -glm::cross(N, T) * (v0.bitangentSign < 0.0f ? -1.0f : 1.0f);
+		glm::vec3 tangentNormal = glm::vec3(this->textures[1].sample(uv, noDerivative, noDerivative)) * 2.0f - 1.0f;
+		material.normal = glm::normalize(glm::mat3(T, B, N) * tangentNormal);
+		// Both sides of a triangle are lit, like the GL path without face culling
+		if (glm::dot(material.normal, material.geometricNormal) < 0.0f) {
+			material.normal = -material.normal;
+		}
+		if (!(glm::length(material.normal) > 0.5f)) {
+			material.normal = material.geometricNormal;
+		}
+		return material;
+	}
+
+	static float ggxDistribution(float NdotH, float roughness) {
+		float a = roughness * roughness;
+		float a2 = a * a;
+		float denominator = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+		return a2 / (glm::pi<float>() * denominator * denominator);
+	}
+
+	static float schlickGGX(float NdotV, float roughness) {
+		float r = roughness + 1.0f;
+		float k = r * r / 8.0f;
+		return NdotV / (NdotV * (1.0f - k) + k);
+	}
+
+	static glm::vec3 fresnelSchlick(float cosine, const glm::vec3& F0) {
+		float f = 1.0f - cosine;
+		float f2 = f * f;
+		return F0 + (glm::vec3(1.0f) - F0) * (f2 * f2 * f);
+	}
+
+	// Cook-Torrance specular plus Lambert diffuse, already multiplied by the cosine term
+	static glm::vec3 evaluateBrdf(const Material& m, const glm::vec3& outgoing, const glm::vec3& incoming) {
+		float NdotL = glm::dot(m.normal, incoming);
+		float NdotV = glm::dot(m.normal, outgoing);
+		if (NdotL <= 0.0f || NdotV <= 0.0f) {
+			return glm::vec3(0.0f);
+		}
+		glm::vec3 halfway = glm::normalize(outgoing + incoming);
+		glm::vec3 F0 = glm::mix(glm::vec3(0.04f), m.albedo, m.metallic);
+		glm::vec3 F = fresnelSchlick(glm::clamp(glm::dot(halfway, outgoing), 0.0f, 1.0f), F0);
+		float D = ggxDistribution(std::max(glm::dot(m.normal, halfway), 0.0f), m.roughness);
+		float G = schlickGGX(NdotV, m.roughness) * schlickGGX(NdotL, m.roughness);
+		glm::vec3 specular = D * G * F / (4.0f * NdotV * NdotL);
+		glm::vec3 kD = (glm::vec3(1.0f) - F) * (1.0f - m.metallic);
+		return (kD * m.albedo / glm::pi<float>() + specular) * NdotL;
+	}
+
+	static float specularProbability(const Material& m, const glm::vec3& outgoing) {
+		glm::vec3 F0 = glm::mix(glm::vec3(0.04f), m.albedo, m.metallic);
+		glm::vec3 F = fresnelSchlick(std::max(glm::dot(m.normal, outgoing), 0.0f), F0);
+		return glm::clamp((F.x + F.y + F.z) / 3.0f * (1.0f - m.metallic) + m.metallic, 0.1f, 0.9f);
+	}
+
+	static glm::vec3 toWorld(const glm::vec3& local, const glm::vec3& normal) {
+		glm::vec3 up = std::abs(normal.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+		return tangent * local.x + bitangent * local.y + normal * local.z;
+	}
+
+	// Density of sampleBrdf() picking incoming, as a mixture of the two lobes
+	static float brdfPdf(const Material& m, const glm::vec3& outgoing, const glm::vec3& incoming, float specular) {
+		float NdotL = glm::dot(m.normal, incoming);
+		if (NdotL <= 0.0f) {
+			return 0.0f;
+		}
+		glm::vec3 halfway = glm::normalize(outgoing + incoming);
+		float NdotH = std::max(glm::dot(m.normal, halfway), 0.0f);
+		float VdotH = std::max(glm::dot(outgoing, halfway), 1e-6f);
+		float specularPdf = ggxDistribution(NdotH, m.roughness) * NdotH / (4.0f * VdotH);
+		float diffusePdf = NdotL / glm::pi<float>();
+		return specular * specularPdf + (1.0f - specular) * diffusePdf;
+	}
+
+	static glm::vec3 sampleBrdf(const Material& m, const glm::vec3& outgoing, float specular, Random& random) {
+		float u1 = random.next(), u2 = random.next();
+		if (random.next() < specular) {
+			float a = m.roughness * m.roughness;
+			float phi = 2.0f * glm::pi<float>() * u1;
+			float cosTheta = std::sqrt((1.0f - u2) / (1.0f + (a * a - 1.0f) * u2));
+			float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+			glm::vec3 halfway = toWorld(glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta), m.normal);
+			return glm::reflect(-outgoing, halfway);
+		}
+		float radius = std::sqrt(u1), phi = 2.0f * glm::pi<float>() * u2;
+		return toWorld(glm::vec3(radius * std::cos(phi), radius * std::sin(phi), std::sqrt(std::max(0.0f, 1.0f - u1))), m.normal);
+	}
+
+	bool occluded(const glm::vec3& origin, const glm::vec3& direction, float distance) const {
+		Hit hit;
+		hit.t = distance;
+		return trace(origin, direction, hit, true);
+	}
+
+	// Next-event estimation: every light with a shadow ray, light definitions as in main.fs
+	glm::vec3 sampleLights(const Material& m, const glm::vec3& position, const glm::vec3& outgoing) const {
+		glm::vec3 result = glm::vec3(0.0f);
+		float epsilon = this->sceneRadius * 1e-4f;
+		for (size_t i = 0; i < this->pointLights.size(); i++) {
+			const PointLight& light = this->pointLights[i];
+			glm::vec3 toLight = light.position - position;
+			float distance = glm::length(toLight);
+			glm::vec3 incoming = toLight / distance;
+			glm::vec3 f = evaluateBrdf(m, outgoing, incoming);
+			if (f == glm::vec3(0.0f)) {
+				continue;
+			}
+			glm::vec3 origin = position + m.geometricNormal * (glm::dot(m.geometricNormal, incoming) > 0.0f ? epsilon : -epsilon);
+			if (!occluded(origin, incoming, distance - 2.0f * epsilon)) {
+				float attenuation = 1.0f / (light.attConstant + light.attLinear * distance + light.attQuadratic * distance * distance);
+				result += f * light.color * attenuation;
+			}
+		}
+		glm::vec3 incoming = glm::normalize(-this->dirLight.direction);
+		glm::vec3 f = evaluateBrdf(m, outgoing, incoming);
+		if (f != glm::vec3(0.0f)) {
+			glm::vec3 origin = position + m.geometricNormal * (glm::dot(m.geometricNormal, incoming) > 0.0f ? epsilon : -epsilon);
+			if (!occluded(origin, incoming, FLT_MAX)) {
+				result += f * this->dirLight.color;
+			}
+		}
+		for (size_t i = 0; i < this->spotlights.size(); i++) {
+			const SpotLight& light = this->spotlights[i];
+			glm::vec3 toLight = light.position - position;
+			float distance = glm::length(toLight);
+			glm::vec3 incoming = toLight / distance;
+			float theta = glm::dot(incoming, glm::normalize(-light.direction));
+			float intensity = glm::clamp((theta - light.cosineOuterCutoff) / (light.cosineInnerCutoff - light.cosineOuterCutoff), 0.0f, 1.0f);
+			if (intensity <= 0.0f) {
+				continue;
+			}
+			glm::vec3 f = evaluateBrdf(m, outgoing, incoming);
+			if (f == glm::vec3(0.0f)) {
+				continue;
+			}
+			glm::vec3 origin = position + m.geometricNormal * (glm::dot(m.geometricNormal, incoming) > 0.0f ? epsilon : -epsilon);
+			if (!occluded(origin, incoming, distance - 2.0f * epsilon)) {
+				result += f * light.color * intensity;
+			}
+		}
+		return result;
+	}
+
+	// Radiance along a camera ray whose first hit is already known
+	glm::vec3 shadePath(glm::vec3 origin, glm::vec3 direction, Hit hit, Random& random) const {
+		glm::vec3 radiance = glm::vec3(0.0f);
+		glm::vec3 throughput = glm::vec3(1.0f);
+		float epsilon = this->sceneRadius * 1e-4f;
+		for (int bounce = 0; ; bounce++) {
+			if (hit.triangle == 0xFFFFFFFF) {
+				// The rasterizer draws no background, only bounced rays see the environment
+				if (bounce > 0 && this->environment) {
+					radiance += throughput * this->environment->samplePrefiltered(direction, 0.0f);
+				}
+				break;
+			}
+			glm::vec3 position = origin + direction * hit.t;
+			glm::vec3 outgoing = -direction;
+			Material material = evaluateMaterial(hit, outgoing);
+			radiance += throughput * sampleLights(material, position, outgoing);
+			if (bounce + 1 >= MAX_BOUNCES) {
+				break;
+			}
+
+			float specular = specularProbability(material, outgoing);
+			glm::vec3 incoming = sampleBrdf(material, outgoing, specular, random);
+			float pdf = brdfPdf(material, outgoing, incoming, specular);
+			if (pdf <= 0.0f) {
+				break;
+			}
+			throughput *= evaluateBrdf(material, outgoing, incoming) / pdf;
+			// Russian roulette once the path has bounced a few times
+			if (bounce >= 2) {
+				float survival = std::min(0.95f, std::max(throughput.x, std::max(throughput.y, throughput.z)));
+				if (random.next() >= survival) {
+					break;
+				}
+				throughput /= survival;
+			}
+
+			origin = position + material.geometricNormal * (glm::dot(material.geometricNormal, incoming) > 0.0f ? epsilon : -epsilon);
+			direction = incoming;
+			hit.t = FLT_MAX;
+			hit.triangle = 0xFFFFFFFF;
+			trace(origin, direction, hit, false);
+		}
+		return radiance;
+	}
+
+	// One sample for every pixel of a tile, camera rays go in 2x2 packets
+	void renderTile(int tile) {
+		int tileX = tile % this->tilesX, tileY = tile / this->tilesX;
+		int x0 = tileX * TILE_SIZE, y0 = tileY * TILE_SIZE;
+		int x1 = std::min(x0 + TILE_SIZE, this->width), y1 = std::min(y0 + TILE_SIZE, this->height);
+		for (int y = y0; y < y1; y += 2) {
+			for (int x = x0; x < x1; x += 2) {
+				glm::vec3 origins[4], directions[4];
+				Hit hits[4];
+				Random randoms[4] = { Random(0, 0), Random(0, 0), Random(0, 0), Random(0, 0) };
+				for (int i = 0; i < 4; i++) {
+					int px = std::min(x + (i & 1), x1 - 1), py = std::min(y + (i >> 1), y1 - 1);
+					randoms[i] = Random((unsigned int)(py * this->width + px), this->sampleCount);
+					// Box filtered over the pixel
+					float sx = (px + randoms[i].next()) / this->width * 2.0f - 1.0f;
+					float sy = 1.0f - (py + randoms[i].next()) / this->height * 2.0f;
+					glm::vec4 nearPoint = this->inverseViewProjection * glm::vec4(sx, sy, -1.0f, 1.0f);
+					glm::vec4 farPoint = this->inverseViewProjection * glm::vec4(sx, sy, 1.0f, 1.0f);
+					origins[i] = glm::vec3(nearPoint) / nearPoint.w;
+					directions[i] = glm::normalize(glm::vec3(farPoint) / farPoint.w - origins[i]);
+				}
+				tracePacket(origins, directions, hits);
+				for (int i = 0; i < 4; i++) {
+					int px = x + (i & 1), py = y + (i >> 1);
+					if (px >= x1 || py >= y1) {
+						continue;
+					}
+					glm::vec3 radiance = shadePath(origins[i], directions[i], hits[i], randoms[i]);
+					// A NaN would poison the pixel for good
+					if (!(radiance.x == radiance.x && radiance.y == radiance.y && radiance.z == radiance.z)) {
+						radiance = glm::vec3(0.0f);
+					}
+					this->accumulation[(size_t)py * this->width + px] += radiance;
+				}
+			}
+		}
+	}
+
+public:
+	// threadCount 0 uses every hardware thread, the image is the same for any count
+	PathTracer(int width, int height, unsigned int threadCount = 0) {
+		this->width = std::max(width, 1);
+		this->height = std::max(height, 1);
+		this->tilesX = (this->width + TILE_SIZE - 1) / TILE_SIZE;
+		this->tilesY = (this->height + TILE_SIZE - 1) / TILE_SIZE;
+		if (threadCount > 0) {
+			this->ownJobs.reset(new JobSystem(threadCount));
+		}
+		this->jobs = threadCount > 0 ? this->ownJobs.get() : &JobSystem::shared();
+		this->accumulation.assign((size_t)this->width * this->height, glm::vec3(0.0f));
+		this->dirLight = DirectionalLight{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f) };
+	}
+
+	// Builds the BVH over the full detail level and clears the accumulated samples. textures are
+	// the 5 material maps in the order of textureNames, they and environment (may be NULL) must
+	// outlive the rendering.
+	void setScene(Model& model, const glm::mat4& modelMatrix, const Camera& camera, const SoftwareTexture* textures,
+		const std::vector<PointLight>& pointLights, const DirectionalLight& dirLight, const std::vector<SpotLight>& spotlights,
+		const Environment* environment) {
+		this->textures = textures;
+		this->pointLights = pointLights;
+		this->dirLight = dirLight;
+		this->spotlights = spotlights;
+		this->environment = environment && environment->loaded ? environment : NULL;
+		this->inverseViewProjection = glm::inverse(camera.projection * camera.view);
+
+		glm::mat3 inverseModel = glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
+		this->vertices.clear();
+		std::vector<unsigned int> sourceVertices;
+		for (int i = 0; i < model.meshes.size(); i++) {
+			const Mesh& mesh = model.meshes[i];
+			const MeshLod& lod = mesh.getLod(0);
+			const std::vector<Vertex>& meshVertices = mesh.getVertices();
+			const std::vector<unsigned int>& indices = mesh.getIndices();
+			unsigned int offset = (unsigned int)this->vertices.size();
+			for (size_t j = 0; j < meshVertices.size(); j++) {
+				const Vertex& v = meshVertices[j];
+				WorldVertex world;
+				world.position = glm::vec3(modelMatrix * glm::vec4(v.position, 1.0f));
+				world.normal = inverseModel * v.normal;
+				world.tangent = glm::mat3(modelMatrix) * glm::vec3(v.tangent);
+				world.bitangentSign = v.tangent.w;
+				world.textureCoord = glm::vec2(v.textureCoord);
+				this->vertices.push_back(world);
+			}
+			for (unsigned int j = 0; j < lod.indexCount; j++) {
+				sourceVertices.push_back(indices[lod.indexOffset + j] + offset);
+			}
+		}
+		this->sceneRadius = std::max(model.getBoundingSphere(modelMatrix).w, 1e-3f);
+		buildBvh(sourceVertices);
+		reset();
+	}
+
+	void reset() {
+		std::fill(this->accumulation.begin(), this->accumulation.end(), glm::vec3(0.0f));
+		this->sampleCount = 0;
+	}
+
+	// Adds count samples to every pixel, can be called repeatedly to refine the image
+	void addSamples(unsigned int count) {
+		if (this->triangles.empty()) {
+			this->sampleCount += count;
+			return;
+		}
+		for (unsigned int s = 0; s < count; s++) {
+			this->jobs->parallelFor(this->tilesX * this->tilesY, 1, [&](size_t tile) { renderTile((int)tile); });
+			this->sampleCount++;
+		}
+	}
+
+	unsigned int getSampleCount() const {
+		return this->sampleCount;
+	}
+
+	int getWidth() const {
+		return this->width;
+	}
+
+	int getHeight() const {
+		return this->height;
+	}
+
+	// Mean radiance of every pixel, rows from top to bottom
+	std::vector<glm::vec3> getHdrImage() const {
+		std::vector<glm::vec3> image(this->accumulation.size(), glm::vec3(0.0f));
+		if (this->sampleCount > 0) {
+			for (size_t i = 0; i < image.size(); i++) {
+				image[i] = this->accumulation[i] / (float)this->sampleCount;
+			}
+		}
+		return image;
+	}
+
+	// RGBA8 with the tone mapping and gamma of main.fs, comparable to SoftwareRenderer's output
+	std::vector<unsigned char> getToneMappedImage() const {
+		std::vector<glm::vec3> hdr = getHdrImage();
+		std::vector<unsigned char> image(hdr.size() * 4);
+		for (size_t i = 0; i < hdr.size(); i++) {
+			glm::vec3 color = glm::pow(hdr[i] / (hdr[i] + glm::vec3(1.0f)), glm::vec3(1.0f / 2.2f));
+			for (int c = 0; c < 3; c++) {
+				image[i * 4 + c] = (unsigned char)(glm::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+			image[i * 4 + 3] = 255;
+		}
+		return image;
+	}
+};
\ No newline at end of file
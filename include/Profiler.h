@@ -0,0 +1,377 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <imgui.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+// Scoped frame profiler. Every scope is timed on the CPU, scopes opened with gpu = true are also
+// timed on the GPU with a GL_TIME_ELAPSED query:
+//	- Queries of a frame are read FRAME_LATENCY frames later and only if their result is available,
+//	  so the profiler never waits for the GPU. Frames whose results are late lose their GPU times.
+//	- Time elapsed queries can't nest, a GPU scope inside another one is only timed on the CPU.
+//	- The GPU doesn't report when a scope started, its scopes are shown back to back in issue order.
+// The last HISTORY frames of every scope are kept for the min / average / 99th percentile, and
+// frames can be streamed to a Chrome trace event file (chrome://tracing or ui.perfetto.dev).
+// Scopes are timed on the thread owning the GL context. The other methods can be called from any
+// thread, e.g. the overlay is drawn by the UI thread.
+class Profiler {
+public:
+	static const int FRAME_LATENCY = 4;
+	static const int HISTORY = 240;
+
+private:
+	struct Event {
+		const char* name;
+		int depth;
+		// Milliseconds from the start of the frame
+		double start;
+		double duration;
+		// Index into the frame's queries, -1 without a GPU time
+		int query;
+	};
+
+	struct Frame {
+		std::vector<Event> events;
+		std::vector<GLuint> queries;
+		unsigned int queryCount = 0;
+		// Microseconds since the profiler was created
+		double startMicroseconds = 0.0;
+		bool pending = false;
+	};
+
+	// Ring buffer of the last HISTORY samples in milliseconds
+	struct History {
+		float samples[HISTORY];
+		int count = 0;
+		int next = 0;
+
+		void add(float sample) {
+			this->samples[this->next] = sample;
+			this->next = (this->next + 1) % HISTORY;
+			this->count = std::min(this->count + 1, HISTORY);
+		}
+
+		void summarize(float& minimum, float& average, float& p99) const {
+			minimum = average = p99 = 0.0f;
+			if (this->count == 0) {
+				return;
+			}
+			// Sorted on the stack, the overlay summarizes every scope every frame
+			float sorted[HISTORY];
+			std::copy(this->samples, this->samples + this->count, sorted);
+			std::sort(sorted, sorted + this->count);
+			minimum = sorted[0];
+			for (int i = 0; i < this->count; i++) {
+				average += sorted[i];
+			}
+			average /= this->count;
+			p99 = sorted[std::min(this->count - 1, (int)(this->count * 0.99f))];
+		}
+	};
+
+	struct Statistics {
+		History cpu;
+		History gpu;
+		bool hasGpu = false;
+	};
+
+	std::chrono::steady_clock::time_point epoch;
+	std::chrono::steady_clock::time_point frameStart;
+	Frame frames[FRAME_LATENCY];
+	unsigned long long frameIndex = 0;
+	bool inFrame = false;
+	std::vector<int> openScopes;
+	// Depth of the scope that holds the running GPU query, -1 when none is running
+	int gpuScopeDepth = -1;
+
+	std::map<std::string, Statistics> statistics;
+	// Scopes in the order they were first seen, for a stable table
+	std::vector<std::map<std::string, Statistics>::iterator> scopes;
+	// The statistics of every name pointer seen, so that looking a scope up doesn't build a string.
+	// Scope names are string literals, a pointer always stands for the same name.
+	std::map<const char*, Statistics*> statisticsByName;
+	// Last complete frame on the CPU, and the last one whose GPU times arrived
+	std::vector<Event> lastCpuFrame;
+	std::vector<Event> lastGpuFrame;
+	unsigned int lateGpuFrames = 0;
+
+	std::ofstream trace;
+	mutable std::recursive_mutex mutex;
+	bool firstTraceEvent = true;
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start) const {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	Statistics& getStatistics(const char* name) {
+		std::map<const char*, Statistics*>::iterator cached = this->statisticsByName.find(name);
+		if (cached != this->statisticsByName.end()) {
+			return *cached->second;
+		}
+		// The same name may come from another pointer, e.g. a literal in another translation unit
+		std::map<std::string, Statistics>::iterator found = this->statistics.find(name);
+		if (found == this->statistics.end()) {
+			found = this->statistics.insert(std::make_pair(std::string(name), Statistics())).first;
+			this->scopes.push_back(found);
+		}
+		this->statisticsByName[name] = &found->second;
+		return found->second;
+	}
+
+	void writeTraceEvent(const char* name, int thread, double startMicroseconds, double durationMicroseconds) {
+		if (!this->trace.is_open()) {
+			return;
+		}
+		this->trace << (this->firstTraceEvent ? "" : ",\n") << "{\"name\":\"" << name << "\",\"cat\":\"" << (thread == 1 ? "cpu" : "gpu")
+			<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread << ",\"ts\":" << startMicroseconds << ",\"dur\":" << durationMicroseconds << "}";
+		this->firstTraceEvent = false;
+	}
+
+	// Reads the GPU times of a frame issued FRAME_LATENCY frames ago
+	void resolve(Frame& frame) {
+		if (!frame.pending) {
+			return;
+		}
+		frame.pending = false;
+		for (unsigned int i = 0; i < frame.queryCount; i++) {
+			GLuint available = 0;
+			glGetQueryObjectuiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				this->lateGpuFrames++;
+				return;
+			}
+		}
+		// Reuses the last frame's storage, a steady frame doesn't allocate
+		this->lastGpuFrame.clear();
+		double offset = 0.0;
+		for (size_t i = 0; i < frame.events.size(); i++) {
+			Event event = frame.events[i];
+			if (event.query < 0) {
+				continue;
+			}
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(frame.queries[event.query], GL_QUERY_RESULT, &nanoseconds);
+			event.start = offset;
+			event.duration = nanoseconds / 1e6;
+			event.depth = 0;
+			offset += event.duration;
+			Statistics& statistics = getStatistics(event.name);
+			statistics.gpu.add((float)event.duration);
+			statistics.hasGpu = true;
+			writeTraceEvent(event.name, 2, frame.startMicroseconds + event.start * 1000.0, event.duration * 1000.0);
+			this->lastGpuFrame.push_back(event);
+		}
+	}
+
+	static ImU32 scopeColor(const char* name) {
+		unsigned int hash = 2166136261u;
+		for (const char* c = name; *c; c++) {
+			hash = (hash ^ (unsigned char)*c) * 16777619u;
+		}
+		return ImColor::HSV((hash % 360) / 360.0f, 0.55f, 0.75f);
+	}
+
+	// One bar per scope, deeper scopes below their parents, width relative to span milliseconds
+	void drawTrack(const char* label, const std::vector<Event>& events, double span) {
+		ImGui::Text("%s", label);
+		float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+		int maxDepth = 0;
+		for (size_t i = 0; i < events.size(); i++) {
+			maxDepth = std::max(maxDepth, events[i].depth);
+		}
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+		ImGui::Dummy(ImVec2(width, rowHeight * (maxDepth + 1)));
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		for (size_t i = 0; i < events.size(); i++) {
+			const Event& event = events[i];
+			ImVec2 minimum = ImVec2(origin.x + (float)(event.start / span) * width, origin.y + event.depth * rowHeight);
+			ImVec2 maximum = ImVec2(std::max(origin.x + (float)((event.start + event.duration) / span) * width, minimum.x + 1.0f), minimum.y + rowHeight - 1.0f);
+			drawList->AddRectFilled(minimum, maximum, scopeColor(event.name));
+			if (ImGui::CalcTextSize(event.name).x < maximum.x - minimum.x - 4.0f) {
+				drawList->AddText(ImVec2(minimum.x + 2.0f, minimum.y), IM_COL32_WHITE, event.name);
+			}
+			if (ImGui::IsMouseHoveringRect(minimum, maximum)) {
+				ImGui::SetTooltip("%s: %.3f ms", event.name, event.duration);
+			}
+		}
+	}
+
+public:
+	Profiler() {
+		this->epoch = std::chrono::steady_clock::now();
+	}
+
+	~Profiler() {
+		stopTrace();
+		for (int i = 0; i < FRAME_LATENCY; i++) {
+			if (!this->frames[i].queries.empty()) {
+				glDeleteQueries((GLsizei)this->frames[i].queries.size(), this->frames[i].queries.data());
+			}
+		}
+	}
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Opens the "Frame" scope that every other scope of the frame goes under
+	void beginFrame() {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+		resolve(frame);
+		frame.events.clear();
+		frame.queryCount = 0;
+		this->frameStart = std::chrono::steady_clock::now();
+		frame.startMicroseconds = std::chrono::duration<double, std::micro>(this->frameStart - this->epoch).count();
+		this->inFrame = true;
+		beginScope("Frame");
+	}
+
+	void endFrame() {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		while (!this->openScopes.empty()) {
+			endScope();
+		}
+		Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+		for (size_t i = 0; i < frame.events.size(); i++) {
+			const Event& event = frame.events[i];
+			getStatistics(event.name).cpu.add((float)event.duration);
+			writeTraceEvent(event.name, 1, frame.startMicroseconds + event.start * 1000.0, event.duration * 1000.0);
+		}
+		this->lastCpuFrame = frame.events;
+		frame.pending = frame.queryCount > 0;
+		this->inFrame = false;
+		this->frameIndex++;
+	}
+
+	// name is kept beyond the frame, pass a string literal
+	void beginScope(const char* name, bool gpu = false) {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		if (!this->inFrame) {
+			return;
+		}
+		Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+		Event event = Event{ name, (int)this->openScopes.size(), millisecondsSince(this->frameStart), 0.0, -1 };
+		if (gpu && this->gpuScopeDepth < 0) {
+			if (frame.queryCount == frame.queries.size()) {
+				GLuint query;
+				glGenQueries(1, &query);
+				frame.queries.push_back(query);
+			}
+			event.query = (int)frame.queryCount++;
+			glBeginQuery(GL_TIME_ELAPSED, frame.queries[event.query]);
+			this->gpuScopeDepth = event.depth;
+		}
+		this->openScopes.push_back((int)frame.events.size());
+		frame.events.push_back(event);
+	}
+
+	void endScope() {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		if (this->openScopes.empty()) {
+			return;
+		}
+		Frame& frame = this->frames[this->frameIndex % FRAME_LATENCY];
+		Event& event = frame.events[this->openScopes.back()];
+		this->openScopes.pop_back();
+		event.duration = millisecondsSince(this->frameStart) - event.start;
+		if (event.query >= 0) {
+			glEndQuery(GL_TIME_ELAPSED);
+			this->gpuScopeDepth = -1;
+		}
+	}
+
+	// Adds a CPU time measured elsewhere to the statistics, e.g. of work on another thread. Like
+	// beginScope(), name has to be a string literal.
+	void addCpuSample(const char* name, double milliseconds) {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		getStatistics(name).cpu.add((float)milliseconds);
+	}
+
+	// Every following frame is appended to a Chrome trace event file at path
+	bool startTrace(const std::string& path) {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		stopTrace();
+		this->trace.open(path);
+		if (!this->trace) {
+			std::cout << "Failed to open " << path << std::endl;
+			return false;
+		}
+		// Timestamps grow past a million microseconds within seconds, the default 6 significant digits would round them
+		this->trace << std::fixed << std::setprecision(3);
+		this->trace << "{\"traceEvents\":[\n";
+		this->trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+		this->trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+		this->firstTraceEvent = false;
+		return true;
+	}
+
+	void stopTrace() {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		if (this->trace.is_open()) {
+			this->trace << "\n]}\n";
+			this->trace.close();
+		}
+	}
+
+	bool isTracing() const {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		return this->trace.is_open();
+	}
+
+	// Flame graph of the last frame and the statistics of every scope, in an ImGui window
+	void drawOverlay(bool* open) {
+		std::lock_guard<std::recursive_mutex> lock(this->mutex);
+		ImGui::SetNextWindowSize(ImVec2(700.0f, 400.0f), ImGuiCond_FirstUseEver);
+		if (!ImGui::Begin("Profiler", open)) {
+			ImGui::End();
+			return;
+		}
+		double cpuSpan = this->lastCpuFrame.empty() ? 1.0 : std::max(this->lastCpuFrame[0].duration, 1e-3);
+		double gpuSpan = 1e-3;
+		for (size_t i = 0; i < this->lastGpuFrame.size(); i++) {
+			gpuSpan = std::max(gpuSpan, this->lastGpuFrame[i].start + this->lastGpuFrame[i].duration);
+		}
+		// Both tracks share a scale so that their lengths can be compared
+		double span = std::max(cpuSpan, gpuSpan);
+		drawTrack("CPU", this->lastCpuFrame, span);
+		drawTrack("GPU", this->lastGpuFrame, span);
+		if (this->lateGpuFrames > 0) {
+			ImGui::Text("GPU times of %u frames arrived too late and were skipped", this->lateGpuFrames);
+		}
+		ImGui::Separator();
+
+		ImGui::Columns(3, "profilerStatistics");
+		ImGui::Text("Scope");
+		ImGui::NextColumn();
+		ImGui::Text("CPU min / avg / p99 (ms)");
+		ImGui::NextColumn();
+		ImGui::Text("GPU min / avg / p99 (ms)");
+		ImGui::NextColumn();
+		ImGui::Separator();
+		for (size_t i = 0; i < this->scopes.size(); i++) {
+			const Statistics& statistics = this->scopes[i]->second;
+			float minimum, average, p99;
+			ImGui::Text("%s", this->scopes[i]->first.c_str());
+			ImGui::NextColumn();
+			statistics.cpu.summarize(minimum, average, p99);
+			ImGui::Text("%.3f / %.3f / %.3f", minimum, average, p99);
+			ImGui::NextColumn();
+			if (statistics.hasGpu) {
+				statistics.gpu.summarize(minimum, average, p99);
+				ImGui::Text("%.3f / %.3f / %.3f", minimum, average, p99);
+			}
+			ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::End();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+// Decides when the render-on-demand main loop has to draw. A frame is needed when:
+//	- Input arrived. ImGui reacts to some input a frame late (menus, hovering), so a few frames
+//	  are drawn after each event.
+//	- The scene state hashed during the frame differs from the previous frame's.
+//	- Someone asked for frames, e.g. a capture in progress or work finishing on another thread.
+// Otherwise the thread sleeps in glfwWaitEventsTimeout(), which returns as soon as an event
+// arrives, so input isn't delayed.
+class RedrawScheduler {
+public:
+	static const int INPUT_FRAMES = 3;
+
+private:
+	static constexpr double IDLE_TIMEOUT = 1.0;
+
+	std::atomic<int> framesToRender;
+	unsigned long long stateHash = 14695981039346656037ull;
+	unsigned long long lastStateHash = 0;
+
+	GLFWkeyfun previousKey = NULL;
+	GLFWcharfun previousChar = NULL;
+	GLFWmousebuttonfun previousMouseButton = NULL;
+	GLFWscrollfun previousScroll = NULL;
+
+	static RedrawScheduler* get(GLFWwindow* window) {
+		return (RedrawScheduler*)glfwGetWindowUserPointer(window);
+	}
+
+	// Every callback wakes the loop and forwards to the one it replaced
+	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+		get(window)->requestFrames();
+		if (get(window)->previousKey) {
+			get(window)->previousKey(window, key, scancode, action, mods);
+		}
+	}
+
+	static void charCallback(GLFWwindow* window, unsigned int codepoint) {
+		get(window)->requestFrames();
+		if (get(window)->previousChar) {
+			get(window)->previousChar(window, codepoint);
+		}
+	}
+
+	static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+		get(window)->requestFrames();
+		if (get(window)->previousMouseButton) {
+			get(window)->previousMouseButton(window, button, action, mods);
+		}
+	}
+
+	static void scrollCallback(GLFWwindow* window, double x, double y) {
+		get(window)->requestFrames();
+		if (get(window)->previousScroll) {
+			get(window)->previousScroll(window, x, y);
+		}
+	}
+
+	static void cursorPositionCallback(GLFWwindow* window, double x, double y) {
+		get(window)->requestFrames();
+	}
+
+	static void windowCallback(GLFWwindow* window) {
+		get(window)->requestFrames();
+	}
+
+	static void windowSizeCallback(GLFWwindow* window, int width, int height) {
+		get(window)->requestFrames();
+	}
+
+	static void windowStateCallback(GLFWwindow* window, int state) {
+		get(window)->requestFrames();
+	}
+
+public:
+	RedrawScheduler() {
+		this->framesToRender = INPUT_FRAMES;
+	}
+
+	// Installs the input callbacks on top of the existing ones. Call before ImGui_ImplGlfw_Init*,
+	// which chains its callbacks to these in turn.
+	void attach(GLFWwindow* window) {
+		glfwSetWindowUserPointer(window, this);
+		this->previousKey = glfwSetKeyCallback(window, keyCallback);
+		this->previousChar = glfwSetCharCallback(window, charCallback);
+		this->previousMouseButton = glfwSetMouseButtonCallback(window, mouseButtonCallback);
+		this->previousScroll = glfwSetScrollCallback(window, scrollCallback);
+		glfwSetCursorPosCallback(window, cursorPositionCallback);
+		glfwSetWindowRefreshCallback(window, windowCallback);
+		glfwSetFramebufferSizeCallback(window, windowSizeCallback);
+		glfwSetWindowFocusCallback(window, windowStateCallback);
+		glfwSetWindowIconifyCallback(window, windowStateCallback);
+	}
+
+	// Safe to call from any thread, the loop is woken up if it's waiting
+	void requestFrames(int count = INPUT_FRAMES) {
+		int current = this->framesToRender;
+		while (current < count && !this->framesToRender.compare_exchange_weak(current, count)) {
+		}
+		glfwPostEmptyEvent();
+	}
+
+	// Adds the raw bytes of everything that affects the image, once per frame
+	void hashState(const void* data, size_t size) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) {
+			this->stateHash = (this->stateHash ^ bytes[i]) * 1099511628211ull;
+		}
+	}
+
+	template<typename T>
+	void hashState(const T& value) {
+		hashState(&value, sizeof(T));
+	}
+
+	template<typename T>
+	void hashState(const std::vector<T>& values) {
+		size_t size = values.size();
+		hashState(&size, sizeof(size));
+		if (size > 0) {
+			hashState(values.data(), size * sizeof(T));
+		}
+	}
+
+	// Ends the frame and sleeps until the next one is needed. animating keeps drawing at the
+	// given interval in seconds, e.g. for a blinking text cursor; 0 waits for an event.
+	void waitForNextFrame(GLFWwindow* window, double animationInterval = 0.0) {
+		if (this->stateHash != this->lastStateHash) {
+			// The frame that changed the state may have drawn it half way, e.g. a light edited
+			// after the shadow maps were rendered
+			this->lastStateHash = this->stateHash;
+			requestFrames(1);
+		}
+		this->stateHash = 14695981039346656037ull;
+		int current = this->framesToRender;
+		while (current > 0 && !this->framesToRender.compare_exchange_weak(current, current - 1)) {
+		}
+		while (this->framesToRender == 0 && !glfwWindowShouldClose(window)) {
+			double timeout = IDLE_TIMEOUT;
+			if (animationInterval > 0.0) {
+				timeout = animationInterval;
+			}
+			glfwWaitEventsTimeout(timeout);
+			if (animationInterval > 0.0) {
+				this->framesToRender = std::max((int)this->framesToRender, 1);
+			}
+		}
+	}
+};
\ No newline at end of file
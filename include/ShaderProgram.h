@@ -9,78 +9,86 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstring>
 
 class ShaderProgram
 {
-public:
-	unsigned int ID;
-	ShaderProgram(const char* vertexPath, const char* fragmentPath) {
-		// Buffer to hold error data
+private:
+	// Loads a shader stage from file, compiles it and prints its info log
+	static unsigned int compileShader(GLenum type, const char* path, const char* stageName) {
 		char infoLog[1024];
-		// Temporary variable for conversion to c_str
 		std::string temp;
-
-		// Load vertex shader from file and compile
-		std::ifstream vertexFile;
-		std::stringstream vertexStream;
-		const char* vertexShaderCode;
-		unsigned int vertexShaderID;
+		std::ifstream file;
+		std::stringstream stream;
+		const char* code;
+		unsigned int shaderID;
 		//		Try to open the file and read contents, provide error message if fail
 		try {
-			vertexFile.open(vertexPath);
-			vertexStream << vertexFile.rdbuf();
-			vertexFile.close();
-			temp = vertexStream.str();
-			vertexShaderCode = temp.c_str();
+			file.open(path);
+			stream << file.rdbuf();
+			file.close();
+			temp = stream.str();
+			code = temp.c_str();
 		}
 		catch (const char* msg) {
 			std::cout << "Exception: " << msg << std::endl;
 		}
 		//		Create the shader and compile it
-  		vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertexShaderID, 1, &vertexShaderCode, NULL);
-		glCompileShader(vertexShaderID);
-
-		// Load fragment shader from file and compile
-		std::ifstream fragmentFile;
-		std::stringstream fragmentStream;
-		const char* fragmentShaderCode;
-		unsigned int fragmentShaderID;
-		//		Same as vertex shader
-		try {
-			fragmentFile.open(fragmentPath);
-			fragmentStream << fragmentFile.rdbuf();
-			fragmentFile.close();
-			temp = fragmentStream.str();
-			fragmentShaderCode = temp.c_str();
-		}
-		catch (const char* msg) {
-			std::cout << "Exception: " << msg << std::endl;
-		}
-		//		Same as vertex shader
-		fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragmentShaderID, 1, &fragmentShaderCode, NULL);
-		glCompileShader(fragmentShaderID);
+		shaderID = glCreateShader(type);
+		glShaderSource(shaderID, 1, &code, NULL);
+		glCompileShader(shaderID);
 
-		// Create and link vertex and fragment shaders into shader program
 		memset(infoLog, 0, sizeof(infoLog));
+		glGetShaderInfoLog(shaderID, 1024, NULL, infoLog);
+		std::cout << stageName << " shader info log: " << infoLog << std::endl;
+		return shaderID;
+	}
+
+	// Links the compiled stages into this program and deletes them
+	void linkProgram(const unsigned int* shaderIDs, int shaderCount) {
+		char infoLog[1024];
 		this->ID = glCreateProgram();
-		glAttachShader(this->ID, vertexShaderID);
-		glAttachShader(this->ID, fragmentShaderID);
+		for (int i = 0; i < shaderCount; i++) {
+			glAttachShader(this->ID, shaderIDs[i]);
+		}
 		glLinkProgram(this->ID);
-		glDeleteShader(vertexShaderID);
-		glDeleteProgram(fragmentShaderID);
-		
-		// Get any shader error logs into infoLog and display
-		glGetShaderInfoLog(vertexShaderID, 1024, NULL, infoLog);
-		std::cout << "Vertex shader info log: " << infoLog << std::endl;
-		glGetShaderInfoLog(fragmentShaderID, 1024, NULL, infoLog);
-		std::cout << "Fragment shader info log: " << infoLog << std::endl;
+		for (int i = 0; i < shaderCount; i++) {
+			glDeleteShader(shaderIDs[i]);
+		}
+
 		// Get any program error logs into infoLog and display
+		memset(infoLog, 0, sizeof(infoLog));
 		glGetProgramInfoLog(this->ID, 1024, NULL, infoLog);
 		std::cout << "Shader program info log: " << infoLog << std::endl;
 	}
 
+public:
+	unsigned int ID;
+	ShaderProgram(const char* vertexPath, const char* fragmentPath) {
+		unsigned int shaderIDs[] = {
+			compileShader(GL_VERTEX_SHADER, vertexPath, "Vertex"),
+			compileShader(GL_FRAGMENT_SHADER, fragmentPath, "Fragment")
+		};
+		linkProgram(shaderIDs, 2);
+	}
+
+	ShaderProgram(const char* vertexPath, const char* geometryPath, const char* fragmentPath) {
+		unsigned int shaderIDs[] = {
+			compileShader(GL_VERTEX_SHADER, vertexPath, "Vertex"),
+			compileShader(GL_GEOMETRY_SHADER, geometryPath, "Geometry"),
+			compileShader(GL_FRAGMENT_SHADER, fragmentPath, "Fragment")
+		};
+		linkProgram(shaderIDs, 3);
+	}
+
+	// Compute shader programs only have a single stage
+	ShaderProgram(const char* computePath) {
+		unsigned int shaderIDs[] = {
+			compileShader(GL_COMPUTE_SHADER, computePath, "Compute")
+		};
+		linkProgram(shaderIDs, 1);
+	}
+
 
 	void use() {
 		glUseProgram(this->ID);
@@ -94,6 +102,10 @@ public:
 		glUniform1iv(glGetUniformLocation(this->ID, varName), varValueArrayCount, varValueArray);
 	}
 
+	void setUniformUint(const char* varName, unsigned int varValue) {
+		glUniform1ui(glGetUniformLocation(this->ID, varName), varValue);
+	}
+
 	void setUniformFloat(const char* varName, float varValue) {
 		glUniform1f(glGetUniformLocation(this->ID, varName), varValue);
 	}
@@ -109,4 +121,24 @@ public:
 	void setUniformVec3(const char* varName, glm::vec3 varValue) {
 		glUniform3fv(glGetUniformLocation(this->ID, varName), 1, glm::value_ptr(varValue));
 	}
+
+	void setUniformVec2Array(const char* varName, int varValueArrayCount, const glm::vec2* varValueArray) {
+		glUniform2fv(glGetUniformLocation(this->ID, varName), varValueArrayCount, glm::value_ptr(varValueArray[0]));
+	}
+
+	void setUniformVec3Array(const char* varName, int varValueArrayCount, const glm::vec3* varValueArray) {
+		glUniform3fv(glGetUniformLocation(this->ID, varName), varValueArrayCount, glm::value_ptr(varValueArray[0]));
+	}
+
+	void setUniformVec4(const char* varName, glm::vec4 varValue) {
+		glUniform4fv(glGetUniformLocation(this->ID, varName), 1, glm::value_ptr(varValue));
+	}
+
+	void setUniformMat4Array(const char* varName, int varValueArrayCount, const glm::mat4* varValueArray) {
+		glUniformMatrix4fv(glGetUniformLocation(this->ID, varName), varValueArrayCount, GL_FALSE, glm::value_ptr(varValueArray[0]));
+	}
+
+	void setUniformVec4Array(const char* varName, int varValueArrayCount, const glm::vec4* varValueArray) {
+		glUniform4fv(glGetUniformLocation(this->ID, varName), varValueArrayCount, glm::value_ptr(varValueArray[0]));
+	}
 };
\ No newline at end of file
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <ShaderProgram.h>
+#include <Camera.h>
+#include <Model.h>
+#include <Light.h>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// Shadow maps for every light type. The directional light uses cascades fitted to slices of the
+// camera frustum, the spotlights share tiles of one depth atlas and the point lights share the
+// cube faces of one cube map array.
+// A map is only re-rendered when its light matrix, the model matrix or the geometry changes,
+// so static scenes cost nothing beyond the lookups in main.fs.
+class ShadowMaps {
+private:
+	static const int CASCADE_COUNT = 4;
+	static const int CASCADE_RESOLUTION = 2048;
+	// 4x4 tiles, one for each of the 16 spotlights main.fs supports
+	static const int SPOT_TILES_PER_ROW = 4;
+	static const int SPOT_TILE_RESOLUTION = 1024;
+	static const int MAX_SPOT_LIGHTS = SPOT_TILES_PER_ROW * SPOT_TILES_PER_ROW;
+	static const int MAX_POINT_LIGHTS = 16;
+	static const int CUBE_RESOLUTION = 512;
+
+	// What a shadow map was last rendered with
+	struct CachedMap {
+		bool valid = false;
+		glm::mat4 lightViewProjection;
+		glm::mat4 model;
+		unsigned int geometryVersion;
+	};
+
+	// Point light faces are cached one by one. Moving the light dirties all six, a change of the
+	// geometry only the faces that contained it before or contain it now.
+	struct CachedCube {
+		bool valid = false;
+		glm::vec3 position;
+		glm::vec2 range;
+		unsigned int occupiedFaces;
+		glm::mat4 model;
+		unsigned int geometryVersion;
+	};
+
+	ShaderProgram depthShader;
+	ShaderProgram cubeDepthShader;
+	unsigned int cascadeTexture, cascadeFBO;
+	unsigned int spotAtlasTexture, spotFBO;
+	unsigned int cubeArrayTexture, cubeFBO;
+
+	glm::mat4 cascadeMatrices[CASCADE_COUNT];
+	glm::vec4 cascadeSplits;
+	glm::vec4 cascadeTexelSizes;
+	CachedMap cascadeCache[CASCADE_COUNT];
+	glm::mat4 spotMatrices[MAX_SPOT_LIGHTS];
+	glm::mat4 spotAtlasMatrices[MAX_SPOT_LIGHTS];
+	CachedMap spotCache[MAX_SPOT_LIGHTS];
+	glm::mat4 cubeFaceMatrices[MAX_POINT_LIGHTS][6];
+	glm::vec2 cubeRanges[MAX_POINT_LIGHTS];
+	CachedCube cubeCache[MAX_POINT_LIGHTS];
+	int pointShadowCount = 0;
+
+	static unsigned int createDepthFramebuffer() {
+		unsigned int fbo;
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return fbo;
+	}
+
+	// Hardware PCF, anything outside the map counts as lit
+	static void setShadowSampling(GLenum target) {
+		float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+		glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	}
+
+	static bool isCached(const CachedMap& cache, const glm::mat4& lightViewProjection, const glm::mat4& model, unsigned int geometryVersion) {
+		return cache.valid &&
+			cache.lightViewProjection == lightViewProjection &&
+			cache.model == model &&
+			cache.geometryVersion == geometryVersion;
+	}
+
+	// Splits the camera frustum between its near plane and the far side of the scene, then fits a
+	// sphere around every slice. Spheres keep their size when the camera turns and their centers are
+	// snapped to whole shadow map texels, so the shadow edges don't shimmer as the camera moves.
+	void fitCascades(const DirectionalLight& light, const Camera& camera, const glm::vec4& sceneSphere) {
+		const float lambda = 0.75f;
+		const glm::mat4& p = camera.projection;
+		float nearPlane = p[3][2] / (p[2][2] - 1.0f);
+		float farPlane = p[3][2] / (p[2][2] + 1.0f);
+		float sceneFar = glm::length(camera.position - glm::vec3(sceneSphere)) + sceneSphere.w;
+		farPlane = std::max(std::min(farPlane, sceneFar), nearPlane * 2.0f);
+		float tanHalfX = 1.0f / p[0][0];
+		float tanHalfY = 1.0f / p[1][1];
+		glm::mat4 inverseView = glm::inverse(camera.view);
+
+		glm::vec3 direction = glm::length(light.direction) > 0.0f ? glm::normalize(light.direction) : glm::vec3(0.0f, -1.0f, 0.0f);
+		glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+		glm::vec3 sceneCenter = glm::vec3(lightView * glm::vec4(glm::vec3(sceneSphere), 1.0f));
+
+		float sliceNear = nearPlane;
+		for (int i = 0; i < CASCADE_COUNT; i++) {
+			// Blend of logarithmic and uniform splits
+			float t = (float)(i + 1) / CASCADE_COUNT;
+			float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+			float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+			float sliceFar = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+
+			glm::vec3 corners[8];
+			for (int c = 0; c < 8; c++) {
+				float depth = c < 4 ? sliceNear : sliceFar;
+				glm::vec3 view = glm::vec3((c & 1 ? 1.0f : -1.0f) * tanHalfX * depth, (c & 2 ? 1.0f : -1.0f) * tanHalfY * depth, -depth);
+				corners[c] = glm::vec3(inverseView * glm::vec4(view, 1.0f));
+			}
+			glm::vec3 center = glm::vec3(0.0f);
+			for (int c = 0; c < 8; c++) {
+				center += corners[c] / 8.0f;
+			}
+			float radius = 0.0f;
+			for (int c = 0; c < 8; c++) {
+				radius = std::max(radius, glm::length(corners[c] - center));
+			}
+			radius = std::ceil(radius * 16.0f) / 16.0f;
+
+			glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+			float texelSize = 2.0f * radius / CASCADE_RESOLUTION;
+			lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+			lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+			// Extend towards the light so casters outside the slice still land in the map
+			float maxZ = std::max(lightCenter.z + radius, sceneCenter.z + sceneSphere.w);
+			float minZ = lightCenter.z - radius;
+			glm::mat4 projection = glm::ortho(
+				lightCenter.x - radius, lightCenter.x + radius,
+				lightCenter.y - radius, lightCenter.y + radius,
+				-maxZ, -minZ
+			);
+
+			this->cascadeMatrices[i] = projection * lightView;
+			this->cascadeSplits[i] = sliceFar;
+			this->cascadeTexelSizes[i] = texelSize;
+			sliceNear = sliceFar;
+		}
+	}
+
+	// Perspective covering the outer cone, with the depth range clamped to the scene
+	void fitSpotlight(int index, const SpotLight& light, const glm::vec4& sceneSphere) {
+		glm::vec3 direction = glm::length(light.direction) > 0.0f ? glm::normalize(light.direction) : glm::vec3(0.0f, 0.0f, -1.0f);
+		glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		float fov = 2.0f * std::acos(glm::clamp(light.cosineOuterCutoff, -1.0f, 1.0f)) + glm::radians(2.0f);
+		fov = glm::clamp(fov, glm::radians(1.0f), glm::radians(170.0f));
+		float distance = glm::length(light.position - glm::vec3(sceneSphere));
+		float farPlane = std::max(distance + sceneSphere.w, 0.1f);
+		float nearPlane = std::max(std::max(distance - sceneSphere.w, farPlane * 0.001f), 0.05f);
+		if (nearPlane >= farPlane) {
+			nearPlane = farPlane * 0.5f;
+		}
+		this->spotMatrices[index] = glm::perspective(fov, 1.0f, nearPlane, farPlane) * glm::lookAt(light.position, light.position + direction, up);
+
+		// Maps clip space straight to the light's tile of the atlas
+		float tileScale = 1.0f / SPOT_TILES_PER_ROW;
+		glm::vec2 tileOffset = glm::vec2(index % SPOT_TILES_PER_ROW, index / SPOT_TILES_PER_ROW) * tileScale;
+		glm::mat4 toTile = glm::translate(glm::mat4(1.0f), glm::vec3(tileOffset + tileScale * 0.5f, 0.5f));
+		toTile = glm::scale(toTile, glm::vec3(tileScale * 0.5f, tileScale * 0.5f, 0.5f));
+		this->spotAtlasMatrices[index] = toTile * this->spotMatrices[index];
+	}
+
+	// The far plane is where the attenuated light falls below a small fraction of its color, so the
+	// faces of a light don't depend on where the model is
+	void fitPointLight(int index, const PointLight& light) {
+		const float cutoff = 0.05f;
+		float brightness = std::max(light.color.r, std::max(light.color.g, light.color.b));
+		float c = light.attConstant - brightness / cutoff;
+		float range;
+		if (light.attQuadratic > 0.0f) {
+			range = (-light.attLinear + std::sqrt(std::max(light.attLinear * light.attLinear - 4.0f * light.attQuadratic * c, 0.0f))) / (2.0f * light.attQuadratic);
+		}
+		else if (light.attLinear > 0.0f) {
+			range = -c / light.attLinear;
+		}
+		else {
+			range = 1000.0f;
+		}
+		this->cubeRanges[index] = glm::vec2(0.05f, glm::clamp(range, 1.0f, 1000.0f));
+
+		// Same face order and orientation as the cube map lookup in main.fs
+		const glm::vec3 forward[6] = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+		};
+		const glm::vec3 up[6] = {
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+		};
+		glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, this->cubeRanges[index].x, this->cubeRanges[index].y);
+		for (int f = 0; f < 6; f++) {
+			this->cubeFaceMatrices[index][f] = projection * glm::lookAt(light.position, light.position + forward[f], up[f]);
+		}
+	}
+
+	// Bit f of the result is set if face f of the light has to be re-rendered
+	unsigned int findDirtyFaces(int index, const PointLight& light, unsigned int occupiedFaces, const glm::mat4& modelMatrix, unsigned int geometryVersion) {
+		const CachedCube& cache = this->cubeCache[index];
+		if (!cache.valid || cache.position != light.position || cache.range != this->cubeRanges[index]) {
+			return 0x3F;
+		}
+		if (cache.model != modelMatrix || cache.geometryVersion != geometryVersion) {
+			return cache.occupiedFaces | occupiedFaces;
+		}
+		return 0;
+	}
+
+	// Re-renders the dirty faces of every point light with one layered pass per light
+	void renderPointLights(Model& model, const glm::mat4& modelMatrix, const std::vector<PointLight>& pointLights, const unsigned int* dirtyFaces, const unsigned int* occupiedFaces) {
+		glBindFramebuffer(GL_FRAMEBUFFER, this->cubeFBO);
+		glViewport(0, 0, CUBE_RESOLUTION, CUBE_RESOLUTION);
+		this->cubeDepthShader.use();
+		this->cubeDepthShader.setUniformMat4("model", modelMatrix);
+		this->cubeDepthShader.setUniformMat4("lightSpace", glm::mat4(1.0f));
+		for (int i = 0; i < this->pointShadowCount; i++) {
+			if (!dirtyFaces[i]) {
+				continue;
+			}
+			// Clear the dirty faces one layer at a time, then draw into all of them at once
+			for (int f = 0; f < 6; f++) {
+				if (dirtyFaces[i] & (1u << f)) {
+					glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->cubeArrayTexture, 0, i * 6 + f);
+					glClear(GL_DEPTH_BUFFER_BIT);
+				}
+			}
+			glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->cubeArrayTexture, 0);
+			this->cubeDepthShader.setUniformMat4Array("faceMatrices", 6, this->cubeFaceMatrices[i]);
+			this->cubeDepthShader.setUniformInt("firstLayer", i * 6);
+			model.drawDepthLayered(this->cubeDepthShader, modelMatrix, this->cubeFaceMatrices[i], 6, dirtyFaces[i]);
+
+			CachedCube& cache = this->cubeCache[i];
+			cache.valid = true;
+			cache.position = pointLights[i].position;
+			cache.range = this->cubeRanges[i];
+			cache.occupiedFaces = occupiedFaces[i];
+			cache.model = modelMatrix;
+			cache.geometryVersion = model.geometryVersion;
+		}
+	}
+
+public:
+	ShadowMaps() :
+		depthShader("shaders/shadow.vs", "shaders/shadow.fs"),
+		cubeDepthShader("shaders/shadow.vs", "shaders/shadowcube.gs", "shaders/shadow.fs") {
+		glGenTextures(1, &this->cascadeTexture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->cascadeTexture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, CASCADE_RESOLUTION, CASCADE_RESOLUTION, CASCADE_COUNT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		setShadowSampling(GL_TEXTURE_2D_ARRAY);
+		this->cascadeFBO = createDepthFramebuffer();
+
+		glGenTextures(1, &this->spotAtlasTexture);
+		glBindTexture(GL_TEXTURE_2D, this->spotAtlasTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SPOT_TILES_PER_ROW * SPOT_TILE_RESOLUTION, SPOT_TILES_PER_ROW * SPOT_TILE_RESOLUTION, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		setShadowSampling(GL_TEXTURE_2D);
+		this->spotFBO = createDepthFramebuffer();
+		glBindFramebuffer(GL_FRAMEBUFFER, this->spotFBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->spotAtlasTexture, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glGenTextures(1, &this->cubeArrayTexture);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, this->cubeArrayTexture);
+		glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT24, CUBE_RESOLUTION, CUBE_RESOLUTION, MAX_POINT_LIGHTS * 6, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		setShadowSampling(GL_TEXTURE_CUBE_MAP_ARRAY);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		this->cubeFBO = createDepthFramebuffer();
+
+		for (int i = 0; i < CASCADE_COUNT; i++) {
+			this->cascadeMatrices[i] = glm::mat4(1.0f);
+		}
+		for (int i = 0; i < MAX_SPOT_LIGHTS; i++) {
+			this->spotMatrices[i] = this->spotAtlasMatrices[i] = glm::mat4(1.0f);
+		}
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+			this->cubeRanges[i] = glm::vec2(0.05f, 1.0f);
+		}
+		this->cascadeSplits = glm::vec4(0.0f);
+		this->cascadeTexelSizes = glm::vec4(0.0f);
+	}
+
+	// Forces every map to re-render, e.g. after a different model was loaded
+	void invalidate() {
+		for (int i = 0; i < CASCADE_COUNT; i++) {
+			this->cascadeCache[i].valid = false;
+		}
+		for (int i = 0; i < MAX_SPOT_LIGHTS; i++) {
+			this->spotCache[i].valid = false;
+		}
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++) {
+			this->cubeCache[i].valid = false;
+		}
+	}
+
+	// Refits the light matrices and re-renders the maps whose inputs changed
+	void update(Model& model, const glm::mat4& modelMatrix, const std::vector<PointLight>& pointLights, const DirectionalLight& dirLight, const std::vector<SpotLight>& spotlights, const Camera& camera) {
+		glm::vec4 sceneSphere = model.getBoundingSphere(modelMatrix);
+		int spotCount = std::min((int)spotlights.size(), (int)MAX_SPOT_LIGHTS);
+		fitCascades(dirLight, camera, sceneSphere);
+		for (int i = 0; i < spotCount; i++) {
+			fitSpotlight(i, spotlights[i], sceneSphere);
+		}
+		this->pointShadowCount = std::min((int)pointLights.size(), (int)MAX_POINT_LIGHTS);
+		for (int i = 0; i < this->pointShadowCount; i++) {
+			fitPointLight(i, pointLights[i]);
+		}
+
+		bool cascadeDirty[CASCADE_COUNT], spotDirty[MAX_SPOT_LIGHTS];
+		bool anyDirty = false;
+		for (int i = 0; i < CASCADE_COUNT; i++) {
+			cascadeDirty[i] = !isCached(this->cascadeCache[i], this->cascadeMatrices[i], modelMatrix, model.geometryVersion);
+			anyDirty |= cascadeDirty[i];
+		}
+		for (int i = 0; i < spotCount; i++) {
+			spotDirty[i] = !isCached(this->spotCache[i], this->spotMatrices[i], modelMatrix, model.geometryVersion);
+			anyDirty |= spotDirty[i];
+		}
+		unsigned int pointDirty[MAX_POINT_LIGHTS], pointOccupied[MAX_POINT_LIGHTS];
+		for (int i = 0; i < this->pointShadowCount; i++) {
+			pointOccupied[i] = model.findOccupiedFrustums(modelMatrix, this->cubeFaceMatrices[i], 6);
+			pointDirty[i] = findDirtyFaces(i, pointLights[i], pointOccupied[i], modelMatrix, model.geometryVersion);
+			anyDirty |= pointDirty[i] != 0;
+		}
+		if (!anyDirty) {
+			return;
+		}
+
+		int viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		// Slope scaled bias against shadow acne
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+
+		renderPointLights(model, modelMatrix, pointLights, pointDirty, pointOccupied);
+
+		this->depthShader.use();
+		this->depthShader.setUniformMat4("model", modelMatrix);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, this->cascadeFBO);
+		glViewport(0, 0, CASCADE_RESOLUTION, CASCADE_RESOLUTION);
+		for (int i = 0; i < CASCADE_COUNT; i++) {
+			if (!cascadeDirty[i]) {
+				continue;
+			}
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->cascadeTexture, 0, i);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			this->depthShader.setUniformMat4("lightSpace", this->cascadeMatrices[i]);
+			model.drawDepth(this->depthShader, modelMatrix, this->cascadeMatrices[i]);
+			this->cascadeCache[i] = CachedMap{ true, this->cascadeMatrices[i], modelMatrix, model.geometryVersion };
+		}
+
+		// The scissor keeps the clear inside the light's own tile
+		glBindFramebuffer(GL_FRAMEBUFFER, this->spotFBO);
+		glEnable(GL_SCISSOR_TEST);
+		for (int i = 0; i < spotCount; i++) {
+			if (!spotDirty[i]) {
+				continue;
+			}
+			int x = (i % SPOT_TILES_PER_ROW) * SPOT_TILE_RESOLUTION;
+			int y = (i / SPOT_TILES_PER_ROW) * SPOT_TILE_RESOLUTION;
+			glViewport(x, y, SPOT_TILE_RESOLUTION, SPOT_TILE_RESOLUTION);
+			glScissor(x, y, SPOT_TILE_RESOLUTION, SPOT_TILE_RESOLUTION);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			this->depthShader.setUniformMat4("lightSpace", this->spotMatrices[i]);
+			model.drawDepth(this->depthShader, modelMatrix, this->spotMatrices[i]);
+			this->spotCache[i] = CachedMap{ true, this->spotMatrices[i], modelMatrix, model.geometryVersion };
+		}
+		glDisable(GL_SCISSOR_TEST);
+
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+
+	// Binds the maps to texture units 5, 6 and 7 and sets the lookup uniforms of main.fs
+	void bind(ShaderProgram& shader, bool enabled) {
+		shader.setUniformInt("shadowsEnabled", enabled);
+		shader.setUniformInt("cascadeShadowMap", 5);
+		glActiveTexture(GL_TEXTURE5);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->cascadeTexture);
+		shader.setUniformInt("spotShadowAtlas", 6);
+		glActiveTexture(GL_TEXTURE6);
+		glBindTexture(GL_TEXTURE_2D, this->spotAtlasTexture);
+		shader.setUniformInt("pointShadowMaps", 7);
+		glActiveTexture(GL_TEXTURE7);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, this->cubeArrayTexture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setUniformMat4Array("cascadeMatrices", CASCADE_COUNT, this->cascadeMatrices);
+		shader.setUniformVec4("cascadeSplits", this->cascadeSplits);
+		shader.setUniformVec4("cascadeTexelSizes", this->cascadeTexelSizes);
+		shader.setUniformMat4Array("spotShadowMatrices", MAX_SPOT_LIGHTS, this->spotAtlasMatrices);
+		shader.setUniformInt("numPointShadows", this->pointShadowCount);
+		shader.setUniformVec2Array("pointShadowRanges", MAX_POINT_LIGHTS, this->cubeRanges);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,812 @@
+#pragma once
+
+#include <Model.h>
+#include <Light.h>
+#include <AmbientProbe.h>
+#include <Environment.h>
+#include <SoftwareTexture.h>
+#include <JobSystem.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_RENDERER_SSE 1
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SOFTWARE_RENDERER_AVX2 1
+#endif
+
+// Four floats processed together, one per pixel of a quad of the shading loop
+struct Lanes {
+#ifdef SOFTWARE_RENDERER_SSE
+	__m128 v;
+	Lanes() {}
+	Lanes(float f) : v(_mm_set1_ps(f)) {}
+	explicit Lanes(__m128 v) : v(v) {}
+	static Lanes load(const float* p) { return Lanes(_mm_loadu_ps(p)); }
+	void store(float* p) const { _mm_storeu_ps(p, this->v); }
+#else
+	float v[4];
+	Lanes() {}
+	Lanes(float f) { v[0] = v[1] = v[2] = v[3] = f; }
+	static Lanes load(const float* p) { Lanes r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+	void store(float* p) const { for (int i = 0; i < 4; i++) p[i] = this->v[i]; }
+#endif
+};
+
+#ifdef SOFTWARE_RENDERER_SSE
+inline Lanes operator+(Lanes a, Lanes b) { return Lanes(_mm_add_ps(a.v, b.v)); }
+inline Lanes operator-(Lanes a, Lanes b) { return Lanes(_mm_sub_ps(a.v, b.v)); }
+inline Lanes operator*(Lanes a, Lanes b) { return Lanes(_mm_mul_ps(a.v, b.v)); }
+inline Lanes operator/(Lanes a, Lanes b) { return Lanes(_mm_div_ps(a.v, b.v)); }
+inline Lanes min(Lanes a, Lanes b) { return Lanes(_mm_min_ps(a.v, b.v)); }
+inline Lanes max(Lanes a, Lanes b) { return Lanes(_mm_max_ps(a.v, b.v)); }
+inline Lanes sqrt(Lanes a) { return Lanes(_mm_sqrt_ps(a.v)); }
+#else
+#define SOFTWARE_RENDERER_LANES_OP(signature, expression) \
+	inline Lanes signature { Lanes r; for (int i = 0; i < 4; i++) r.v[i] = expression; return r; }
+SOFTWARE_RENDERER_LANES_OP(operator+(Lanes a, Lanes b), a.v[i] + b.v[i])
+SOFTWARE_RENDERER_LANES_OP(operator-(Lanes a, Lanes b), a.v[i] - b.v[i])
+SOFTWARE_RENDERER_LANES_OP(operator*(Lanes a, Lanes b), a.v[i] * b.v[i])
+SOFTWARE_RENDERER_LANES_OP(operator/(Lanes a, Lanes b), a.v[i] / b.v[i])
+SOFTWARE_RENDERER_LANES_OP(min(Lanes a, Lanes b), b.v[i] < a.v[i] ? b.v[i] : a.v[i])
+SOFTWARE_RENDERER_LANES_OP(max(Lanes a, Lanes b), a.v[i] < b.v[i] ? b.v[i] : a.v[i])
+SOFTWARE_RENDERER_LANES_OP(sqrt(Lanes a), std::sqrt(a.v[i]))
+#undef SOFTWARE_RENDERER_LANES_OP
+#endif
+
+struct Lanes3 {
+	Lanes x, y, z;
+	Lanes3() {}
+	Lanes3(Lanes x, Lanes y, Lanes z) : x(x), y(y), z(z) {}
+	Lanes3(const glm::vec3& v) : x(v.x), y(v.y), z(v.z) {}
+};
+
+inline Lanes3 operator+(const Lanes3& a, const Lanes3& b) { return Lanes3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Lanes3 operator-(const Lanes3& a, const Lanes3& b) { return Lanes3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Lanes3 operator*(const Lanes3& a, const Lanes3& b) { return Lanes3(a.x * b.x, a.y * b.y, a.z * b.z); }
+inline Lanes3 operator*(const Lanes3& a, Lanes b) { return Lanes3(a.x * b, a.y * b, a.z * b); }
+inline Lanes3 operator/(const Lanes3& a, Lanes b) { return Lanes3(a.x / b, a.y / b, a.z / b); }
+inline Lanes dot(const Lanes3& a, const Lanes3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Lanes3 normalize(const Lanes3& a) { return a / sqrt(dot(a, a)); }
+
+// Multithreaded CPU rasterizer implementing the shading of main.vs and main.fs, for producing
+// images on machines without a GPU. Every frame goes through:
+//	1. Vertex stage: the vertices of the visible meshes are transformed in parallel.
+//	2. Setup: triangles are clipped against the near and far planes and a guard band, snapped to
+//	   1/16 pixel and binned into 64x64 pixel tiles. Fixed size chunks of triangles are set up in
+//	   parallel and binned in order, so the result doesn't depend on the number of threads.
+//	3. Tiles: each tile is rasterized into a visibility buffer (depth and triangle id) with SIMD edge
+//	   functions, skipping 8x8 blocks that a hierarchical depth buffer proves hidden, then shaded
+//	   once per pixel with four pixels at a time going through the light loops.
+// Shadows are not rendered, ambient light comes from the probe and environment as in main.fs.
+class SoftwareRenderer {
+public:
+	static const int TILE_SIZE = 64;
+	static const int BLOCK_SIZE = 8;
+	// Fixed point edge functions fit in 32 bits within a block up to this size, see guardBand()
+	static const int MAX_SIZE = 4096;
+
+private:
+	static const int SUBPIXEL_BITS = 4;
+	static const int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+	static const int CHUNK_TRIANGLES = 4096;
+	static const unsigned int NO_TRIANGLE = 0xFFFFFFFF;
+
+	// Outputs of main.vs
+	struct ShadedVertex {
+		glm::vec4 clipPosition;
+		glm::vec3 worldPosition;
+		glm::vec3 normal;
+		glm::vec3 tangent;
+		glm::vec3 bitangent;
+		glm::vec2 textureCoord;
+	};
+
+	// Clip space polygon vertex, barycentric holds its weights of the source triangle's vertices
+	struct ClipVertex {
+		glm::vec4 position;
+		glm::vec3 barycentric;
+	};
+
+	struct RasterTriangle {
+		// Snapped screen positions in 1/16 pixels (y down), ordered so edge functions are positive inside
+		int x[3], y[3];
+		// Edge i is opposite vertex i, 1 for edges excluded by the fill rule
+		int bias[3];
+		// Inclusive pixel bounds
+		int minX, minY, maxX, maxY;
+		// Planes over the screen relative to vertex 0: depth, and the 3 barycentrics divided by w
+		float originX, originY;
+		float depth, depthDx, depthDy, minDepth;
+		glm::vec3 weights, weightsDx, weightsDy;
+		// Barycentrics of this triangle's vertices relative to the source triangle
+		glm::mat3 sourceBarycentrics;
+		unsigned int sourceVertices[3];
+	};
+
+	// Per pixel inputs of the light loops, gathered from the visibility buffer
+	struct Surface {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec3 viewingDirection;
+		glm::vec3 albedo;
+		float metallic;
+		float roughness;
+		float ao;
+	};
+
+	struct Scene {
+		const SoftwareTexture* textures;
+		const std::vector<PointLight>* pointLights;
+		const DirectionalLight* dirLight;
+		const std::vector<SpotLight>* spotlights;
+		const glm::vec3* probeSH;
+		const Environment* environment;
+		glm::vec3 cameraPosition;
+	};
+
+	int width, height;
+	int tilesX, tilesY;
+	int blocksX, blocksY;
+	// Its own job system for a given thread count, otherwise the shared one
+	std::unique_ptr<JobSystem> ownJobs;
+	JobSystem* jobs;
+
+	std::vector<ShadedVertex> vertices;
+	std::vector<unsigned int> triangleIndices;
+	std::vector<std::vector<RasterTriangle>> chunkTriangles;
+	// Per chunk, per tile: indices into the chunk's triangles
+	std::vector<std::vector<std::vector<unsigned int>>> chunkBins;
+	std::vector<unsigned int> chunkOffsets;
+	std::vector<RasterTriangle> triangles;
+
+	std::vector<float> depthBuffer;
+	std::vector<unsigned int> triangleBuffer;
+	// Farthest depth in every 8x8 block
+	std::vector<float> blockMaxDepth;
+	std::vector<unsigned char> image;
+
+	static long long floorDivide(long long a, long long b) {
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	// Clips a polygon against dot(plane, position) >= 0
+	static int clipPolygon(const ClipVertex* input, int count, const glm::vec4& plane, ClipVertex* output) {
+		int outputCount = 0;
+		for (int i = 0; i < count; i++) {
+			const ClipVertex& a = input[i];
+			const ClipVertex& b = input[(i + 1) % count];
+			float da = glm::dot(plane, a.position), db = glm::dot(plane, b.position);
+			if (da >= 0.0f) {
+				output[outputCount++] = a;
+			}
+			if ((da >= 0.0f) != (db >= 0.0f)) {
+				float t = da / (da - db);
+				output[outputCount].position = glm::mix(a.position, b.position, t);
+				output[outputCount].barycentric = glm::mix(a.barycentric, b.barycentric, t);
+				outputCount++;
+			}
+		}
+		return outputCount;
+	}
+
+	// Largest |ndc.xy| before clipping, keeps snapped coordinates within 8192 pixels of the origin
+	float guardBand() const {
+		return std::min(4.0f, 16384.0f / std::max(this->width, this->height) - 1.0f);
+	}
+
+	void vertexStage(Model& model, const glm::mat4& modelMatrix, const Camera& camera) {
+		Frustum objectFrustum = Frustum(camera.projection * camera.view * modelMatrix);
+		glm::mat3 inverseModel = glm::mat3(glm::transpose(glm::inverse(modelMatrix)));
+		glm::mat4 modelViewProjection = camera.projection * camera.view * modelMatrix;
+
+		this->vertices.clear();
+		this->triangleIndices.clear();
+		std::vector<const Mesh*> visible;
+		std::vector<unsigned int> vertexOffsets;
+		for (int i = 0; i < model.meshes.size(); i++) {
+			if (!model.meshes[i].isVisible(objectFrustum)) {
+				continue;
+			}
+			const Mesh& mesh = model.meshes[i];
+			const MeshLod& lod = mesh.getCurrentLod();
+			const std::vector<unsigned int>& indices = mesh.getIndices();
+			unsigned int offset = (unsigned int)this->vertices.size();
+			for (unsigned int j = 0; j < lod.indexCount; j++) {
+				this->triangleIndices.push_back(indices[lod.indexOffset + j] + offset);
+			}
+			visible.push_back(&mesh);
+			vertexOffsets.push_back(offset);
+			this->vertices.resize(offset + mesh.getVertices().size());
+		}
+
+		for (int m = 0; m < visible.size(); m++) {
+			const std::vector<Vertex>& source = visible[m]->getVertices();
+			ShadedVertex* destination = &this->vertices[vertexOffsets[m]];
+			size_t batches = (source.size() + 1023) / 1024;
+			this->jobs->parallelFor(batches, 1, [&](size_t batch) {
+				size_t end = std::min(source.size(), (batch + 1) * 1024);
+				for (size_t i = batch * 1024; i < end; i++) {
+					const Vertex& v = source[i];
+					ShadedVertex& out = destination[i];
+					out.normal = inverseModel * v.normal;
+					out.tangent = glm::mat3(modelMatrix) * glm::vec3(v.tangent);
+					out.bitangent = -glm::cross(glm::normalize(out.normal), glm::normalize(out.tangent)) * (v.tangent.w < 0.0f ? -1.0f : 1.0f);
+					out.textureCoord = glm::vec2(v.textureCoord);
+					out.worldPosition = glm::vec3(modelMatrix * glm::vec4(v.position, 1.0f));
+					out.clipPosition = modelViewProjection * glm::vec4(v.position, 1.0f);
+				}
+			});
+		}
+	}
+
+	// Snaps a clipped triangle to the pixel grid and computes its edge and interpolation planes.
+	// Returns false for triangles that cover no pixel centers.
+	bool setupTriangle(const ClipVertex* polygon, int a, int b, int c, const unsigned int* sourceVertices, RasterTriangle& triangle) {
+		int order[3] = { a, b, c };
+		float screenX[3], screenY[3], depth[3], inverseW[3];
+		for (int i = 0; i < 3; i++) {
+			const glm::vec4& p = polygon[order[i]].position;
+			inverseW[i] = 1.0f / p.w;
+			screenX[i] = (p.x * inverseW[i] * 0.5f + 0.5f) * this->width;
+			screenY[i] = (0.5f - p.y * inverseW[i] * 0.5f) * this->height;
+			depth[i] = p.z * inverseW[i] * 0.5f + 0.5f;
+			triangle.x[i] = (int)std::lround(screenX[i] * SUBPIXEL_SCALE);
+			triangle.y[i] = (int)std::lround(screenY[i] * SUBPIXEL_SCALE);
+		}
+		long long area = (long long)(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (long long)(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+		if (area == 0) {
+			return false;
+		}
+		// There is no face culling in the GL path, both windings are drawn
+		if (area < 0) {
+			std::swap(order[1], order[2]);
+			std::swap(triangle.x[1], triangle.x[2]);
+			std::swap(triangle.y[1], triangle.y[2]);
+			std::swap(depth[1], depth[2]);
+			std::swap(inverseW[1], inverseW[2]);
+		}
+
+		int minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+		int maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+		int minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+		int maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+		// Pixel centers are at +8 in 1/16 pixels
+		triangle.minX = std::max(0, (int)floorDivide(minX - SUBPIXEL_SCALE / 2 + SUBPIXEL_SCALE - 1, SUBPIXEL_SCALE));
+		triangle.minY = std::max(0, (int)floorDivide(minY - SUBPIXEL_SCALE / 2 + SUBPIXEL_SCALE - 1, SUBPIXEL_SCALE));
+		triangle.maxX = std::min(this->width - 1, (int)floorDivide(maxX - SUBPIXEL_SCALE / 2, SUBPIXEL_SCALE));
+		triangle.maxY = std::min(this->height - 1, (int)floorDivide(maxY - SUBPIXEL_SCALE / 2, SUBPIXEL_SCALE));
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+			return false;
+		}
+
+		// Fill rule: pixel centers exactly on an edge belong to the triangle on its top or left side,
+		// so neighbouring triangles never both draw them
+		for (int i = 0; i < 3; i++) {
+			int from = (i + 1) % 3, to = (i + 2) % 3;
+			int dx = triangle.x[to] - triangle.x[from], dy = triangle.y[to] - triangle.y[from];
+			triangle.bias[i] = dy < 0 || (dy == 0 && dx > 0) ? 0 : 1;
+		}
+
+		// Interpolation planes from the snapped positions
+		double x[3], y[3];
+		for (int i = 0; i < 3; i++) {
+			x[i] = (double)triangle.x[i] / SUBPIXEL_SCALE;
+			y[i] = (double)triangle.y[i] / SUBPIXEL_SCALE;
+		}
+		double pixelArea = (double)area / (SUBPIXEL_SCALE * SUBPIXEL_SCALE);
+		pixelArea = std::abs(pixelArea);
+		double dx[3] = { (y[1] - y[2]) / pixelArea, (y[2] - y[0]) / pixelArea, (y[0] - y[1]) / pixelArea };
+		double dy[3] = { (x[2] - x[1]) / pixelArea, (x[0] - x[2]) / pixelArea, (x[1] - x[0]) / pixelArea };
+		triangle.originX = (float)x[0];
+		triangle.originY = (float)y[0];
+		triangle.depth = depth[0];
+		triangle.depthDx = (float)(dx[0] * depth[0] + dx[1] * depth[1] + dx[2] * depth[2]);
+		triangle.depthDy = (float)(dy[0] * depth[0] + dy[1] * depth[1] + dy[2] * depth[2]);
+		triangle.minDepth = std::min(depth[0], std::min(depth[1], depth[2]));
+		triangle.weights = glm::vec3(inverseW[0], 0.0f, 0.0f);
+		triangle.weightsDx = glm::vec3(dx[0] * inverseW[0], dx[1] * inverseW[1], dx[2] * inverseW[2]);
+		triangle.weightsDy = glm::vec3(dy[0] * inverseW[0], dy[1] * inverseW[1], dy[2] * inverseW[2]);
+		for (int i = 0; i < 3; i++) {
+			triangle.sourceBarycentrics[i] = polygon[order[i]].barycentric;
+			triangle.sourceVertices[i] = sourceVertices[i];
+		}
+		return true;
+	}
+
+	// Clips, sets up and bins one chunk of triangles
+	void setupChunk(size_t chunk) {
+		std::vector<RasterTriangle>& output = this->chunkTriangles[chunk];
+		std::vector<std::vector<unsigned int>>& bins = this->chunkBins[chunk];
+		output.clear();
+		for (size_t t = 0; t < bins.size(); t++) {
+			bins[t].clear();
+		}
+
+		float band = guardBand();
+		const glm::vec4 planes[6] = {
+			glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 1.0f),
+			glm::vec4(1.0f, 0.0f, 0.0f, band), glm::vec4(-1.0f, 0.0f, 0.0f, band),
+			glm::vec4(0.0f, 1.0f, 0.0f, band), glm::vec4(0.0f, -1.0f, 0.0f, band)
+		};
+		size_t triangleCount = this->triangleIndices.size() / 3;
+		size_t end = std::min(triangleCount, (chunk + 1) * CHUNK_TRIANGLES);
+		for (size_t t = chunk * CHUNK_TRIANGLES; t < end; t++) {
+			const unsigned int* source = &this->triangleIndices[t * 3];
+			ClipVertex polygon[2][12];
+			unsigned int outside[3] = { 0, 0, 0 };
+			for (int i = 0; i < 3; i++) {
+				polygon[0][i].position = this->vertices[source[i]].clipPosition;
+				polygon[0][i].barycentric = glm::vec3(i == 0, i == 1, i == 2);
+				for (int p = 0; p < 6; p++) {
+					if (glm::dot(planes[p], polygon[0][i].position) < 0.0f) {
+						outside[i] |= 1u << p;
+					}
+				}
+			}
+			if (outside[0] & outside[1] & outside[2]) {
+				continue;
+			}
+			int count = 3, current = 0;
+			unsigned int crossed = outside[0] | outside[1] | outside[2];
+			for (int p = 0; p < 6 && count >= 3; p++) {
+				if (crossed & (1u << p)) {
+					count = clipPolygon(polygon[current], count, planes[p], polygon[1 - current]);
+					current = 1 - current;
+				}
+			}
+
+			for (int i = 1; i + 1 < count; i++) {
+				RasterTriangle triangle;
+				if (!setupTriangle(polygon[current], 0, i, i + 1, source, triangle)) {
+					continue;
+				}
+				unsigned int index = (unsigned int)output.size();
+				output.push_back(triangle);
+				for (int ty = triangle.minY / TILE_SIZE; ty <= triangle.maxY / TILE_SIZE; ty++) {
+					for (int tx = triangle.minX / TILE_SIZE; tx <= triangle.maxX / TILE_SIZE; tx++) {
+						bins[ty * this->tilesX + tx].push_back(index);
+					}
+				}
+			}
+		}
+	}
+
+	// Edge function i at the center of pixel (px, py), minus the fill rule bias. Pixels with all
+	// three values >= 0 are covered.
+	static long long edgeValue(const RasterTriangle& triangle, int i, int px, int py) {
+		int from = (i + 1) % 3, to = (i + 2) % 3;
+		long long sx = (long long)px * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+		long long sy = (long long)py * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+		return (long long)(triangle.x[to] - triangle.x[from]) * (sy - triangle.y[from]) - (long long)(triangle.y[to] - triangle.y[from]) * (sx - triangle.x[from]) - triangle.bias[i];
+	}
+
+	// Rasterizes the part of a triangle inside one 8x8 block into the visibility buffer.
+	// Returns whether any pixel was written.
+	bool rasterizeBlock(const RasterTriangle& triangle, unsigned int id, int blockX, int blockY) {
+		int x0 = blockX * BLOCK_SIZE, y0 = blockY * BLOCK_SIZE;
+		int x1 = std::min(x0 + BLOCK_SIZE, this->width) - 1, y1 = std::min(y0 + BLOCK_SIZE, this->height) - 1;
+
+		// Edge values are linear, so their extremes over the block are at its corners. Edges that
+		// cover the whole block are left out, the others stay within 32 bits inside the block.
+		int rowValue[3], stepX[3], stepY[3];
+		for (int i = 0; i < 3; i++) {
+			long long corners[4] = { edgeValue(triangle, i, x0, y0), edgeValue(triangle, i, x1, y0), edgeValue(triangle, i, x0, y1), edgeValue(triangle, i, x1, y1) };
+			long long low = std::min(std::min(corners[0], corners[1]), std::min(corners[2], corners[3]));
+			long long high = std::max(std::max(corners[0], corners[1]), std::max(corners[2], corners[3]));
+			if (high < 0) {
+				return false;
+			}
+			if (low >= 0) {
+				rowValue[i] = stepX[i] = stepY[i] = 0;
+			}
+			else {
+				int from = (i + 1) % 3, to = (i + 2) % 3;
+				rowValue[i] = (int)corners[0];
+				stepX[i] = -(triangle.y[to] - triangle.y[from]) * SUBPIXEL_SCALE;
+				stepY[i] = (triangle.x[to] - triangle.x[from]) * SUBPIXEL_SCALE;
+			}
+		}
+
+		// Offsets of the 8 pixels of a row from the row's first pixel
+		int laneValue[3][BLOCK_SIZE];
+		float laneDepth[BLOCK_SIZE];
+		for (int x = 0; x < BLOCK_SIZE; x++) {
+			for (int i = 0; i < 3; i++) {
+				laneValue[i][x] = x * stepX[i];
+			}
+			laneDepth[x] = (float)x * triangle.depthDx;
+		}
+
+		float rowDepth = triangle.depth + triangle.depthDx * (x0 + 0.5f - triangle.originX) + triangle.depthDy * (y0 + 0.5f - triangle.originY);
+		bool written = false;
+		bool fullWidth = x1 - x0 + 1 == BLOCK_SIZE;
+		for (int y = y0; y <= y1; y++) {
+			float* depthRow = &this->depthBuffer[(size_t)y * this->width + x0];
+			unsigned int* triangleRow = &this->triangleBuffer[(size_t)y * this->width + x0];
+#if defined(SOFTWARE_RENDERER_AVX2)
+			if (fullWidth) {
+				__m256i e0 = _mm256_add_epi32(_mm256_set1_epi32(rowValue[0]), _mm256_loadu_si256((const __m256i*)laneValue[0]));
+				__m256i e1 = _mm256_add_epi32(_mm256_set1_epi32(rowValue[1]), _mm256_loadu_si256((const __m256i*)laneValue[1]));
+				__m256i e2 = _mm256_add_epi32(_mm256_set1_epi32(rowValue[2]), _mm256_loadu_si256((const __m256i*)laneValue[2]));
+				// Covered where no edge value has its sign bit set
+				__m256i outside = _mm256_srai_epi32(_mm256_or_si256(_mm256_or_si256(e0, e1), e2), 31);
+				__m256 depth = _mm256_add_ps(_mm256_set1_ps(rowDepth), _mm256_loadu_ps(laneDepth));
+				__m256 stored = _mm256_loadu_ps(depthRow);
+				__m256 pass = _mm256_andnot_ps(_mm256_castsi256_ps(outside), _mm256_cmp_ps(depth, stored, _CMP_LT_OQ));
+				if (_mm256_movemask_ps(pass)) {
+					_mm256_storeu_ps(depthRow, _mm256_blendv_ps(stored, depth, pass));
+					__m256 ids = _mm256_loadu_ps((const float*)triangleRow);
+					_mm256_storeu_ps((float*)triangleRow, _mm256_blendv_ps(ids, _mm256_castsi256_ps(_mm256_set1_epi32((int)id)), pass));
+					written = true;
+				}
+			}
+			else
+#elif defined(SOFTWARE_RENDERER_SSE)
+			if (fullWidth) {
+				for (int half = 0; half < BLOCK_SIZE; half += 4) {
+					__m128i e0 = _mm_add_epi32(_mm_set1_epi32(rowValue[0]), _mm_loadu_si128((const __m128i*)&laneValue[0][half]));
+					__m128i e1 = _mm_add_epi32(_mm_set1_epi32(rowValue[1]), _mm_loadu_si128((const __m128i*)&laneValue[1][half]));
+					__m128i e2 = _mm_add_epi32(_mm_set1_epi32(rowValue[2]), _mm_loadu_si128((const __m128i*)&laneValue[2][half]));
+					__m128i outside = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(e0, e1), e2), 31);
+					__m128 depth = _mm_add_ps(_mm_set1_ps(rowDepth), _mm_loadu_ps(&laneDepth[half]));
+					__m128 stored = _mm_loadu_ps(depthRow + half);
+					__m128i pass = _mm_andnot_si128(outside, _mm_castps_si128(_mm_cmplt_ps(depth, stored)));
+					if (_mm_movemask_epi8(pass)) {
+						__m128i depthBits = _mm_or_si128(_mm_and_si128(pass, _mm_castps_si128(depth)), _mm_andnot_si128(pass, _mm_castps_si128(stored)));
+						_mm_storeu_ps(depthRow + half, _mm_castsi128_ps(depthBits));
+						__m128i ids = _mm_loadu_si128((const __m128i*)(triangleRow + half));
+						_mm_storeu_si128((__m128i*)(triangleRow + half), _mm_or_si128(_mm_and_si128(pass, _mm_set1_epi32((int)id)), _mm_andnot_si128(pass, ids)));
+						written = true;
+					}
+				}
+			}
+			else
+#endif
+			{
+				for (int x = 0; x <= x1 - x0; x++) {
+					int e0 = rowValue[0] + laneValue[0][x], e1 = rowValue[1] + laneValue[1][x], e2 = rowValue[2] + laneValue[2][x];
+					float depth = rowDepth + laneDepth[x];
+					if ((e0 | e1 | e2) >= 0 && depth < depthRow[x]) {
+						depthRow[x] = depth;
+						triangleRow[x] = id;
+						written = true;
+					}
+				}
+			}
+			for (int i = 0; i < 3; i++) {
+				rowValue[i] += stepY[i];
+			}
+			rowDepth += triangle.depthDy;
+		}
+		return written;
+	}
+
+	void updateBlockMaxDepth(int blockX, int blockY) {
+		int x0 = blockX * BLOCK_SIZE, y0 = blockY * BLOCK_SIZE;
+		int x1 = std::min(x0 + BLOCK_SIZE, this->width), y1 = std::min(y0 + BLOCK_SIZE, this->height);
+		float farthest = 0.0f;
+		for (int y = y0; y < y1; y++) {
+			const float* row = &this->depthBuffer[(size_t)y * this->width];
+			for (int x = x0; x < x1; x++) {
+				farthest = std::max(farthest, row[x]);
+			}
+		}
+		this->blockMaxDepth[blockY * this->blocksX + blockX] = farthest;
+	}
+
+	void rasterizeTile(int tile) {
+		int tileX = tile % this->tilesX, tileY = tile / this->tilesX;
+		int blocksPerTile = TILE_SIZE / BLOCK_SIZE;
+		for (size_t chunk = 0; chunk < this->chunkBins.size(); chunk++) {
+			const std::vector<unsigned int>& bin = this->chunkBins[chunk][tile];
+			for (size_t i = 0; i < bin.size(); i++) {
+				unsigned int id = this->chunkOffsets[chunk] + bin[i];
+				const RasterTriangle& triangle = this->triangles[id];
+				int bx0 = std::max(triangle.minX / BLOCK_SIZE, tileX * blocksPerTile);
+				int by0 = std::max(triangle.minY / BLOCK_SIZE, tileY * blocksPerTile);
+				int bx1 = std::min(triangle.maxX / BLOCK_SIZE, (tileX + 1) * blocksPerTile - 1);
+				int by1 = std::min(triangle.maxY / BLOCK_SIZE, (tileY + 1) * blocksPerTile - 1);
+				for (int by = by0; by <= by1; by++) {
+					for (int bx = bx0; bx <= bx1; bx++) {
+						// Hierarchical depth test: everything in the block is already closer
+						if (triangle.minDepth >= this->blockMaxDepth[by * this->blocksX + bx]) {
+							continue;
+						}
+						if (rasterizeBlock(triangle, id, bx, by)) {
+							updateBlockMaxDepth(bx, by);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Perspective correct barycentrics of the source triangle at a point on the screen
+	static glm::vec3 sourceBarycentrics(const RasterTriangle& triangle, float x, float y) {
+		glm::vec3 weights = triangle.weights + triangle.weightsDx * (x - triangle.originX) + triangle.weightsDy * (y - triangle.originY);
+		return triangle.sourceBarycentrics * (weights / (weights.x + weights.y + weights.z));
+	}
+
+	// Everything main.fs reads from its inputs and the material textures
+	Surface gatherSurface(const Scene& scene, unsigned int id, int px, int py) const {
+		const RasterTriangle& triangle = this->triangles[id];
+		const ShadedVertex& v0 = this->vertices[triangle.sourceVertices[0]];
+		const ShadedVertex& v1 = this->vertices[triangle.sourceVertices[1]];
+		const ShadedVertex& v2 = this->vertices[triangle.sourceVertices[2]];
+		float x = px + 0.5f, y = py + 0.5f;
+		glm::vec3 b = sourceBarycentrics(triangle, x, y);
+		glm::vec3 bx = sourceBarycentrics(triangle, x + 1.0f, y);
+		glm::vec3 by = sourceBarycentrics(triangle, x, y + 1.0f);
+		glm::vec2 uv = v0.textureCoord * b.x + v1.textureCoord * b.y + v2.textureCoord * b.z;
+		glm::vec2 dUVdx = v0.textureCoord * bx.x + v1.textureCoord * bx.y + v2.textureCoord * bx.z - uv;
+		glm::vec2 dUVdy = v0.textureCoord * by.x + v1.textureCoord * by.y + v2.textureCoord * by.z - uv;
+
+		Surface surface;
+		surface.position = v0.worldPosition * b.x + v1.worldPosition * b.y + v2.worldPosition * b.z;
+		surface.albedo = glm::pow(glm::vec3(scene.textures[0].sample(uv, dUVdx, dUVdy)), glm::vec3(2.2f));
+		surface.metallic = scene.textures[2].sample(uv, dUVdx, dUVdy).r;
+		surface.roughness = scene.textures[3].sample(uv, dUVdx, dUVdy).r;
+		surface.ao = scene.textures[4].sample(uv, dUVdx, dUVdy).r;
+
+		glm::vec3 tangentNormal = glm::vec3(scene.textures[1].sample(uv, dUVdx, dUVdy)) * 2.0f - 1.0f;
+		glm::vec3 N = glm::normalize(v0.normal * b.x + v1.normal * b.y + v2.normal * b.z);
+		glm::vec3 T = glm::normalize(v0.tangent * b.x + v1.tangent * b.y + v2.tangent * b.z);
+		glm::vec3 B = glm::normalize(v0.bitangent * b.x + v1.bitangent * b.y + v2.bitangent * b.z);
+		surface.normal = glm::normalize(glm::mat3(T, B, N) * tangentNormal);
+		surface.viewingDirection = glm::normalize(scene.cameraPosition - surface.position);
+		return surface;
+	}
+
+	// ambientContribution() of main.fs
+	static glm::vec3 ambientContribution(const Scene& scene, const Surface& s) {
+		float NdotV = std::max(glm::dot(s.normal, s.viewingDirection), 0.0f);
+		glm::vec3 F0 = glm::mix(glm::vec3(0.04f), s.albedo, s.metallic);
+		glm::vec3 F = F0 + (glm::max(glm::vec3(1.0f - s.roughness), F0) - F0) * std::pow(1.0f - NdotV, 5.0f);
+		glm::vec3 kD = (glm::vec3(1.0f) - F) * (1.0f - s.metallic);
+		const glm::vec3& n = s.normal;
+		float basis[9] = {
+			0.282095f,
+			0.488603f * n.y,
+			0.488603f * n.z,
+			0.488603f * n.x,
+			1.092548f * n.x * n.y,
+			1.092548f * n.y * n.z,
+			0.315392f * (3.0f * n.z * n.z - 1.0f),
+			1.092548f * n.x * n.z,
+			0.546274f * (n.x * n.x - n.y * n.y)
+		};
+		glm::vec3 irradiance = glm::vec3(0.0f);
+		for (int i = 0; i < 9; i++) {
+			irradiance += scene.probeSH[i] * basis[i];
+		}
+
+		glm::vec3 specular = glm::vec3(0.0f);
+		if (scene.environment) {
+			for (int i = 0; i < 9; i++) {
+				irradiance += scene.environment->irradianceSH[i] * basis[i];
+			}
+			glm::vec3 reflected = glm::reflect(-s.viewingDirection, s.normal);
+			glm::vec3 prefiltered = scene.environment->samplePrefiltered(reflected, s.roughness * scene.environment->getMaxLod());
+			glm::vec2 brdf = scene.environment->sampleBrdf(NdotV, s.roughness);
+			specular = prefiltered * (F * brdf.x + brdf.y);
+		}
+		return (kD * glm::max(irradiance, glm::vec3(0.0f)) * s.albedo + specular) * s.ao;
+	}
+
+	// The Cook-Torrance term shared by the light loops of main.fs for four pixels at once. Like
+	// main.fs, the distribution term is evaluated with the viewing direction instead of the halfway
+	// vector, so D and the view half of the geometry term are the same for every light.
+	struct SurfaceLanes {
+		Lanes3 position, normal, viewingDirection, albedo, F0;
+		Lanes metallic, NdotV, D, k, viewGeometry;
+	};
+
+	static Lanes3 reflectance(const SurfaceLanes& s, const Lanes3& lightDirection, const Lanes3& radiance) {
+		const Lanes zero = Lanes(0.0f), one = Lanes(1.0f);
+		Lanes3 halfway = normalize(s.viewingDirection + lightDirection);
+		Lanes NdotL = max(dot(s.normal, lightDirection), zero);
+		Lanes G = s.viewGeometry * (NdotL / (NdotL * (one - s.k) + s.k));
+		Lanes cosine = min(max(dot(halfway, s.viewingDirection), zero), one);
+		Lanes f = one - cosine;
+		Lanes f2 = f * f;
+		Lanes fresnel = f2 * f2 * f;
+		Lanes3 F = s.F0 + (Lanes3(one, one, one) - s.F0) * fresnel;
+		Lanes3 specular = F * (s.D * G) / max(Lanes(4.0f) * s.NdotV * NdotL, Lanes(0.001f));
+		Lanes3 kD = (Lanes3(one, one, one) - F) * (one - s.metallic);
+		Lanes3 diffuse = kD * s.albedo / Lanes(glm::pi<float>());
+		return (diffuse + specular) * radiance * NdotL;
+	}
+
+	// Direct light of point lights, the directional light and spotlights, in main.fs's order
+	static void directContribution(const Scene& scene, const Surface* surfaces, glm::vec3* output) {
+		float position[3][4], normal[3][4], viewing[3][4], albedo[3][4], metallic[4], roughness[4];
+		for (int p = 0; p < 4; p++) {
+			for (int c = 0; c < 3; c++) {
+				position[c][p] = surfaces[p].position[c];
+				normal[c][p] = surfaces[p].normal[c];
+				viewing[c][p] = surfaces[p].viewingDirection[c];
+				albedo[c][p] = surfaces[p].albedo[c];
+			}
+			metallic[p] = surfaces[p].metallic;
+			roughness[p] = surfaces[p].roughness;
+		}
+		const Lanes zero = Lanes(0.0f), one = Lanes(1.0f);
+		SurfaceLanes s;
+		s.position = Lanes3(Lanes::load(position[0]), Lanes::load(position[1]), Lanes::load(position[2]));
+		s.normal = Lanes3(Lanes::load(normal[0]), Lanes::load(normal[1]), Lanes::load(normal[2]));
+		s.viewingDirection = Lanes3(Lanes::load(viewing[0]), Lanes::load(viewing[1]), Lanes::load(viewing[2]));
+		s.albedo = Lanes3(Lanes::load(albedo[0]), Lanes::load(albedo[1]), Lanes::load(albedo[2]));
+		s.metallic = Lanes::load(metallic);
+		Lanes3 dielectric = Lanes3(glm::vec3(0.04f));
+		s.F0 = dielectric + (s.albedo - dielectric) * s.metallic;
+		s.NdotV = max(dot(s.normal, s.viewingDirection), zero);
+		Lanes rough = Lanes::load(roughness);
+		Lanes a = rough * rough;
+		Lanes a2 = a * a;
+		Lanes denominator = s.NdotV * s.NdotV * (a2 - one) + one;
+		denominator = Lanes(glm::pi<float>()) * denominator * denominator;
+		s.D = a2 / max(denominator, Lanes(0.001f));
+		Lanes r = rough + one;
+		s.k = r * r / Lanes(8.0f);
+		s.viewGeometry = s.NdotV / (s.NdotV * (one - s.k) + s.k);
+
+		Lanes3 pointLo = Lanes3(zero, zero, zero);
+		for (size_t i = 0; i < scene.pointLights->size(); i++) {
+			const PointLight& light = (*scene.pointLights)[i];
+			Lanes3 toLight = Lanes3(light.position) - s.position;
+			Lanes distance = sqrt(dot(toLight, toLight));
+			Lanes attenuation = one / (Lanes(light.attConstant) + Lanes(light.attLinear) * distance + Lanes(light.attQuadratic) * distance * distance);
+			pointLo = pointLo + reflectance(s, toLight / distance, Lanes3(light.color) * attenuation);
+		}
+
+		Lanes3 dirLo = reflectance(s, Lanes3(glm::normalize(-scene.dirLight->direction)), Lanes3(scene.dirLight->color));
+
+		Lanes3 spotLo = Lanes3(zero, zero, zero);
+		for (size_t i = 0; i < scene.spotlights->size(); i++) {
+			const SpotLight& light = (*scene.spotlights)[i];
+			Lanes3 lightDirection = normalize(Lanes3(light.position) - s.position);
+			Lanes theta = dot(lightDirection, Lanes3(glm::normalize(-light.direction)));
+			Lanes intensity = min(max((theta - Lanes(light.cosineOuterCutoff)) / Lanes(light.cosineInnerCutoff - light.cosineOuterCutoff), zero), one);
+			spotLo = spotLo + reflectance(s, lightDirection, Lanes3(light.color) * intensity);
+		}
+
+		float channels[3][3][4];
+		const Lanes3* terms[3] = { &pointLo, &dirLo, &spotLo };
+		for (int term = 0; term < 3; term++) {
+			terms[term]->x.store(channels[term][0]);
+			terms[term]->y.store(channels[term][1]);
+			terms[term]->z.store(channels[term][2]);
+		}
+		for (int p = 0; p < 4; p++) {
+			for (int term = 0; term < 3; term++) {
+				output[p] += glm::vec3(channels[term][0][p], channels[term][1][p], channels[term][2][p]);
+			}
+		}
+	}
+
+	void shadeTile(const Scene& scene, int tile) {
+		int tileX = tile % this->tilesX, tileY = tile / this->tilesX;
+		int x0 = tileX * TILE_SIZE, y0 = tileY * TILE_SIZE;
+		int x1 = std::min(x0 + TILE_SIZE, this->width), y1 = std::min(y0 + TILE_SIZE, this->height);
+		for (int y = y0; y < y1; y++) {
+			for (int x = x0; x < x1; x += 4) {
+				Surface surfaces[4];
+				glm::vec3 colors[4];
+				bool covered[4];
+				int first = -1;
+				for (int p = 0; p < 4; p++) {
+					unsigned int id = x + p < x1 ? this->triangleBuffer[(size_t)y * this->width + x + p] : NO_TRIANGLE;
+					covered[p] = id != NO_TRIANGLE;
+					if (covered[p]) {
+						surfaces[p] = gatherSurface(scene, id, x + p, y);
+						colors[p] = ambientContribution(scene, surfaces[p]);
+						first = first < 0 ? p : first;
+					}
+				}
+				if (first >= 0) {
+					// Empty lanes repeat a covered pixel so they stay finite, their results are dropped
+					for (int p = 0; p < 4; p++) {
+						if (!covered[p]) {
+							surfaces[p] = surfaces[first];
+							colors[p] = glm::vec3(0.0f);
+						}
+					}
+					directContribution(scene, surfaces, colors);
+				}
+				for (int p = 0; p < 4 && x + p < x1; p++) {
+					unsigned char* pixel = &this->image[((size_t)y * this->width + x + p) * 4];
+					glm::vec3 color = glm::vec3(0.0f);
+					if (covered[p]) {
+						color = colors[p] / (colors[p] + glm::vec3(1.0f));
+						color = glm::pow(color, glm::vec3(1.0f / 2.2f));
+					}
+					for (int c = 0; c < 3; c++) {
+						pixel[c] = (unsigned char)(glm::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+					}
+					pixel[3] = 255;
+				}
+			}
+		}
+	}
+
+public:
+	// threadCount 0 uses every hardware thread, the image is the same for any count
+	SoftwareRenderer(int width, int height, unsigned int threadCount = 0) {
+		this->width = glm::clamp(width, 1, MAX_SIZE);
+		this->height = glm::clamp(height, 1, MAX_SIZE);
+		this->tilesX = (this->width + TILE_SIZE - 1) / TILE_SIZE;
+		this->tilesY = (this->height + TILE_SIZE - 1) / TILE_SIZE;
+		this->blocksX = (this->width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		this->blocksY = (this->height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		if (threadCount > 0) {
+			this->ownJobs.reset(new JobSystem(threadCount));
+		}
+		this->jobs = threadCount > 0 ? this->ownJobs.get() : &JobSystem::shared();
+		this->depthBuffer.resize((size_t)this->width * this->height);
+		this->triangleBuffer.resize((size_t)this->width * this->height);
+		this->blockMaxDepth.resize((size_t)this->blocksX * this->blocksY);
+		this->image.resize((size_t)this->width * this->height * 4);
+	}
+
+	int getWidth() const {
+		return this->width;
+	}
+
+	int getHeight() const {
+		return this->height;
+	}
+
+	// Renders like main.cpp's draw loop: textures are the 5 material maps in the order of
+	// textureNames, the probe must already be updated for these lights and environment may be NULL.
+	void render(Model& model, const glm::mat4& modelMatrix, const Camera& camera, const SoftwareTexture* textures,
+		const std::vector<PointLight>& pointLights, const DirectionalLight& dirLight, const std::vector<SpotLight>& spotlights,
+		const AmbientProbe& probe, const Environment* environment) {
+		model.selectLods(modelMatrix, camera);
+		vertexStage(model, modelMatrix, camera);
+
+		size_t chunkCount = (this->triangleIndices.size() / 3 + CHUNK_TRIANGLES - 1) / CHUNK_TRIANGLES;
+		this->chunkTriangles.resize(chunkCount);
+		this->chunkBins.resize(chunkCount);
+		for (size_t c = 0; c < chunkCount; c++) {
+			this->chunkBins[c].resize(this->tilesX * this->tilesY);
+		}
+		this->jobs->parallelFor(chunkCount, 1, [&](size_t chunk) { setupChunk(chunk); });
+		this->chunkOffsets.resize(chunkCount);
+		this->triangles.clear();
+		for (size_t c = 0; c < chunkCount; c++) {
+			this->chunkOffsets[c] = (unsigned int)this->triangles.size();
+			this->triangles.insert(this->triangles.end(), this->chunkTriangles[c].begin(), this->chunkTriangles[c].end());
+		}
+
+		std::fill(this->depthBuffer.begin(), this->depthBuffer.end(), 1.0f);
+		std::fill(this->triangleBuffer.begin(), this->triangleBuffer.end(), NO_TRIANGLE);
+		std::fill(this->blockMaxDepth.begin(), this->blockMaxDepth.end(), 1.0f);
+
+		Scene scene;
+		scene.textures = textures;
+		scene.pointLights = &pointLights;
+		scene.dirLight = &dirLight;
+		scene.spotlights = &spotlights;
+		scene.probeSH = probe.getCoefficients();
+		scene.environment = environment && environment->loaded ? environment : NULL;
+		scene.cameraPosition = camera.position;
+		this->jobs->parallelFor(this->tilesX * this->tilesY, 1, [&](size_t tile) {
+			rasterizeTile((int)tile);
+			shadeTile(scene, (int)tile);
+		});
+	}
+
+	// RGBA8 pixels, rows from top to bottom
+	const std::vector<unsigned char>& getImage() const {
+		return this->image;
+	}
+};
\ No newline at end of file
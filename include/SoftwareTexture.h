@@ -0,0 +1,141 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_TEXTURE_SSE 1
+#endif
+
+// CPU copy of a material texture for SoftwareRenderer. Loads like createTexture() in main.cpp and
+// filters like a GL texture with default parameters: repeat wrapping, bilinear magnification and
+// GL_NEAREST_MIPMAP_LINEAR minification over a box filtered mip chain.
+class SoftwareTexture {
+private:
+	// RGBA8 texels packed into one int each, level i is half the size of level i - 1
+	std::vector<std::vector<unsigned int>> levels;
+	std::vector<int> widths;
+	std::vector<int> heights;
+
+	static unsigned int pack(int r, int g, int b, int a) {
+		return (unsigned int)r | (unsigned int)g << 8 | (unsigned int)b << 16 | (unsigned int)a << 24;
+	}
+
+	static glm::vec4 unpack(unsigned int texel) {
+		return glm::vec4(texel & 0xFF, (texel >> 8) & 0xFF, (texel >> 16) & 0xFF, texel >> 24) * (1.0f / 255.0f);
+	}
+
+	void buildMipChain() {
+		while (this->widths.back() > 1 || this->heights.back() > 1) {
+			int sourceWidth = this->widths.back(), sourceHeight = this->heights.back();
+			int width = std::max(1, sourceWidth / 2), height = std::max(1, sourceHeight / 2);
+			const std::vector<unsigned int>& source = this->levels.back();
+			std::vector<unsigned int> level(width * height);
+			for (int y = 0; y < height; y++) {
+				int y0 = std::min(y * 2, sourceHeight - 1), y1 = std::min(y * 2 + 1, sourceHeight - 1);
+				for (int x = 0; x < width; x++) {
+					int x0 = std::min(x * 2, sourceWidth - 1), x1 = std::min(x * 2 + 1, sourceWidth - 1);
+					unsigned int texels[4] = { source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1], source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1] };
+					int sum[4] = { 2, 2, 2, 2 };
+					for (int i = 0; i < 4; i++) {
+						for (int c = 0; c < 4; c++) {
+							sum[c] += (texels[i] >> (c * 8)) & 0xFF;
+						}
+					}
+					level[y * width + x] = pack(sum[0] / 4, sum[1] / 4, sum[2] / 4, sum[3] / 4);
+				}
+			}
+			this->levels.push_back(level);
+			this->widths.push_back(width);
+			this->heights.push_back(height);
+		}
+	}
+
+	unsigned int fetch(int level, int x, int y) const {
+		int width = this->widths[level], height = this->heights[level];
+		x %= width;
+		y %= height;
+		return this->levels[level][(y < 0 ? y + height : y) * width + (x < 0 ? x + width : x)];
+	}
+
+	glm::vec4 sampleNearest(int level, const glm::vec2& uv) const {
+		return unpack(fetch(level, (int)std::floor(uv.x * this->widths[level]), (int)std::floor(uv.y * this->heights[level])));
+	}
+
+	glm::vec4 sampleBilinear(int level, const glm::vec2& uv) const {
+		float x = uv.x * this->widths[level] - 0.5f, y = uv.y * this->heights[level] - 0.5f;
+		float fx0 = std::floor(x), fy0 = std::floor(y);
+		int x0 = (int)fx0, y0 = (int)fy0;
+		float fx = x - fx0, fy = y - fy0;
+		unsigned int t00 = fetch(level, x0, y0), t10 = fetch(level, x0 + 1, y0);
+		unsigned int t01 = fetch(level, x0, y0 + 1), t11 = fetch(level, x0 + 1, y0 + 1);
+#ifdef SOFTWARE_TEXTURE_SSE
+		// Widen each RGBA8 texel to 4 floats and blend all channels at once
+		__m128i zero = _mm_setzero_si128();
+		__m128 p00 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)t00), zero), zero));
+		__m128 p10 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)t10), zero), zero));
+		__m128 p01 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)t01), zero), zero));
+		__m128 p11 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)t11), zero), zero));
+		__m128 wx = _mm_set1_ps(fx), wy = _mm_set1_ps(fy);
+		__m128 top = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p10, p00), wx));
+		__m128 bottom = _mm_add_ps(p01, _mm_mul_ps(_mm_sub_ps(p11, p01), wx));
+		__m128 result = _mm_mul_ps(_mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy)), _mm_set1_ps(1.0f / 255.0f));
+		float channels[4];
+		_mm_storeu_ps(channels, result);
+		return glm::vec4(channels[0], channels[1], channels[2], channels[3]);
+#else
+		glm::vec4 top = glm::mix(unpack(t00), unpack(t10), fx);
+		glm::vec4 bottom = glm::mix(unpack(t01), unpack(t11), fx);
+		return glm::mix(top, bottom, fy);
+#endif
+	}
+
+public:
+	// A texture that failed to load samples as opaque black, like an incomplete GL texture
+	SoftwareTexture() {
+		this->levels.push_back(std::vector<unsigned int>(1, pack(0, 0, 0, 255)));
+		this->widths.push_back(1);
+		this->heights.push_back(1);
+	}
+
+	SoftwareTexture(const char* texturePath) : SoftwareTexture() {
+		int width, height, nrChannels;
+		unsigned char* data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
+		if (!data) {
+			std::cout << "Failed to load texture" << std::endl;
+			return;
+		}
+		// Missing channels are filled in the same way GL expands GL_RED and GL_RGB images
+		std::vector<unsigned int> level(width * height);
+		for (int i = 0; i < width * height; i++) {
+			const unsigned char* p = &data[i * nrChannels];
+			level[i] = pack(p[0], nrChannels > 1 ? p[1] : 0, nrChannels > 2 ? p[2] : 0, nrChannels > 3 ? p[3] : 255);
+		}
+		stbi_image_free(data);
+		this->levels[0] = level;
+		this->widths[0] = width;
+		this->heights[0] = height;
+		buildMipChain();
+	}
+
+	// The mip level is picked from the texture coordinate's screen space derivatives
+	glm::vec4 sample(const glm::vec2& uv, const glm::vec2& dUVdx, const glm::vec2& dUVdy) const {
+		glm::vec2 size = glm::vec2(this->widths[0], this->heights[0]);
+		float rho = std::max(glm::length(dUVdx * size), glm::length(dUVdy * size));
+		float lod = rho > 0.0f ? std::log2(rho) : 0.0f;
+		if (lod <= 0.0f) {
+			return sampleBilinear(0, uv);
+		}
+		int maxLevel = (int)this->levels.size() - 1;
+		int level = std::min((int)lod, maxLevel);
+		if (level == maxLevel) {
+			return sampleNearest(level, uv);
+		}
+		return glm::mix(sampleNearest(level, uv), sampleNearest(level + 1, uv), lod - level);
+	}
+};
\ No newline at end of file
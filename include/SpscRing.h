@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed ring of N slots between exactly one producer and one consumer thread, without locks. The
+// slots are reused in place: the producer fills the slot from beginWrite() and publishes it with
+// endWrite(), the consumer reads published slots from front() and hands them back with pop().
+// A slot belongs to one thread at a time, so its contents need no synchronization of their own.
+// Nothing here blocks, a thread that has to wait pairs the ring with a condition variable.
+template<typename T, size_t N>
+class SpscRing {
+private:
+	T slots[N];
+	// Slots published so far, written by the producer
+	alignas(64) std::atomic<size_t> head;
+	// Slots handed back so far, written by the consumer
+	alignas(64) std::atomic<size_t> tail;
+
+public:
+	SpscRing() {
+		this->head = 0;
+		this->tail = 0;
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// Producer: the next slot to fill, NULL while all of them are published or being read
+	T* beginWrite() {
+		size_t head = this->head.load(std::memory_order_relaxed);
+		if (head - this->tail.load(std::memory_order_acquire) >= N) {
+			return NULL;
+		}
+		return &this->slots[head % N];
+	}
+
+	void endWrite() {
+		this->head.store(this->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Consumer: how many published slots it holds, front() is the oldest
+	size_t readable() const {
+		return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_relaxed);
+	}
+
+	T* front() {
+		return readable() > 0 ? &this->slots[this->tail.load(std::memory_order_relaxed) % N] : NULL;
+	}
+
+	void pop() {
+		this->tail.store(this->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Either thread
+	bool writable() const {
+		return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire) < N;
+	}
+};
\ No newline at end of file
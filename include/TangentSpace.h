@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Mesh.h>
+#include <vector>
+#include <cmath>
+
+// Generates a per-vertex tangent frame following the MikkTSpace conventions: the tangent points along
+// increasing u, it is orthogonalised against the vertex normal, face contributions are weighted by the
+// corner angle, and the bitangent is reconstructed as cross(normal, tangent) * tangent.w.
+// Vertices shared by triangles of opposite UV winding (mirrored UVs) are split so each copy gets a
+// consistent frame, which removes the seams of derivative based reconstruction.
+inline void generateTangents(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	size_t originalVertexCount = vertices.size();
+	// Accumulated tangents for the positive and negative handedness of every vertex
+	std::vector<glm::vec3> tangents[2];
+	tangents[0].assign(originalVertexCount, glm::vec3(0.0f));
+	tangents[1].assign(originalVertexCount, glm::vec3(0.0f));
+	std::vector<int> cornerHandedness(indices.size(), 0);
+	std::vector<unsigned char> usedHandedness(originalVertexCount, 0);
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const Vertex* v[3] = { &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]] };
+		glm::vec3 edge1 = v[1]->position - v[0]->position;
+		glm::vec3 edge2 = v[2]->position - v[0]->position;
+		glm::vec2 uv1 = glm::vec2(v[1]->textureCoord - v[0]->textureCoord);
+		glm::vec2 uv2 = glm::vec2(v[2]->textureCoord - v[0]->textureCoord);
+
+		// Signed UV area decides the handedness of the face
+		float uvArea = uv1.x * uv2.y - uv2.x * uv1.y;
+		int handedness = uvArea < 0.0f ? 1 : 0;
+		glm::vec3 faceTangent = edge1 * uv2.y - edge2 * uv1.y;
+		if (uvArea < 0.0f) {
+			faceTangent = -faceTangent;
+		}
+
+		for (int k = 0; k < 3; k++) {
+			unsigned int index = indices[i + k];
+			cornerHandedness[i + k] = handedness;
+			usedHandedness[index] |= 1 << handedness;
+
+			// Project into the vertex's tangent plane and weight by the corner angle
+			glm::vec3 normal = vertices[index].normal;
+			glm::vec3 tangent = faceTangent - normal * glm::dot(normal, faceTangent);
+			float length = glm::length(tangent);
+			if (length <= 0.0f || !std::isfinite(length)) {
+				continue;
+			}
+			glm::vec3 toNext = v[(k + 1) % 3]->position - v[k]->position;
+			glm::vec3 toPrevious = v[(k + 2) % 3]->position - v[k]->position;
+			float edgeLengths = glm::length(toNext) * glm::length(toPrevious);
+			if (edgeLengths <= 0.0f) {
+				continue;
+			}
+			float angle = std::acos(glm::clamp(glm::dot(toNext, toPrevious) / edgeLengths, -1.0f, 1.0f));
+			tangents[handedness][index] += tangent / length * angle;
+		}
+	}
+
+	// Split vertices used with both handednesses, the copy takes the mirrored corners
+	std::vector<unsigned int> mirroredCopy(originalVertexCount, 0);
+	std::vector<unsigned int> copySource;
+	for (size_t i = 0; i < originalVertexCount; i++) {
+		if (usedHandedness[i] == 3) {
+			mirroredCopy[i] = (unsigned int)vertices.size();
+			copySource.push_back((unsigned int)i);
+			vertices.push_back(vertices[i]);
+		}
+	}
+	for (size_t i = 0; i < indices.size(); i++) {
+		unsigned int index = indices[i];
+		if (usedHandedness[index] == 3 && cornerHandedness[i] == 1) {
+			indices[i] = mirroredCopy[index];
+		}
+	}
+
+	for (size_t i = 0; i < vertices.size(); i++) {
+		unsigned int original = (unsigned int)i;
+		int handedness;
+		if (i < originalVertexCount) {
+			handedness = usedHandedness[i] == 2 ? 1 : 0;
+		}
+		else {
+			original = copySource[i - originalVertexCount];
+			handedness = 1;
+		}
+
+		glm::vec3 normal = vertices[i].normal;
+		glm::vec3 tangent = tangents[handedness][original];
+		tangent -= normal * glm::dot(normal, tangent);
+		float length = glm::length(tangent);
+		if (length <= 1e-12f || !std::isfinite(length)) {
+			// No usable UVs, any vector perpendicular to the normal will do
+			glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			tangent = glm::cross(normal, axis);
+			length = glm::length(tangent);
+			if (length <= 0.0f) {
+				tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+				length = 1.0f;
+			}
+		}
+		vertices[i].tangent = glm::vec4(tangent / length, handedness ? -1.0f : 1.0f);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <imgui.h>
+#include <imgui_impl_opengl3.h>
+#include <ShaderProgram.h>
+#include <cstring>
+
+// Retained output for the GUI. The draw lists are hashed every frame, and only when they differ
+// from the last frame's are they uploaded and drawn, into an offscreen layer texture. The layer is
+// then blended over the scene with one fullscreen triangle, so an unchanged GUI costs one draw.
+// Only the draw data is compared: a texture whose contents change under the same id isn't seen.
+class UiLayer {
+private:
+	ShaderProgram compositeSP;
+	GLuint framebuffer = 0;
+	GLuint texture = 0;
+	GLuint emptyVAO = 0;
+	int width = 0, height = 0;
+	unsigned long long lastHash = 0;
+	bool empty = true;
+	ImGui_ImplOpenGL3_AppState appState;
+	unsigned int redraws = 0;
+	unsigned int reuses = 0;
+
+	static unsigned long long hashBytes(const void* data, size_t size, unsigned long long hash) {
+		// 8 bytes at a time, a few hundred KB of vertices hash in well under a millisecond
+		const unsigned char* bytes = (const unsigned char*)data;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			unsigned long long word;
+			memcpy(&word, bytes + i, 8);
+			hash = (hash ^ word) * 0x100000001B3ull;
+			hash ^= hash >> 29;
+		}
+		for (; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+public:
+	// Changes whenever anything that reaches the screen does
+	static unsigned long long hashDrawData(const ImDrawData* drawData) {
+		unsigned long long hash = 0xCBF29CE484222325ull;
+		hash = hashBytes(&drawData->DisplayPos, sizeof(ImVec2), hash);
+		hash = hashBytes(&drawData->DisplaySize, sizeof(ImVec2), hash);
+		hash = hashBytes(&drawData->FramebufferScale, sizeof(ImVec2), hash);
+		for (int n = 0; n < drawData->CmdListsCount; n++) {
+			const ImDrawList* list = drawData->CmdLists[n];
+			hash = hashBytes(list->VtxBuffer.Data, (size_t)list->VtxBuffer.Size * sizeof(ImDrawVert), hash);
+			hash = hashBytes(list->IdxBuffer.Data, (size_t)list->IdxBuffer.Size * sizeof(ImDrawIdx), hash);
+			for (int c = 0; c < list->CmdBuffer.Size; c++) {
+				const ImDrawCmd& command = list->CmdBuffer[c];
+				hash = hashBytes(&command.ElemCount, sizeof(command.ElemCount), hash);
+				hash = hashBytes(&command.ClipRect, sizeof(command.ClipRect), hash);
+				hash = hashBytes(&command.TextureId, sizeof(command.TextureId), hash);
+				hash = hashBytes(&command.VtxOffset, sizeof(command.VtxOffset), hash);
+				hash = hashBytes(&command.IdxOffset, sizeof(command.IdxOffset), hash);
+				hash = hashBytes(&command.UserCallback, sizeof(command.UserCallback), hash);
+			}
+		}
+		return hash;
+	}
+
+private:
+	void resize(int width, int height) {
+		if (this->texture) {
+			glDeleteTextures(1, &this->texture);
+		}
+		glGenTextures(1, &this->texture);
+		glBindTexture(GL_TEXTURE_2D, this->texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->texture, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		this->width = width;
+		this->height = height;
+	}
+
+public:
+	// appState is what the rest of the frame expects, as for ImGui_ImplOpenGL3_SetFastPath()
+	UiLayer(const ImGui_ImplOpenGL3_AppState& appState) : compositeSP("shaders/uilayer.vs", "shaders/uilayer.fs") {
+		this->appState = appState;
+		glGenFramebuffers(1, &this->framebuffer);
+		glGenVertexArrays(1, &this->emptyVAO);
+		this->compositeSP.use();
+		this->compositeSP.setUniformInt("layer", 0);
+	}
+
+	~UiLayer() {
+		glDeleteFramebuffers(1, &this->framebuffer);
+		glDeleteVertexArrays(1, &this->emptyVAO);
+		if (this->texture) {
+			glDeleteTextures(1, &this->texture);
+		}
+	}
+
+	UiLayer(const UiLayer&) = delete;
+	UiLayer& operator=(const UiLayer&) = delete;
+
+	// Redraws the layer if the draw data changed, returns whether it did
+	bool update(ImDrawData* drawData) {
+		int framebufferWidth = (int)(drawData->DisplaySize.x * drawData->FramebufferScale.x);
+		int framebufferHeight = (int)(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+		this->empty = framebufferWidth <= 0 || framebufferHeight <= 0 || drawData->TotalIdxCount == 0;
+		if (this->empty) {
+			return false;
+		}
+		unsigned long long hash = hashDrawData(drawData);
+		if (hash == this->lastHash && framebufferWidth == this->width && framebufferHeight == this->height) {
+			this->reuses++;
+			return false;
+		}
+		this->lastHash = hash;
+		this->redraws++;
+		if (framebufferWidth != this->width || framebufferHeight != this->height) {
+			resize(framebufferWidth, framebufferHeight);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		ImGui_ImplOpenGL3_RenderDrawData(drawData);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return true;
+	}
+
+	// Blends the layer over the default framebuffer
+	void composite() {
+		if (this->empty) {
+			return;
+		}
+		glViewport(0, 0, this->width, this->height);
+		if (this->appState.DepthTest) glDisable(GL_DEPTH_TEST);
+		if (this->appState.CullFace) glDisable(GL_CULL_FACE);
+		if (this->appState.ScissorTest) glDisable(GL_SCISSOR_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		this->compositeSP.use();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, this->texture);
+		glBindVertexArray(this->emptyVAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+		if (!this->appState.Blend) glDisable(GL_BLEND);
+		if (this->appState.DepthTest) glEnable(GL_DEPTH_TEST);
+		if (this->appState.CullFace) glEnable(GL_CULL_FACE);
+		if (this->appState.ScissorTest) glEnable(GL_SCISSOR_TEST);
+	}
+
+	// How many frames redrew the layer and how many reused it
+	unsigned int getRedrawCount() const {
+		return this->redraws;
+	}
+
+	unsigned int getReuseCount() const {
+		return this->reuses;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cmath>
+
+struct Vertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec3 textureCoord;
+	// xyz is the tangent, w the sign of the bitangent
+	glm::vec4 tangent;
+};
+
+// Compact 20 byte vertex, decoded in main.vs
+//	position: unsigned normalized, relative to the mesh's bounding box (w is padding)
+//	normal: octahedral encoding, signed normalized
+//	textureCoord: half floats
+//	tangent: signed normalized 10_10_10_2, the 2 bit w holds the bitangent sign
+struct PackedVertex {
+	unsigned short position[4];
+	short normal[2];
+	unsigned short textureCoord[2];
+	unsigned int tangent;
+};
+
+// Octahedral normal encoding, see Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors"
+inline glm::vec2 octahedralEncode(glm::vec3 n) {
+	n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	glm::vec2 e = glm::vec2(n.x, n.y);
+	if (n.z < 0.0f) {
+		e = glm::vec2(
+			(1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+		);
+	}
+	return e;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Chase-Lev deque of N pointers (a power of two) without locks, with the memory orders of
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.). The owning thread
+// pushes and pops at the bottom, like a stack, so it works on what it spawned last while that is
+// still in its cache. Any other thread steals from the top, i.e. the oldest and usually biggest
+// pieces of work. The owner and thieves only contend for the last element.
+// The buffer doesn't grow, push() fails when it's full and the caller runs the work itself.
+template<typename T, size_t N>
+class WorkStealingDeque {
+private:
+	static_assert(N > 0 && (N & (N - 1)) == 0, "The capacity must be a power of two");
+
+	// Next element to steal, written by thieves and by the owner for the last element. Padded
+	// instead of aligned, deques are allocated with new, which doesn't align beyond 16 bytes in C++14.
+	std::atomic<long long> top;
+	char topPadding[64 - sizeof(std::atomic<long long>)];
+	// Next free slot, only written by the owner
+	std::atomic<long long> bottom;
+	char bottomPadding[64 - sizeof(std::atomic<long long>)];
+	std::atomic<T*> slots[N];
+
+public:
+	WorkStealingDeque() {
+		this->top = 0;
+		this->bottom = 0;
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	// Owner only, false when full
+	bool push(T* element) {
+		long long bottom = this->bottom.load(std::memory_order_relaxed);
+		long long top = this->top.load(std::memory_order_acquire);
+		if (bottom - top >= (long long)N) {
+			return false;
+		}
+		this->slots[bottom & (N - 1)].store(element, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		this->bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Owner only, the most recently pushed element or NULL
+	T* pop() {
+		long long bottom = this->bottom.load(std::memory_order_relaxed) - 1;
+		this->bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long top = this->top.load(std::memory_order_relaxed);
+		if (top > bottom) {
+			// Empty
+			this->bottom.store(bottom + 1, std::memory_order_relaxed);
+			return NULL;
+		}
+		T* element = this->slots[bottom & (N - 1)].load(std::memory_order_relaxed);
+		if (top == bottom) {
+			// The last element, a thief may be taking it at the same time
+			if (!this->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				element = NULL;
+			}
+			this->bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return element;
+	}
+
+	// Any thread, the oldest element or NULL if there is none or another thread got it first
+	T* steal() {
+		long long top = this->top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long bottom = this->bottom.load(std::memory_order_acquire);
+		if (top >= bottom) {
+			return NULL;
+		}
+		T* element = this->slots[top & (N - 1)].load(std::memory_order_relaxed);
+		if (!this->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return NULL;
+		}
+		return element;
+	}
+
+	// A snapshot, only a hint while other threads use the deque
+	bool empty() const {
+		return this->bottom.load(std::memory_order_relaxed) <= this->top.load(std::memory_order_relaxed);
+	}
+};
\ No newline at end of file
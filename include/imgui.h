@@ -1354,6 +1354,7 @@ struct ImGuiIO
     bool        ConfigInputTextCursorBlink;     // = true           // Set to false to disable blinking cursor, for users who consider it distracting. (was called: io.OptCursorBlink prior to 1.63)
     bool        ConfigWindowsResizeFromEdges;   // = true           // Enable resizing of windows from their edges and from the lower-left corner. This requires (io.BackendFlags & ImGuiBackendFlags_HasMouseCursors) because it needs mouse cursor feedback. (This used to be a per-window ImGuiWindowFlags_ResizeFromAnySide flag)
     bool        ConfigWindowsMoveFromTitleBarOnly; // = false       // [BETA] Set to true to only allow moving windows when clicked+dragged from the title bar. Windows without a title bar are not affected.
+    bool        ConfigDeferTessellation;        // = false          // Window draw lists only record their lines and fills, call ImDrawList::TessellateDeferred() on every list of the ImDrawData after Render(), e.g. on worker threads.
 
     //------------------------------------------------------------------
     // Platform Functions
@@ -1848,7 +1849,22 @@ enum ImDrawListFlags_
     ImDrawListFlags_None             = 0,
     ImDrawListFlags_AntiAliasedLines = 1 << 0,  // Lines are anti-aliased (*2 the number of triangles for 1.0f wide line, otherwise *3 the number of triangles)
     ImDrawListFlags_AntiAliasedFill  = 1 << 1,  // Filled shapes have anti-aliased edges (*2 the number of vertices)
-    ImDrawListFlags_AllowVtxOffset   = 1 << 2   // Can emit 'VtxOffset > 0' to allow large meshes. Set when 'ImGuiBackendFlags_RendererHasVtxOffset' is enabled.
+    ImDrawListFlags_AllowVtxOffset   = 1 << 2,  // Can emit 'VtxOffset > 0' to allow large meshes. Set when 'ImGuiBackendFlags_RendererHasVtxOffset' is enabled.
+    ImDrawListFlags_DeferTessellation = 1 << 3  // Lines and convex fills only reserve their vertices and indices, they are written by TessellateDeferred(). Set on window lists when 'io.ConfigDeferTessellation' is enabled.
+};
+
+// [Internal] A polyline or convex fill recorded by a list with ImDrawListFlags_DeferTessellation, and the space reserved for it
+struct ImDrawDeferredPrim
+{
+    int             PointsOffset;       // Into ImDrawList::_DeferredPoints
+    int             PointsCount;
+    ImU32           Col;
+    float           Thickness;          // Of a line, < 0.0f for a convex fill
+    bool            Closed;
+    ImDrawListFlags Flags;              // Anti-aliasing flags when it was recorded
+    int             VtxOffset;          // Into VtxBuffer
+    int             IdxOffset;          // Into IdxBuffer
+    unsigned int    VtxCurrentIdx;      // Index of the first vertex
 };
 
 // Draw command list
@@ -1878,6 +1894,8 @@ struct ImDrawList
     ImVector<ImTextureID>   _TextureIdStack;    // [Internal]
     ImVector<ImVec2>        _Path;              // [Internal] current path building
     ImDrawListSplitter      _Splitter;          // [Internal] for channels api
+    ImVector<ImDrawDeferredPrim> _DeferredPrims; // [Internal] primitives waiting for TessellateDeferred()
+    ImVector<ImVec2>        _DeferredPoints;    // [Internal] their points
 
     // If you want to create ImDrawList instances, pass them ImGui::GetDrawListSharedData() or create and use your own ImDrawListSharedData (so you can use ImDrawList without ImGui)
     ImDrawList(const ImDrawListSharedData* shared_data) { _Data = shared_data; _OwnerName = NULL; Clear(); }
@@ -1925,6 +1943,7 @@ struct ImDrawList
     IMGUI_API void  AddCallback(ImDrawCallback callback, void* callback_data);  // Your rendering function must check for 'UserCallback' in ImDrawCmd and call the function instead of rendering triangles.
     IMGUI_API void  AddDrawCmd();                                               // This is useful if you need to forcefully create a new draw call (to allow for dependent rendering / blending). Otherwise primitives are merged into the same draw-call as much as possible
     IMGUI_API ImDrawList* CloneOutput() const;                                  // Create a clone of the CmdBuffer/IdxBuffer/VtxBuffer.
+    IMGUI_API void  TessellateDeferred();                                       // Write the primitives recorded with ImDrawListFlags_DeferTessellation. Lists don't share anything, so different lists can be tessellated on different threads after ImGui::Render().
 
     // Advanced: Channels
     // - Use to split render into layers. By switching channels to can render out-of-order (e.g. submit foreground primitives before background primitives)
@@ -1946,6 +1965,9 @@ struct ImDrawList
     inline    void  PrimVtx(const ImVec2& pos, const ImVec2& uv, ImU32 col)     { PrimWriteIdx((ImDrawIdx)_VtxCurrentIdx); PrimWriteVtx(pos, uv, col); }
     IMGUI_API void  UpdateClipRect();
     IMGUI_API void  UpdateTextureID();
+    IMGUI_API void  _DeferPrim(const ImVec2* points, int points_count, ImU32 col, bool closed, float thickness, int idx_count, int vtx_count);
+    IMGUI_API void  _TessellatePolyline(const ImVec2* points, int points_count, ImU32 col, bool closed, float thickness);
+    IMGUI_API void  _TessellateConvexPolyFilled(const ImVec2* points, int points_count, ImU32 col);
 };
 
 // All draw data to render a Dear ImGui frame
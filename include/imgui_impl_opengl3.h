@@ -40,6 +40,21 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_Shutdown();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_NewFrame();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data);
 
+// Fast path for applications that track their own GL state. Needs desktop GL 4.4 (glBufferStorage), otherwise the regular path is used.
+// - All command lists are copied into one persistently mapped, coherent vertex/index ring of 3 frames, guarded by fences. No glBufferData.
+// - One VAO is created once. No state is queried or restored: the backend sets what it needs, and on return leaves the capabilities
+//   below as given by the application. Blend function/equation, scissor box, viewport, program, VAO (0), active texture unit (0)
+//   and the texture bound to it are left as the UI used them.
+// - Assumes the default clip origin (lower left) and polygon mode (fill), and no sampler object bound to unit 0.
+struct ImGui_ImplOpenGL3_AppState
+{
+    bool    DepthTest;
+    bool    Blend;
+    bool    CullFace;
+    bool    ScissorTest;
+};
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetFastPath(bool enabled, const ImGui_ImplOpenGL3_AppState& app_state);
+
 // Called by Init/NewFrame/Shutdown
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateFontsTexture();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
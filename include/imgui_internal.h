@@ -164,6 +164,8 @@ IMGUI_API int           ImTextCountUtf8BytesFromStr(const ImWchar* in_text, cons
 // Helpers: Misc
 IMGUI_API ImU32         ImHashData(const void* data, size_t data_size, ImU32 seed = 0);
 IMGUI_API ImU32         ImHashStr(const char* data, size_t data_size = 0, ImU32 seed = 0);
+IMGUI_API bool          ImHashIsHardwareAccelerated();                                                                     // true when ImHashData/ImHashStr use the SSE4.2 crc32 instruction (same values either way)
+IMGUI_API void          ImFontSetAsciiFastPath(bool enabled);                                                              // ImFont::RenderText() fast path for printable ASCII, on by default (same output either way)
 IMGUI_API void*         ImFileLoadToMemory(const char* filename, const char* file_open_mode, size_t* out_file_size = NULL, int padding_bytes = 0);
 IMGUI_API FILE*         ImFileOpen(const char* filename, const char* file_open_mode);
 static inline bool      ImCharIsBlankA(char c)          { return c == ' ' || c == '\t'; }
@@ -0,0 +1,106 @@
+#version 450 core
+
+// Culls the meshlets against the frustum and copies the triangles of the visible ones into the index
+// buffer of an indirect draw, in their original order so the overdraw ordering of the mesh is kept.
+// Two dispatches:
+//	cullPass 0, one work group: tests every meshlet and turns the visible index counts into offsets
+//	        with a prefix sum, the total becomes the draw's count
+//	cullPass 1, one work group per meshlet: copies the meshlet's indices to its offset
+// There is no backface test, the viewer lights and draws both sides of every triangle.
+layout (local_size_x = 256) in;
+
+struct Meshlet {
+	vec4 sphere;
+	uint triangleOffset;
+	uint triangleCount;
+	uint padding0;
+	uint padding1;
+};
+
+layout (std430, binding = 0) readonly buffer MeshletBuffer {
+	Meshlet meshlets[];
+};
+layout (std430, binding = 1) readonly buffer MeshletIndexBuffer {
+	uint meshletIndices[];
+};
+layout (std430, binding = 2) writeonly buffer VisibleIndexBuffer {
+	uint visibleIndices[];
+};
+// Layout of DrawElementsIndirectCommand, count is written by cullPass 0
+layout (std430, binding = 3) buffer DrawCommandBuffer {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	uint baseVertex;
+	uint baseInstance;
+};
+// Where each meshlet's indices go, CULLED for meshlets that aren't drawn
+layout (std430, binding = 4) buffer MeshletOffsetBuffer {
+	uint meshletOffsets[];
+};
+
+const uint CULLED = 0xFFFFFFFFu;
+
+// In the mesh's object space
+uniform vec4 frustumPlanes[6];
+uniform uint meshletCount;
+uniform uint cullPass;
+
+shared uint partialSums[gl_WorkGroupSize.x];
+
+uint visibleIndexCount(uint meshletIndex) {
+	Meshlet meshlet = meshlets[meshletIndex];
+	for (int i = 0; i < 6; i++) {
+		if (dot(frustumPlanes[i].xyz, meshlet.sphere.xyz) + frustumPlanes[i].w < -meshlet.sphere.w) {
+			return 0u;
+		}
+	}
+	return meshlet.triangleCount * 3u;
+}
+
+void main() {
+	uint thread = gl_LocalInvocationIndex;
+	if (cullPass == 0u) {
+		// Every thread takes a contiguous run of meshlets, so the offsets follow the meshlet order
+		uint runLength = (meshletCount + gl_WorkGroupSize.x - 1u) / gl_WorkGroupSize.x;
+		uint begin = min(thread * runLength, meshletCount);
+		uint end = min(begin + runLength, meshletCount);
+		uint sum = 0u;
+		for (uint m = begin; m < end; m++) {
+			sum += visibleIndexCount(m);
+		}
+		partialSums[thread] = sum;
+		barrier();
+		// Inclusive scan of the runs' sums
+		for (uint stride = 1u; stride < gl_WorkGroupSize.x; stride *= 2u) {
+			uint value = thread >= stride ? partialSums[thread - stride] : 0u;
+			barrier();
+			partialSums[thread] += value;
+			barrier();
+		}
+		uint offset = partialSums[thread] - sum;
+		for (uint m = begin; m < end; m++) {
+			uint indexCount = visibleIndexCount(m);
+			meshletOffsets[m] = indexCount > 0u ? offset : CULLED;
+			offset += indexCount;
+		}
+		if (thread == gl_WorkGroupSize.x - 1u) {
+			count = partialSums[thread];
+		}
+		return;
+	}
+
+	uint meshletIndex = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+	if (meshletIndex >= meshletCount) {
+		return;
+	}
+	uint outputOffset = meshletOffsets[meshletIndex];
+	if (outputOffset == CULLED) {
+		return;
+	}
+	Meshlet meshlet = meshlets[meshletIndex];
+	uint indexCount = meshlet.triangleCount * 3u;
+	for (uint i = thread; i < indexCount; i += gl_WorkGroupSize.x) {
+		visibleIndices[outputOffset + i] = meshletIndices[meshlet.triangleOffset * 3u + i];
+	}
+}
\ No newline at end of file
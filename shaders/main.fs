@@ -23,8 +23,11 @@ struct SpotLight {
 out vec4 fragmentColor;
 
 in vec3 v2fNormal;
+in vec3 v2fTangent;
+in vec3 v2fBitangent;
 in vec3 v2fTextureCoord;
 in vec3 v2fWorldFragmentPosition;
+in float v2fViewDepth;
 
 uniform sampler2D albedoMap;
 uniform sampler2D normalMap;
@@ -39,25 +42,112 @@ uniform SpotLight spotLights[16];
 uniform int numSpotLights;
 uniform vec3 cameraPosition;
 
+// Shadow maps, see ShadowMaps.h
+uniform bool shadowsEnabled;
+uniform sampler2DArrayShadow cascadeShadowMap;
+uniform mat4 cascadeMatrices[4];
+uniform vec4 cascadeSplits;
+uniform vec4 cascadeTexelSizes;
+uniform sampler2DShadow spotShadowAtlas;
+uniform mat4 spotShadowMatrices[16];
+uniform samplerCubeArrayShadow pointShadowMaps;
+// Near and far plane of every point light's cube faces
+uniform vec2 pointShadowRanges[16];
+uniform int numPointShadows;
+
+// Image-based lighting, see Environment.h
+uniform bool environmentEnabled;
+uniform samplerCube prefilteredMap;
+uniform sampler2D brdfLut;
+uniform float prefilteredMaxLod;
+uniform vec3 irradianceSH[9];
+
+// Fill light bounced from the scene lights as irradiance / PI, see AmbientProbe.h
+layout (std140, binding = 0) uniform AmbientProbe {
+	vec4 probeSH[9];
+};
+
 const float PI = 3.14159265359;
 
 
 vec3 getNormalFromMap() {
 	vec3 tangentNormal = texture(normalMap, v2fTextureCoord.xy).xyz * 2.0 - 1.0;
 
-    vec3 Q1  = dFdx(v2fWorldFragmentPosition);
-    vec3 Q2  = dFdy(v2fWorldFragmentPosition);
-    vec2 st1 = dFdx(v2fTextureCoord.xy);
-    vec2 st2 = dFdy(v2fTextureCoord.xy);
-
     vec3 N   = normalize(v2fNormal);
-    vec3 T  = normalize(Q1*st2.t - Q2*st1.t);
-    vec3 B  = -normalize(cross(N, T));
+    vec3 T  = normalize(v2fTangent);
+    vec3 B  = normalize(v2fBitangent);
     mat3 TBN = mat3(T, B, N);
 
     return normalize(TBN * tangentNormal);
 }
 
+// 3x3 PCF on top of the hardware 2x2 filter
+float directionalShadow() {
+	if (!shadowsEnabled || v2fViewDepth > cascadeSplits[3]) {
+		return 1.0;
+	}
+	int cascade = 0;
+	for (int i = 0; i < 3; i++) {
+		if (v2fViewDepth > cascadeSplits[i]) {
+			cascade = i + 1;
+		}
+	}
+	// Offset along the normal by about a texel of the cascade
+	vec3 position = v2fWorldFragmentPosition + normalize(v2fNormal) * cascadeTexelSizes[cascade] * 1.5;
+	vec3 lightPosition = (cascadeMatrices[cascade] * vec4(position, 1.0)).xyz * 0.5 + 0.5;
+	if (lightPosition.z > 1.0) {
+		return 1.0;
+	}
+	vec2 texel = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+	float lit = 0.0;
+	for (int x = -1; x <= 1; x++) {
+		for (int y = -1; y <= 1; y++) {
+			lit += texture(cascadeShadowMap, vec4(lightPosition.xy + vec2(x, y) * texel, cascade, lightPosition.z));
+		}
+	}
+	return lit / 9.0;
+}
+
+float spotShadow(int light) {
+	if (!shadowsEnabled) {
+		return 1.0;
+	}
+	vec4 lightPosition = spotShadowMatrices[light] * vec4(v2fWorldFragmentPosition, 1.0);
+	if (lightPosition.w <= 0.0) {
+		return 1.0;
+	}
+	lightPosition.xyz /= lightPosition.w;
+	// Keep the filter inside the light's own tile of the atlas
+	vec2 texel = 1.0 / vec2(textureSize(spotShadowAtlas, 0));
+	vec2 tileMin = vec2(light % 4, light / 4) * 0.25 + texel;
+	vec2 tileMax = tileMin + 0.25 - 2.0 * texel;
+	float lit = 0.0;
+	for (int x = -1; x <= 1; x++) {
+		for (int y = -1; y <= 1; y++) {
+			vec2 uv = clamp(lightPosition.xy + vec2(x, y) * texel, tileMin, tileMax);
+			lit += texture(spotShadowAtlas, vec3(uv, lightPosition.z));
+		}
+	}
+	return lit / 9.0;
+}
+
+float pointShadow(int light) {
+	if (!shadowsEnabled || light >= numPointShadows) {
+		return 1.0;
+	}
+	// Offset along the normal by about a texel at this distance from the light
+	vec3 toFragment = v2fWorldFragmentPosition - pointLights[light].position;
+	float texelSize = 2.0 * length(toFragment) / float(textureSize(pointShadowMaps, 0).x);
+	toFragment += normalize(v2fNormal) * texelSize * 1.5;
+	// The face's depth is the perspective depth along the major axis
+	vec3 absolute = abs(toFragment);
+	float z = max(absolute.x, max(absolute.y, absolute.z));
+	float n = pointShadowRanges[light].x;
+	float f = pointShadowRanges[light].y;
+	float depth = ((f + n) / (f - n) - 2.0 * f * n / ((f - n) * z)) * 0.5 + 0.5;
+	return texture(pointShadowMaps, vec4(toFragment, light), depth);
+}
+
 float TrowbridgeReitzNDF(vec3 normal, vec3 halfway, float roughness) {
 	float a = roughness * roughness;
 	float a2 = a * a;
@@ -91,6 +181,23 @@ vec3 FresnelSchlick(float cosine, vec3 F0) {
 	return F0 + (1.0 - F0) * pow(1.0 - cosine, 5.0);
 }
 
+vec3 FresnelSchlickRoughness(float cosine, vec3 F0, float roughness) {
+	return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosine, 5.0);
+}
+
+// Real spherical harmonics up to band 2, same order as Environment::evaluateBasis()
+void shBasis(vec3 n, out float basis[9]) {
+	basis[0] = 0.282095;
+	basis[1] = 0.488603 * n.y;
+	basis[2] = 0.488603 * n.z;
+	basis[3] = 0.488603 * n.x;
+	basis[4] = 1.092548 * n.x * n.y;
+	basis[5] = 1.092548 * n.y * n.z;
+	basis[6] = 0.315392 * (3.0 * n.z * n.z - 1.0);
+	basis[7] = 1.092548 * n.x * n.z;
+	basis[8] = 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
 vec3 pointLightsContribution() {
 	vec3 albedo = pow(texture(albedoMap, v2fTextureCoord.xy).rgb, vec3(2.2));
 	float metallic = texture(metallicMap, v2fTextureCoord.xy).r;
@@ -113,7 +220,7 @@ vec3 pointLightsContribution() {
 			(pointLights[i].attLinear * lightDistance) +
 			(pointLights[i].attQuadratic * lightDistance * lightDistance)
 		);
-		vec3 radiance = pointLights[i].color * attenuation;
+		vec3 radiance = pointLights[i].color * attenuation * pointShadow(i);
 
 		float D = TrowbridgeReitzNDF(normal, viewingDirection, roughness);
 		float G = SmithGeometry(normal, viewingDirection, lightDirection, roughness);
@@ -150,7 +257,7 @@ vec3 directionalLightContribution() {
 
 	vec3 lightDirection = normalize(-dirLight.direction);
 	vec3 halfway = normalize(viewingDirection + lightDirection);
-	vec3 radiance = dirLight.color;
+	vec3 radiance = dirLight.color * directionalShadow();
 
 	float D = TrowbridgeReitzNDF(normal, viewingDirection, roughness);
 	float G = SmithGeometry(normal, viewingDirection, lightDirection, roughness);
@@ -189,7 +296,7 @@ vec3 spotLightsContribution() {
 		float intensity = clamp((theta - spotLights[i].cosineOuterCutoff) / epsilon, 0.0, 1.0);
 
 		vec3 halfway = normalize(viewingDirection + lightDirection);
-		vec3 radiance = spotLights[i].color * intensity;
+		vec3 radiance = spotLights[i].color * intensity * spotShadow(i);
 
 		float D = TrowbridgeReitzNDF(normal, viewingDirection, roughness);
 		float G = SmithGeometry(normal, viewingDirection, lightDirection, roughness);
@@ -210,11 +317,44 @@ vec3 spotLightsContribution() {
 	return Lo;
 }
 
-void main() {
+// Diffuse fill from the light probe, plus split-sum image-based lighting if an environment is loaded
+vec3 ambientContribution() {
 	vec3 albedo = pow(texture(albedoMap, v2fTextureCoord.xy).rgb, vec3(2.2));
+	float metallic = texture(metallicMap, v2fTextureCoord.xy).r;
+	float roughness = texture(roughnessMap, v2fTextureCoord.xy).r;
 	float ao = texture(aoMap, v2fTextureCoord.xy).r;
 
-	vec3 ambient = vec3(0.03) *	ao * albedo;
+	vec3 normal = getNormalFromMap();
+	vec3 viewingDirection = normalize(cameraPosition - v2fWorldFragmentPosition);
+	float NdotV = max(dot(normal, viewingDirection), 0.0);
+
+	vec3 F0 = vec3(0.04);
+	F0 = mix(F0, albedo, metallic);
+	vec3 F = FresnelSchlickRoughness(NdotV, F0, roughness);
+	vec3 kD = (vec3(1.0) - F) * (1.0 - metallic);
+	float basis[9];
+	shBasis(normal, basis);
+	vec3 irradiance = vec3(0.0);
+	for (int i = 0; i < 9; i++) {
+		irradiance += probeSH[i].rgb * basis[i];
+	}
+
+	vec3 specular = vec3(0.0);
+	if (environmentEnabled) {
+		for (int i = 0; i < 9; i++) {
+			irradiance += irradianceSH[i] * basis[i];
+		}
+		vec3 reflected = reflect(-viewingDirection, normal);
+		vec3 prefiltered = textureLod(prefilteredMap, reflected, roughness * prefilteredMaxLod).rgb;
+		vec2 brdf = texture(brdfLut, vec2(NdotV, roughness)).rg;
+		specular = prefiltered * (F * brdf.x + brdf.y);
+	}
+
+	return (kD * max(irradiance, vec3(0.0)) * albedo + specular) * ao;
+}
+
+void main() {
+	vec3 ambient = ambientContribution();
 	vec3 color = ambient + pointLightsContribution() + directionalLightContribution() + spotLightsContribution();
 	color = color / (color + vec3(1.0));
 	color = pow(color, vec3(1.0/2.2));
@@ -3,20 +3,50 @@
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec3 inTextureCoord;
+layout (location = 3) in vec4 inTangent;
 
 out vec3 v2fNormal;
+out vec3 v2fTangent;
+out vec3 v2fBitangent;
 out vec3 v2fTextureCoord;
 out vec3 v2fWorldFragmentPosition;
+out float v2fViewDepth;
 
 uniform mat4 model;
 uniform mat3 inverseModel;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Set for meshes using the compact vertex format, see PackedVertex in Mesh.h
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 octahedralDecode(vec2 e) {
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) {
+		n.xy = (1.0 - abs(n.yx)) * (step(0.0, n.xy) * 2.0 - 1.0);
+	}
+	return normalize(n);
+}
+
 void main() {
-	v2fNormal = inverseModel * inNormal;
+	vec3 position = inPosition;
+	vec3 normal = inNormal;
+	if (packedVertices) {
+		position = positionOffset + inPosition * positionScale;
+		normal = octahedralDecode(inNormal.xy);
+	}
+
+	v2fNormal = inverseModel * normal;
+	// Tangent frame generated at import (see TangentSpace.h). UVs are flipped on import,
+	// so the green channel of the normal map points along -bitangent.
+	v2fTangent = mat3(model) * inTangent.xyz;
+	v2fBitangent = -cross(normalize(v2fNormal), normalize(v2fTangent)) * (inTangent.w < 0.0 ? -1.0 : 1.0);
 	v2fTextureCoord = inTextureCoord;
-	v2fWorldFragmentPosition = vec3(model * vec4(inPosition, 1.0));
+	v2fWorldFragmentPosition = vec3(model * vec4(position, 1.0));
+	// Picks the shadow cascade in main.fs
+	v2fViewDepth = -(view * vec4(v2fWorldFragmentPosition, 1.0)).z;
 
-	gl_Position = projection * view * model * vec4(inPosition, 1.0);
+	gl_Position = projection * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
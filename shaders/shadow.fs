@@ -0,0 +1,5 @@
+#version 450 core
+
+// Depth only, the depth buffer is written by fixed function
+void main() {
+}
\ No newline at end of file
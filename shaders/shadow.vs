@@ -0,0 +1,20 @@
+#version 450 core
+
+layout (location = 0) in vec3 inPosition;
+
+// Light view-projection of the cascade or atlas tile being rendered
+uniform mat4 lightSpace;
+uniform mat4 model;
+
+// Same vertex decoding as main.vs
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+void main() {
+	vec3 position = inPosition;
+	if (packedVertices) {
+		position = positionOffset + inPosition * positionScale;
+	}
+	gl_Position = lightSpace * model * vec4(position, 1.0);
+}
\ No newline at end of file
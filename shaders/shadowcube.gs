@@ -0,0 +1,38 @@
+#version 450 core
+
+// Renders each triangle into the cube faces of one point light in a single pass, one invocation per face.
+// shadow.vs runs with an identity lightSpace, so the inputs are in world space.
+layout (triangles, invocations = 6) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+uniform mat4 faceMatrices[6];
+// Layer of the +X face of this light in the cube map array
+uniform int firstLayer;
+// Faces that need to be re-rendered, set per mesh from its bounds
+uniform int faceMask;
+
+void main() {
+	int face = gl_InvocationID;
+	if ((faceMask & (1 << face)) == 0) {
+		return;
+	}
+
+	vec4 clip[3];
+	for (int i = 0; i < 3; i++) {
+		clip[i] = faceMatrices[face] * gl_in[i].gl_Position;
+	}
+	// Drop triangles entirely outside one of the face frustum planes
+	for (int axis = 0; axis < 3; axis++) {
+		if ((clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w) ||
+			(clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w)) {
+			return;
+		}
+	}
+
+	for (int i = 0; i < 3; i++) {
+		gl_Position = clip[i];
+		gl_Layer = firstLayer + face;
+		EmitVertex();
+	}
+	EndPrimitive();
+}
\ No newline at end of file
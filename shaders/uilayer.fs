@@ -0,0 +1,10 @@
+#version 450 core
+
+out vec4 outColor;
+
+// The cached GUI with premultiplied alpha, the same size as the framebuffer
+uniform sampler2D layer;
+
+void main() {
+	outColor = texelFetch(layer, ivec2(gl_FragCoord.xy), 0);
+}
\ No newline at end of file
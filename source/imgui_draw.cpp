@@ -46,6 +46,12 @@ Index of this file:
 #endif
 #endif
 
+// SSE2 builds the glyph quads of ASCII text in ImFont::RenderText(). It is part of every x64 CPU.
+#if !defined(IMGUI_DISABLE_SSE) && !defined(IMGUI_OVERRIDE_DRAWVERT_STRUCT_LAYOUT) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IMGUI_ENABLE_SSE_TEXT
+#include <emmintrin.h>
+#endif
+
 // Visual Studio warnings
 #ifdef _MSC_VER
 #pragma warning (disable: 4127) // condition expression is constant
@@ -373,6 +379,8 @@ void ImDrawList::Clear()
     _TextureIdStack.resize(0);
     _Path.resize(0);
     _Splitter.Clear();
+    _DeferredPrims.resize(0);
+    _DeferredPoints.resize(0);
 }
 
 void ImDrawList::ClearFreeMemory()
@@ -387,10 +395,13 @@ void ImDrawList::ClearFreeMemory()
     _TextureIdStack.clear();
     _Path.clear();
     _Splitter.ClearFreeMemory();
+    _DeferredPrims.clear();
+    _DeferredPoints.clear();
 }
 
 ImDrawList* ImDrawList::CloneOutput() const
 {
+    IM_ASSERT(_DeferredPrims.Size == 0 && "Call TessellateDeferred() before cloning the output");
     ImDrawList* dst = IM_NEW(ImDrawList(_Data));
     dst->CmdBuffer = CmdBuffer;
     dst->IdxBuffer = IdxBuffer;
@@ -589,13 +600,35 @@ void ImDrawList::PrimQuadUV(const ImVec2& a, const ImVec2& b, const ImVec2& c, c
 #define IM_NORMALIZE2F_OVER_ZERO(VX,VY)     { float d2 = VX*VX + VY*VY; if (d2 > 0.0f) { float inv_len = 1.0f / ImSqrt(d2); VX *= inv_len; VY *= inv_len; } }
 #define IM_FIXNORMAL2F(VX,VY)               { float d2 = VX*VX + VY*VY; if (d2 < 0.5f) d2 = 0.5f; float inv_lensq = 1.0f / d2; VX *= inv_lensq; VY *= inv_lensq; }
 
-// TODO: Thickness anti-aliased lines cap are missing their AA fringe.
-// We avoid using the ImVec2 math operators here to reduce cost to a minimum for debug/non-inlined builds.
 void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32 col, bool closed, float thickness)
 {
     if (points_count < 2)
         return;
 
+    const int count = closed ? points_count : points_count-1;
+    int idx_count, vtx_count;
+    if (Flags & ImDrawListFlags_AntiAliasedLines)
+    {
+        idx_count = thickness > 1.0f ? count*18 : count*12;
+        vtx_count = thickness > 1.0f ? points_count*4 : points_count*3;
+    }
+    else
+    {
+        idx_count = count*6;
+        vtx_count = count*4;
+    }
+    PrimReserve(idx_count, vtx_count);
+    if (Flags & ImDrawListFlags_DeferTessellation)
+        _DeferPrim(points, points_count, col, closed, thickness, idx_count, vtx_count);
+    else
+        _TessellatePolyline(points, points_count, col, closed, thickness);
+}
+
+// TODO: Thickness anti-aliased lines cap are missing their AA fringe.
+// We avoid using the ImVec2 math operators here to reduce cost to a minimum for debug/non-inlined builds.
+// Writes into space already reserved by AddPolyline().
+void ImDrawList::_TessellatePolyline(const ImVec2* points, const int points_count, ImU32 col, bool closed, float thickness)
+{
     const ImVec2 uv = _Data->TexUvWhitePixel;
 
     int count = points_count;
@@ -609,9 +642,7 @@ void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32
         const float AA_SIZE = 1.0f;
         const ImU32 col_trans = col & ~IM_COL32_A_MASK;
 
-        const int idx_count = thick_line ? count*18 : count*12;
         const int vtx_count = thick_line ? points_count*4 : points_count*3;
-        PrimReserve(idx_count, vtx_count);
 
         // Temporary buffer
         ImVec2* temp_normals = (ImVec2*)alloca(points_count * (thick_line ? 5 : 3) * sizeof(ImVec2)); //-V630
@@ -748,10 +779,7 @@ void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32
     else
     {
         // Non Anti-aliased Stroke
-        const int idx_count = count*6;
-        const int vtx_count = count*4;      // FIXME-OPT: Not sharing edges
-        PrimReserve(idx_count, vtx_count);
-
+        // FIXME-OPT: Not sharing edges
         for (int i1 = 0; i1 < count; i1++)
         {
             const int i2 = (i1+1) == points_count ? 0 : i1+1;
@@ -778,12 +806,24 @@ void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32
     }
 }
 
-// We intentionally avoid using ImVec2 and its math operators here to reduce cost to a minimum for debug/non-inlined builds.
 void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_count, ImU32 col)
 {
     if (points_count < 3)
         return;
 
+    const int idx_count = (Flags & ImDrawListFlags_AntiAliasedFill) ? (points_count-2)*3 + points_count*6 : (points_count-2)*3;
+    const int vtx_count = (Flags & ImDrawListFlags_AntiAliasedFill) ? points_count*2 : points_count;
+    PrimReserve(idx_count, vtx_count);
+    if (Flags & ImDrawListFlags_DeferTessellation)
+        _DeferPrim(points, points_count, col, true, -1.0f, idx_count, vtx_count);
+    else
+        _TessellateConvexPolyFilled(points, points_count, col);
+}
+
+// We intentionally avoid using ImVec2 and its math operators here to reduce cost to a minimum for debug/non-inlined builds.
+// Writes into space already reserved by AddConvexPolyFilled().
+void ImDrawList::_TessellateConvexPolyFilled(const ImVec2* points, const int points_count, ImU32 col)
+{
     const ImVec2 uv = _Data->TexUvWhitePixel;
 
     if (Flags & ImDrawListFlags_AntiAliasedFill)
@@ -791,9 +831,7 @@ void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_coun
         // Anti-aliased Fill
         const float AA_SIZE = 1.0f;
         const ImU32 col_trans = col & ~IM_COL32_A_MASK;
-        const int idx_count = (points_count-2)*3 + points_count*6;
         const int vtx_count = (points_count*2);
-        PrimReserve(idx_count, vtx_count);
 
         // Add indexes for fill
         unsigned int vtx_inner_idx = _VtxCurrentIdx;
@@ -843,9 +881,7 @@ void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_coun
     else
     {
         // Non Anti-aliased Fill
-        const int idx_count = (points_count-2)*3;
         const int vtx_count = points_count;
-        PrimReserve(idx_count, vtx_count);
         for (int i = 0; i < vtx_count; i++)
         {
             _VtxWritePtr[0].pos = points[i]; _VtxWritePtr[0].uv = uv; _VtxWritePtr[0].col = col;
@@ -860,6 +896,60 @@ void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_coun
     }
 }
 
+// Keeps what the tessellation needs and skips the space reserved for it, the caller already called PrimReserve()
+void ImDrawList::_DeferPrim(const ImVec2* points, int points_count, ImU32 col, bool closed, float thickness, int idx_count, int vtx_count)
+{
+    ImDrawDeferredPrim prim;
+    prim.PointsOffset = _DeferredPoints.Size;
+    prim.PointsCount = points_count;
+    prim.Col = col;
+    prim.Thickness = thickness;
+    prim.Closed = closed;
+    prim.Flags = Flags & ~ImDrawListFlags_DeferTessellation;
+    prim.VtxOffset = (int)(_VtxWritePtr - VtxBuffer.Data);
+    prim.IdxOffset = (int)(_IdxWritePtr - IdxBuffer.Data);
+    prim.VtxCurrentIdx = _VtxCurrentIdx;
+    _DeferredPrims.push_back(prim);
+    _DeferredPoints.resize(_DeferredPoints.Size + points_count);
+    memcpy(_DeferredPoints.Data + prim.PointsOffset, points, points_count * sizeof(ImVec2));
+
+    _VtxWritePtr += vtx_count;
+    _IdxWritePtr += idx_count;
+    _VtxCurrentIdx += vtx_count;
+}
+
+// Writes every deferred primitive in the space it reserved, the result is the same as without ImDrawListFlags_DeferTessellation.
+// Also called before anything that reads back or moves the buffers: the channels api and the ShadeVertsXXX functions.
+void ImDrawList::TessellateDeferred()
+{
+    if (_DeferredPrims.Size == 0)
+        return;
+
+    const ImDrawListFlags flags = Flags;
+    ImDrawVert* vtx_write_ptr = _VtxWritePtr;
+    ImDrawIdx* idx_write_ptr = _IdxWritePtr;
+    const unsigned int vtx_current_idx = _VtxCurrentIdx;
+    for (int n = 0; n < _DeferredPrims.Size; n++)
+    {
+        const ImDrawDeferredPrim& prim = _DeferredPrims[n];
+        Flags = prim.Flags;
+        _VtxWritePtr = VtxBuffer.Data + prim.VtxOffset;
+        _IdxWritePtr = IdxBuffer.Data + prim.IdxOffset;
+        _VtxCurrentIdx = prim.VtxCurrentIdx;
+        if (prim.Thickness < 0.0f)
+            _TessellateConvexPolyFilled(_DeferredPoints.Data + prim.PointsOffset, prim.PointsCount, prim.Col);
+        else
+            _TessellatePolyline(_DeferredPoints.Data + prim.PointsOffset, prim.PointsCount, prim.Col, prim.Closed, prim.Thickness);
+        IM_ASSERT(n + 1 == _DeferredPrims.Size || _VtxWritePtr <= VtxBuffer.Data + _DeferredPrims[n + 1].VtxOffset);
+    }
+    Flags = flags;
+    _VtxWritePtr = vtx_write_ptr;
+    _IdxWritePtr = idx_write_ptr;
+    _VtxCurrentIdx = vtx_current_idx;
+    _DeferredPrims.resize(0);
+    _DeferredPoints.resize(0);
+}
+
 void ImDrawList::PathArcToFast(const ImVec2& centre, float radius, int a_min_of_12, int a_max_of_12)
 {
     if (radius == 0.0f || a_min_of_12 > a_max_of_12)
@@ -1212,6 +1302,7 @@ void ImDrawListSplitter::ClearFreeMemory()
 
 void ImDrawListSplitter::Split(ImDrawList* draw_list, int channels_count)
 {
+    draw_list->TessellateDeferred();
     IM_ASSERT(_Current == 0 && _Count <= 1);
     int old_channels_count = _Channels.Size;
     if (old_channels_count < channels_count)
@@ -1304,6 +1395,7 @@ void ImDrawListSplitter::Merge(ImDrawList* draw_list)
 
 void ImDrawListSplitter::SetCurrentChannel(ImDrawList* draw_list, int idx)
 {
+    draw_list->TessellateDeferred();
     IM_ASSERT(idx < _Count);
     if (_Current == idx) 
         return;
@@ -1362,6 +1454,7 @@ void ImDrawData::ScaleClipRects(const ImVec2& fb_scale)
 // Generic linear color gradient, write to RGB fields, leave A untouched.
 void ImGui::ShadeVertsLinearColorGradientKeepAlpha(ImDrawList* draw_list, int vert_start_idx, int vert_end_idx, ImVec2 gradient_p0, ImVec2 gradient_p1, ImU32 col0, ImU32 col1)
 {
+    draw_list->TessellateDeferred();
     ImVec2 gradient_extent = gradient_p1 - gradient_p0;
     float gradient_inv_length2 = 1.0f / ImLengthSqr(gradient_extent);
     ImDrawVert* vert_start = draw_list->VtxBuffer.Data + vert_start_idx;
@@ -1380,6 +1473,7 @@ void ImGui::ShadeVertsLinearColorGradientKeepAlpha(ImDrawList* draw_list, int ve
 // Distribute UV over (a, b) rectangle
 void ImGui::ShadeVertsLinearUV(ImDrawList* draw_list, int vert_start_idx, int vert_end_idx, const ImVec2& a, const ImVec2& b, const ImVec2& uv_a, const ImVec2& uv_b, bool clamp)
 {
+    draw_list->TessellateDeferred();
     const ImVec2 size = b - a;
     const ImVec2 uv_size = uv_b - uv_a;
     const ImVec2 scale = ImVec2(
@@ -2814,6 +2908,14 @@ void ImFont::RenderChar(ImDrawList* draw_list, float size, ImVec2 pos, ImU32 col
     }
 }
 
+// Set to false to render all text through the general path, to compare the two
+static bool GImFontAsciiFastPath = true;
+
+void ImFontSetAsciiFastPath(bool enabled)
+{
+    GImFontAsciiFastPath = enabled;
+}
+
 void ImFont::RenderText(ImDrawList* draw_list, float size, ImVec2 pos, ImU32 col, const ImVec4& clip_rect, const char* text_begin, const char* text_end, float wrap_width, bool cpu_fine_clip) const
 {
     if (!text_end)
@@ -2869,8 +2971,77 @@ void ImFont::RenderText(ImDrawList* draw_list, float size, ImVec2 pos, ImU32 col
     ImDrawIdx* idx_write = draw_list->_IdxWritePtr;
     unsigned int vtx_current_idx = draw_list->_VtxCurrentIdx;
 
+    // Runs of printable ASCII skip UTF-8 decoding and the out-of-line FindGlyph(), and build their quads with SSE.
+    // The vertices are bit for bit the same as the general path's. Wrapped text and CPU fine clipping always take the general path.
+    const bool ascii_fast_path = GImFontAsciiFastPath && !word_wrap_enabled && !cpu_fine_clip;
+    // Once the pen is further right of the clip rectangle than any glyph reaches back, the rest of the run is clipped at once
+    const float ascii_clip_x_end = clip_rect.z + line_height;
+#ifdef IMGUI_ENABLE_SSE_TEXT
+    const __m128 ascii_scale = _mm_set1_ps(scale);
+    const __m128 ascii_clip_min = _mm_setr_ps(-FLT_MAX, -FLT_MAX, clip_rect.x, -FLT_MAX);
+    const __m128 ascii_clip_max = _mm_setr_ps(clip_rect.z, FLT_MAX, FLT_MAX, FLT_MAX);
+#endif
+
     while (s < text_end)
     {
+        if (ascii_fast_path && (unsigned int)((unsigned char)*s - 32) < 96)
+        {
+            const char* run_end = s + 1;
+            while (run_end < text_end && (unsigned int)((unsigned char)*run_end - 32) < 96)
+                run_end++;
+            for (; s < run_end; s++)
+            {
+                if (x > ascii_clip_x_end)
+                {
+                    s = run_end;
+                    break;
+                }
+                const unsigned int c = (unsigned char)*s;
+                const ImWchar glyph_index = ((int)c < IndexLookup.Size) ? IndexLookup.Data[c] : (ImWchar)-1;
+                const ImFontGlyph* glyph = (glyph_index != (ImWchar)-1) ? &Glyphs.Data[glyph_index] : FallbackGlyph;
+                if (!glyph)
+                    continue;
+                if (c != ' ')
+                {
+#ifdef IMGUI_ENABLE_SSE_TEXT
+                    // quad = (x1, y1, x2, y2), visible when x1 <= clip_rect.z && x2 >= clip_rect.x
+                    const __m128 quad = _mm_add_ps(_mm_setr_ps(x, y, x, y), _mm_mul_ps(_mm_loadu_ps(&glyph->X0), ascii_scale));
+                    const bool visible = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(quad, ascii_clip_min), _mm_cmple_ps(quad, ascii_clip_max))) == 0x0F;
+#else
+                    const float x1 = x + glyph->X0 * scale;
+                    const float x2 = x + glyph->X1 * scale;
+                    const bool visible = x1 <= clip_rect.z && x2 >= clip_rect.x;
+#endif
+                    if (visible)
+                    {
+                        idx_write[0] = (ImDrawIdx)(vtx_current_idx); idx_write[1] = (ImDrawIdx)(vtx_current_idx+1); idx_write[2] = (ImDrawIdx)(vtx_current_idx+2);
+                        idx_write[3] = (ImDrawIdx)(vtx_current_idx); idx_write[4] = (ImDrawIdx)(vtx_current_idx+2); idx_write[5] = (ImDrawIdx)(vtx_current_idx+3);
+#ifdef IMGUI_ENABLE_SSE_TEXT
+                        // Each vertex starts with pos and uv, shuffled together from the quad and the glyph's uv rectangle
+                        const __m128 uv = _mm_loadu_ps(&glyph->U0);
+                        _mm_storeu_ps(&vtx_write[0].pos.x, _mm_movelh_ps(quad, uv));                             // x1 y1 u1 v1
+                        _mm_storeu_ps(&vtx_write[1].pos.x, _mm_shuffle_ps(quad, uv, _MM_SHUFFLE(1, 2, 1, 2)));   // x2 y1 u2 v1
+                        _mm_storeu_ps(&vtx_write[2].pos.x, _mm_movehl_ps(uv, quad));                             // x2 y2 u2 v2
+                        _mm_storeu_ps(&vtx_write[3].pos.x, _mm_shuffle_ps(quad, uv, _MM_SHUFFLE(3, 0, 3, 0)));   // x1 y2 u1 v2
+#else
+                        const float y1 = y + glyph->Y0 * scale;
+                        const float y2 = y + glyph->Y1 * scale;
+                        vtx_write[0].pos.x = x1; vtx_write[0].pos.y = y1; vtx_write[0].uv.x = glyph->U0; vtx_write[0].uv.y = glyph->V0;
+                        vtx_write[1].pos.x = x2; vtx_write[1].pos.y = y1; vtx_write[1].uv.x = glyph->U1; vtx_write[1].uv.y = glyph->V0;
+                        vtx_write[2].pos.x = x2; vtx_write[2].pos.y = y2; vtx_write[2].uv.x = glyph->U1; vtx_write[2].uv.y = glyph->V1;
+                        vtx_write[3].pos.x = x1; vtx_write[3].pos.y = y2; vtx_write[3].uv.x = glyph->U0; vtx_write[3].uv.y = glyph->V1;
+#endif
+                        vtx_write[0].col = col; vtx_write[1].col = col; vtx_write[2].col = col; vtx_write[3].col = col;
+                        vtx_write += 4;
+                        vtx_current_idx += 4;
+                        idx_write += 6;
+                    }
+                }
+                x += glyph->AdvanceX * scale;
+            }
+            continue;
+        }
+
         if (word_wrap_enabled)
         {
             // Calculate how far we can render. Requires two passes on the string data but keeps the code simple and not intrusive for what's essentially an uncommon feature.
@@ -13,6 +13,7 @@
 
 // CHANGELOG
 // (minor and older changes stripped away, please see git history for details)
+//  2026-10-19: OpenGL: Desktop GL and ES 3 only: Font atlas uploaded as a single channel GL_R8 texture, swizzled to (1,1,1,a).
 //  2019-05-29: OpenGL: Desktop GL only: Added support for large mesh (64K+ vertices), enable ImGuiBackendFlags_RendererHasVtxOffset flag.
 //  2019-04-30: OpenGL: Added support for special ImDrawCallback_ResetRenderState callback to reset render state.
 //  2019-03-29: OpenGL: Not calling glBindBuffer more than necessary in the render loop.
@@ -92,6 +93,17 @@ static int          g_AttribLocationTex = 0, g_AttribLocationProjMtx = 0;
 static int          g_AttribLocationVtxPos = 0, g_AttribLocationVtxUV = 0, g_AttribLocationVtxColor = 0; // Vertex attributes location
 static unsigned int g_VboHandle = 0, g_ElementsHandle = 0;
 
+// Fast path data, see ImGui_ImplOpenGL3_SetFastPath()
+#define IMGUI_IMPL_OPENGL_RING_FRAMES 3
+static bool         g_FastPathEnabled = false;
+static ImGui_ImplOpenGL3_AppState g_AppState = { true, false, false, false };
+static GLuint       g_RingVao = 0, g_RingVbo = 0, g_RingEbo = 0;
+static int          g_RingVtxCapacity = 0, g_RingIdxCapacity = 0;      // Per frame, in vertices and indices
+static ImDrawVert*  g_RingVtxMapped = NULL;
+static ImDrawIdx*   g_RingIdxMapped = NULL;
+static GLsync       g_RingFences[IMGUI_IMPL_OPENGL_RING_FRAMES] = {};
+static int          g_RingFrame = 0;
+
 // Functions
 bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
 {
@@ -140,9 +152,10 @@ void    ImGui_ImplOpenGL3_NewFrame()
 static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_width, int fb_height, GLuint vertex_array_object)
 {
     // Setup render state: alpha-blending enabled, no face culling, no depth testing, scissor enabled, polygon fill
+    // Alpha is accumulated as coverage, so rendering into a cleared target gives a premultiplied layer that can be composited later
     glEnable(GL_BLEND);
     glBlendEquation(GL_FUNC_ADD);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_SCISSOR_TEST);
@@ -187,6 +200,177 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
     glVertexAttribPointer(g_AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
 }
 
+void    ImGui_ImplOpenGL3_SetFastPath(bool enabled, const ImGui_ImplOpenGL3_AppState& app_state)
+{
+    g_FastPathEnabled = enabled;
+    g_AppState = app_state;
+}
+
+static void ImGui_ImplOpenGL3_WaitRingFence(int frame)
+{
+    if (!g_RingFences[frame])
+        return;
+    // Normally signaled long ago, the GPU is at most a frame or two behind
+    while (glClientWaitSync(g_RingFences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(g_RingFences[frame]);
+    g_RingFences[frame] = 0;
+}
+
+static void ImGui_ImplOpenGL3_DestroyRing()
+{
+    for (int i = 0; i < IMGUI_IMPL_OPENGL_RING_FRAMES; i++)
+        ImGui_ImplOpenGL3_WaitRingFence(i);
+    if (g_RingVao) glDeleteVertexArrays(1, &g_RingVao);
+    if (g_RingVbo) glDeleteBuffers(1, &g_RingVbo);
+    if (g_RingEbo) glDeleteBuffers(1, &g_RingEbo);
+    g_RingVao = g_RingVbo = g_RingEbo = 0;
+    g_RingVtxCapacity = g_RingIdxCapacity = 0;
+    g_RingVtxMapped = NULL;
+    g_RingIdxMapped = NULL;
+}
+
+// (Re)creates the ring with room for at least the given counts per frame. The VAO is set up once here, with the
+// element buffer and the attribute layout, rendering only binds it.
+static void ImGui_ImplOpenGL3_CreateRing(int vtx_count, int idx_count)
+{
+    ImGui_ImplOpenGL3_DestroyRing();
+    g_RingVtxCapacity = 1 << 14;
+    while (g_RingVtxCapacity < vtx_count)
+        g_RingVtxCapacity *= 2;
+    g_RingIdxCapacity = 1 << 15;
+    while (g_RingIdxCapacity < idx_count)
+        g_RingIdxCapacity *= 2;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr vtx_size = (GLsizeiptr)g_RingVtxCapacity * IMGUI_IMPL_OPENGL_RING_FRAMES * sizeof(ImDrawVert);
+    const GLsizeiptr idx_size = (GLsizeiptr)g_RingIdxCapacity * IMGUI_IMPL_OPENGL_RING_FRAMES * sizeof(ImDrawIdx);
+    glGenVertexArrays(1, &g_RingVao);
+    glBindVertexArray(g_RingVao);
+    glGenBuffers(1, &g_RingVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, g_RingVbo);
+    glBufferStorage(GL_ARRAY_BUFFER, vtx_size, NULL, flags);
+    g_RingVtxMapped = (ImDrawVert*)glMapBufferRange(GL_ARRAY_BUFFER, 0, vtx_size, flags);
+    glGenBuffers(1, &g_RingEbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_RingEbo);
+    glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, idx_size, NULL, flags);
+    g_RingIdxMapped = (ImDrawIdx*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, idx_size, flags);
+    glEnableVertexAttribArray(g_AttribLocationVtxPos);
+    glEnableVertexAttribArray(g_AttribLocationVtxUV);
+    glEnableVertexAttribArray(g_AttribLocationVtxColor);
+    glVertexAttribPointer(g_AttribLocationVtxPos,   2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, pos));
+    glVertexAttribPointer(g_AttribLocationVtxUV,    2, GL_FLOAT,         GL_FALSE, sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, uv));
+    glVertexAttribPointer(g_AttribLocationVtxColor, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(ImDrawVert), (GLvoid*)IM_OFFSETOF(ImDrawVert, col));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static void ImGui_ImplOpenGL3_SetupFastRenderState(ImDrawData* draw_data, int fb_width, int fb_height)
+{
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    if (g_AppState.CullFace) glDisable(GL_CULL_FACE);
+    if (g_AppState.DepthTest) glDisable(GL_DEPTH_TEST);
+    glEnable(GL_SCISSOR_TEST);
+    glViewport(0, 0, (GLsizei)fb_width, (GLsizei)fb_height);
+    float L = draw_data->DisplayPos.x;
+    float R = draw_data->DisplayPos.x + draw_data->DisplaySize.x;
+    float T = draw_data->DisplayPos.y;
+    float B = draw_data->DisplayPos.y + draw_data->DisplaySize.y;
+    const float ortho_projection[4][4] =
+    {
+        { 2.0f/(R-L),   0.0f,         0.0f,   0.0f },
+        { 0.0f,         2.0f/(T-B),   0.0f,   0.0f },
+        { 0.0f,         0.0f,        -1.0f,   0.0f },
+        { (R+L)/(L-R),  (T+B)/(B-T),  0.0f,   1.0f },
+    };
+    glUseProgram(g_ShaderHandle);
+    glUniformMatrix4fv(g_AttribLocationProjMtx, 1, GL_FALSE, &ortho_projection[0][0]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(g_RingVao);
+}
+
+static void ImGui_ImplOpenGL3_RenderDrawDataFast(ImDrawData* draw_data, int fb_width, int fb_height)
+{
+    // Wait until the GPU is done with this frame's part of the ring, grow the ring if the frame doesn't fit
+    const int frame = g_RingFrame;
+    g_RingFrame = (g_RingFrame + 1) % IMGUI_IMPL_OPENGL_RING_FRAMES;
+    if (!g_RingVao || draw_data->TotalVtxCount > g_RingVtxCapacity || draw_data->TotalIdxCount > g_RingIdxCapacity)
+        ImGui_ImplOpenGL3_CreateRing(draw_data->TotalVtxCount, draw_data->TotalIdxCount);
+    ImGui_ImplOpenGL3_WaitRingFence(frame);
+    if (!g_RingVtxMapped || !g_RingIdxMapped)
+        return;
+
+    // Copy every command list back to back, one upload for the whole frame without any GL call
+    const int vtx_base = frame * g_RingVtxCapacity;
+    const int idx_base = frame * g_RingIdxCapacity;
+    int vtx_offset = 0, idx_offset = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        memcpy(g_RingVtxMapped + vtx_base + vtx_offset, cmd_list->VtxBuffer.Data, (size_t)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+        memcpy(g_RingIdxMapped + idx_base + idx_offset, cmd_list->IdxBuffer.Data, (size_t)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+        vtx_offset += cmd_list->VtxBuffer.Size;
+        idx_offset += cmd_list->IdxBuffer.Size;
+    }
+
+    ImGui_ImplOpenGL3_SetupFastRenderState(draw_data, fb_width, fb_height);
+    ImVec2 clip_off = draw_data->DisplayPos;
+    ImVec2 clip_scale = draw_data->FramebufferScale;
+    // Redundant texture binds and scissors are skipped
+    GLuint last_texture = (GLuint)-1;
+    ImVec4 last_clip_rect(-1.0f, -1.0f, -1.0f, -1.0f);
+    vtx_offset = idx_offset = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+        {
+            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+            if (pcmd->UserCallback != NULL)
+            {
+                if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
+                    ImGui_ImplOpenGL3_SetupFastRenderState(draw_data, fb_width, fb_height);
+                else
+                    pcmd->UserCallback(cmd_list, pcmd);
+                last_texture = (GLuint)-1;
+                last_clip_rect = ImVec4(-1.0f, -1.0f, -1.0f, -1.0f);
+                continue;
+            }
+            ImVec4 clip_rect;
+            clip_rect.x = (pcmd->ClipRect.x - clip_off.x) * clip_scale.x;
+            clip_rect.y = (pcmd->ClipRect.y - clip_off.y) * clip_scale.y;
+            clip_rect.z = (pcmd->ClipRect.z - clip_off.x) * clip_scale.x;
+            clip_rect.w = (pcmd->ClipRect.w - clip_off.y) * clip_scale.y;
+            if (clip_rect.x >= fb_width || clip_rect.y >= fb_height || clip_rect.z < 0.0f || clip_rect.w < 0.0f)
+                continue;
+            if (clip_rect.x != last_clip_rect.x || clip_rect.y != last_clip_rect.y || clip_rect.z != last_clip_rect.z || clip_rect.w != last_clip_rect.w)
+            {
+                glScissor((int)clip_rect.x, (int)(fb_height - clip_rect.w), (int)(clip_rect.z - clip_rect.x), (int)(clip_rect.w - clip_rect.y));
+                last_clip_rect = clip_rect;
+            }
+            GLuint texture = (GLuint)(intptr_t)pcmd->TextureId;
+            if (texture != last_texture)
+            {
+                glBindTexture(GL_TEXTURE_2D, texture);
+                last_texture = texture;
+            }
+            glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                (void*)(intptr_t)((idx_base + idx_offset + pcmd->IdxOffset) * sizeof(ImDrawIdx)), (GLint)(vtx_base + vtx_offset + pcmd->VtxOffset));
+        }
+        vtx_offset += cmd_list->VtxBuffer.Size;
+        idx_offset += cmd_list->IdxBuffer.Size;
+    }
+    g_RingFences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // Leave the state the application asked for
+    glBindVertexArray(0);
+    if (!g_AppState.Blend) glDisable(GL_BLEND);
+    if (g_AppState.CullFace) glEnable(GL_CULL_FACE);
+    if (g_AppState.DepthTest) glEnable(GL_DEPTH_TEST);
+    if (!g_AppState.ScissorTest) glDisable(GL_SCISSOR_TEST);
+}
+
 // OpenGL3 Render function.
 // (this used to be set in io.RenderDrawListsFn and called by ImGui::Render(), but you can now call this directly from your main loop)
 // Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly, in order to be able to run within any OpenGL engine that doesn't do so.
@@ -197,6 +381,13 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
     int fb_height = (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
     if (fb_width <= 0 || fb_height <= 0)
         return;
+#if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3)
+    if (g_FastPathEnabled && GLAD_GL_VERSION_4_4)
+    {
+        ImGui_ImplOpenGL3_RenderDrawDataFast(draw_data, fb_width, fb_height);
+        return;
+    }
+#endif
 
     // Backup GL state
     GLenum last_active_texture; glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&last_active_texture);
@@ -330,7 +521,11 @@ bool ImGui_ImplOpenGL3_CreateFontsTexture()
     ImGuiIO& io = ImGui::GetIO();
     unsigned char* pixels;
     int width, height;
+#if defined(IMGUI_IMPL_OPENGL_ES2)
     io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);   // Load as RGBA 32-bits (75% of the memory is wasted, but default font is so small) because it is more likely to be compatible with user's existing shaders. If your ImTextureId represent a higher-level concept than just a GL texture id, consider calling GetTexDataAsAlpha8() instead to save on GPU memory.
+#else
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);   // Load as a single channel, a quarter of the memory of RGBA 32-bits. The texture swizzle returns (1,1,1,a) so the shader is unchanged.
+#endif
 
     // Upload texture to graphics system
     GLint last_texture;
@@ -342,7 +537,17 @@ bool ImGui_ImplOpenGL3_CreateFontsTexture()
 #ifdef GL_UNPACK_ROW_LENGTH
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 #endif
+#if defined(IMGUI_IMPL_OPENGL_ES2)
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+#else
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ONE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // Rows of an odd width aren't 4 byte aligned
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+#endif
 
     // Store our identifier
     io.Fonts->TexID = (ImTextureID)(intptr_t)g_FontTexture;
@@ -582,6 +787,8 @@ bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
 
 void    ImGui_ImplOpenGL3_DestroyDeviceObjects()
 {
+    ImGui_ImplOpenGL3_DestroyRing();
+
     if (g_VboHandle) glDeleteBuffers(1, &g_VboHandle);
     if (g_ElementsHandle) glDeleteBuffers(1, &g_ElementsHandle);
     g_VboHandle = g_ElementsHandle = 0;
@@ -1,3 +1,5 @@
+// portable-file-dialogs.h includes windows.h, whose min and max macros break std::min and std::max
+#define NOMINMAX
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
@@ -10,6 +12,49 @@
 #include <ShaderProgram.h>
 #include <Model.h>
 #include <Light.h>
+#include <ShadowMaps.h>
+#include <Environment.h>
+#include <AmbientProbe.h>
+#include <Headless.h>
+#include <BatchRenderer.h>
+#include <Benchmarks.h>
+#include <FrameCapture.h>
+#include <Profiler.h>
+#include <RedrawScheduler.h>
+#include <UiLayer.h>
+#include <FontAtlasCache.h>
+#include <JobSystem.h>
+#include <FrameArena.h>
+#include <AllocationCounter.h>
+#include <SpscRing.h>
+#include <FramePacket.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <chrono>
+#include <cassert>
+#include <new>
+
+#ifndef NDEBUG
+// Every allocation is counted for the steady-state frame check in the main loop. The other forms
+// of new, arrays and nothrow, end up here.
+void* operator new(size_t size) {
+	AllocationCounter::add();
+	if (void* memory = malloc(size > 0 ? size : 1)) {
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, size_t size) noexcept {
+	free(memory);
+}
+#endif
 
 
 // Application constants
@@ -25,6 +70,24 @@ float rotatingAngle = 5.0f; // degrees, set to preference
 float translationalOffset = 0.25f; // unitless, set to preference
 float scaleFactor = 0.05f;
 bool sensitivitesModWinOpen = false;
+//	Whether newly opened models should use the compact vertex format
+bool compactVertices = false;
+//	Whether big meshes are culled per meshlet with a compute shader (needs OpenGL 4.3)
+bool meshletCulling = true;
+//	Whether the lights cast shadows
+bool shadowsEnabled = true;
+//	Whether frames are only drawn when something changed, instead of continuously
+bool renderOnDemand = true;
+//	Whether the GUI is drawn through the persistent-mapped, state-query-free path (needs OpenGL 4.4)
+bool fastUiRenderer = true;
+//	Whether the GUI is drawn into a cached layer that is only redrawn when it changes
+bool cacheUiLayer = true;
+//	Whether the GUI windows' lines and fills are tessellated on worker threads after the widgets are built
+bool parallelUiTessellation = false;
+//	Profiler overlay window handle
+bool profilerWinOpen = false;
+//	Share of the scene lights that comes back as diffuse fill light
+float ambientFillStrength = 0.02f;
 //	Texture handles and names of uniform sampler2Ds
 unsigned int textureHandles[5];
 std::string textureNames[] = {
@@ -131,55 +194,113 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 	}
 }
 
-// Helper function to create textures from filepaths
-unsigned int createTexture(const char* texturePath) {
-	unsigned int textureID;
+// Pixels of a texture file, decoded without a GL context
+struct TextureImage {
+	unsigned char* data;
 	int width, height, nrChannels;
+};
+
+TextureImage loadTextureImage(const char* texturePath) {
+	TextureImage image;
+	image.data = stbi_load(texturePath, &image.width, &image.height, &image.nrChannels, 0);
+	return image;
+}
+
+// Helper function to create textures from decoded images, frees the pixels
+unsigned int createTexture(TextureImage image) {
+	unsigned int textureID;
 	glGenTextures(1, &textureID);
 	glBindTexture(GL_TEXTURE_2D, textureID);
-	unsigned char* data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
-	if (data) {
+	if (image.data) {
 		GLenum format;
-		if (nrChannels == 3) format = GL_RGB;
-		else if (nrChannels == 4) format = GL_RGBA;
-		else if (nrChannels == 1) format = GL_RED;
+		if (image.nrChannels == 3) format = GL_RGB;
+		else if (image.nrChannels == 4) format = GL_RGBA;
+		else if (image.nrChannels == 1) format = GL_RED;
 		else {
-			std::cout << "# channels: " << nrChannels << std::endl;
+			std::cout << "# channels: " << image.nrChannels << std::endl;
 		}
 
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 	}
 	else {
 		std::cout << "Failed to load texture" << std::endl;
 	}
-	stbi_image_free(data);
+	stbi_image_free(image.data);
 	return textureID;
 }
 
+// Helper function to create textures from filepaths
+unsigned int createTexture(const char* texturePath) {
+	return createTexture(loadTextureImage(texturePath));
+}
+
 
 // Main program
-int main() {
+int main(int argc, char** argv) {
+	// Render farms and CI machines have no GPU, they render on the CPU without a window
+	if (argc > 1 && strcmp(argv[1], "--render") == 0) {
+		return renderHeadless(argc, argv);
+	}
+	if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+		return renderBatch(argc, argv);
+	}
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+		return runBenchmark(argc, argv);
+	}
+
 	// Initialize GLFW and GLAD
 	glfwInit();
 	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Loading Model...", NULL, NULL);
 	glfwMakeContextCurrent(window);
 	glfwMaximizeWindow(window);
 	glfwSetKeyCallback(window, keyCallback);
+	// Wakes the loop up on input, installed before Dear ImGUI's callbacks which chain to it
+	RedrawScheduler redrawScheduler;
+	redrawScheduler.attach(window);
 	gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
 	// Initialize Dear ImGUI with the provided OpenGL bindings.
 	IMGUI_CHECKVERSION();
+	// Growth of ImGui's buffers shows up in the per frame allocation count
+	ImGui::SetAllocatorFunctions(AllocationCounter::imguiAlloc, AllocationCounter::imguiFree);
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO();
-	io.FontGlobalScale *= 1.8f;
+	// The font is baked at the size it's shown at, 1.8 times the default on a standard DPI monitor,
+	// instead of magnifying the 13 pixel atlas
+	float contentScale = 1.0f, contentScaleY = 1.0f;
+	glfwGetWindowContentScale(window, &contentScale, &contentScaleY);
+	ImFontConfig fontConfig;
+	fontConfig.SizePixels = std::floor(13.0f * 1.8f * contentScale);
+	fontConfig.OversampleH = fontConfig.OversampleV = 1;
+	fontConfig.PixelSnapH = true;
+	io.Fonts->AddFontDefault(&fontConfig);
+	FontAtlasCache::build(io.Fonts, "imgui_fonts.cache");
 	ImGui::StyleColorsDark();
+	ImGui::GetStyle().ScaleAllSizes(contentScale);
 	ImGui_ImplGlfw_InitForOpenGL(window, true);
 	ImGui_ImplOpenGL3_Init();
+	// State the rest of the frame expects after the GUI, so the renderer doesn't have to query and restore it
+	ImGui_ImplOpenGL3_AppState uiAppState = ImGui_ImplOpenGL3_AppState{ true, false, false, false };
+	UiLayer* uiLayer = new UiLayer(uiAppState);
+	// Strings and scratch arrays that are only needed until the end of the frame
+	FrameArena frameArena(64 * 1024);
 
 
 	// Load shaders
 	ShaderProgram mainSP = ShaderProgram("shaders/main.vs", "shaders/main.fs");
 	mainSP.use();
+	// Meshlet culling needs compute shaders and storage buffers from OpenGL 4.3
+	ShaderProgram* cullSP = NULL;
+	if (GLAD_GL_VERSION_4_3) {
+		cullSP = new ShaderProgram("shaders/cull.cs");
+		mainSP.use();
+	}
+	ShadowMaps shadowMaps = ShadowMaps();
+	AmbientProbe ambientProbe = AmbientProbe();
+	mainSP.use();
+	// Deleted before the context, it still reads back frames in flight
+	FrameCapture* frameCapture = new FrameCapture();
+	Profiler* profiler = new Profiler();
 
 
 	// View and projection matrices and camera position
@@ -195,6 +316,7 @@ int main() {
 		100.0f
 	);
 	glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 10.0f);
+	Camera camera = Camera{ viewMatrix, projectionMatrix, cameraPosition, (float)SCR_HEIGHT };
 	// These three never change, so they're set outside the main loop
 	mainSP.setUniformMat4("view", viewMatrix);
 	mainSP.setUniformMat4("projection", projectionMatrix);
@@ -204,38 +326,234 @@ int main() {
 	// Default startup values
 	//	Lighting: one point light, directional light and spotlight
 	std::vector<PointLight> pointLights;
-	pointLights.push_back(PointLight{
-		glm::vec3(-10.0f, 10.0f, 10.0f),
-		glm::vec3(100.0f, 100.0f, 100.0f)
-	});
-	DirectionalLight dirLight = DirectionalLight{
-		glm::vec3(-10.0f, -10.0f, 0.0f),
-		glm::vec3(100.0f, 50.0f, 31.0f)
-	};
+	DirectionalLight dirLight;
 	std::vector<SpotLight> spotlights;
-	spotlights.push_back(SpotLight{
-		glm::vec3(0.0f, 0.0f, 10.0f),
-		glm::vec3(0.0f, 0.0f, -1.0f),
-		glm::cos(glm::radians(10.0f)),
-		glm::cos(glm::radians(20.0f)),
-		glm::vec3(100.0f, 50.0f, 31.0f)
-	});
+	createDefaultLights(pointLights, dirLight, spotlights);
 	//	Load default  model and textures
 	Model model = Model("assets/crate.3ds");
-	textureHandles[0] = createTexture("assets/stone/stone-albedo.png");
-	textureHandles[1] = createTexture("assets/stone/stone-normal.png");
-	textureHandles[2] = createTexture("assets/stone/stone-metalness.png");
-	textureHandles[3] = createTexture("assets/stone/stone-rough.png");
-	textureHandles[4] = createTexture("assets/stone/stone-ao.png");
+	const char* texturePaths[] = {
+		"assets/stone/stone-albedo.png",
+		"assets/stone/stone-normal.png",
+		"assets/stone/stone-metalness.png",
+		"assets/stone/stone-rough.png",
+		"assets/stone/stone-ao.png"
+	};
+	//	The PNGs are decoded in parallel, only the upload needs this thread
+	TextureImage textureImages[5];
+	JobSystem::shared().parallelFor(5, 1, [&](size_t i) {
+		textureImages[i] = loadTextureImage(texturePaths[i]);
+	});
+	for (int i = 0; i < 5; i++) {
+		textureHandles[i] = createTexture(textureImages[i]);
+	}
+	//	No environment until one is chosen, ambient light is then a constant
+	Environment* environment = NULL;
 
 
-	// Main render loop
+	// From here on the render thread owns the GL context and this thread builds the GUI, handing
+	// every frame over in a packet. The GUI renderer's device objects are created while the
+	// context is still current here.
+	ImGui_ImplOpenGL3_NewFrame();
 	glEnable(GL_DEPTH_TEST);
+	// One packet is drawn while this thread fills the other, so the threads overlap by a frame
+	SpscRing<FramePacket, 2> packets;
+	// Only for sleeping, the ring itself has no locks. quit is guarded by the mutex.
+	std::mutex packetsMutex;
+	std::condition_variable packetsChanged;
+	bool quit = false;
+	// Taking the lock before notifying makes sure a thread that just found nothing to do is waiting
+	auto wake = [&]() {
+		{
+			std::lock_guard<std::mutex> lock(packetsMutex);
+		}
+		packetsChanged.notify_all();
+	};
+	glfwMakeContextCurrent(NULL);
+
+
+	// Render thread
+	std::thread renderThread([&]() {
+		glfwMakeContextCurrent(window);
+		// Uniform names and other scratch of the render thread's frames
+		FrameArena renderArena(64 * 1024);
+		FramePacket* packet = NULL;
+		unsigned int lastGeometryVersion = model.geometryVersion;
+#ifndef NDEBUG
+		unsigned long long lastDrawnHashes[2] = { 0, 0 };
+#endif
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(packetsMutex);
+				// Sleeps until a newer packet arrives, unless the current one is redrawn continuously
+				packetsChanged.wait(lock, [&]() {
+					return quit || packets.readable() > (packet ? 1u : 0u) || (packet && packet->continuous);
+				});
+				if (quit) {
+					break;
+				}
+			}
+			// The current packet is kept until a newer one is there, then handed back to be refilled
+			bool fresh = false;
+			if (packets.readable() > (packet ? 1u : 0u)) {
+				if (packet) {
+					packets.pop();
+					wake();
+				}
+				packet = packets.front();
+				fresh = true;
+			}
+#ifndef NDEBUG
+			unsigned long long frameAllocations = AllocationCounter::get();
+#endif
+			profiler->beginFrame();
+			profiler->beginScope("Clear", true);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			profiler->endScope();
+			// GL work the UI thread asked for, e.g. texture uploads, only the first time a packet is drawn
+			bool ranCommands = fresh && !packet->commands.empty();
+			if (ranCommands) {
+				profiler->beginScope("Commands");
+				for (size_t i = 0; i < packet->commands.size(); i++) {
+					packet->commands[i]();
+				}
+				profiler->endScope();
+			}
+
+
+			// LODs are picked for the window's actual size
+			camera.viewportHeight = (float)packet->framebufferHeight;
+
+
+			// Render the shadow maps whose light or geometry changed
+			profiler->beginScope("Shadows", true);
+			if (packet->shadowsEnabled) {
+				shadowMaps.update(model, packet->modelMatrix, packet->pointLights, packet->dirLight, packet->spotlights, camera);
+			}
+			profiler->endScope();
+
+
+			// Set vertex shader uniforms
+			profiler->beginScope("Uniforms");
+			mainSP.use();
+			mainSP.setUniformMat4("model", packet->modelMatrix);
+			mainSP.setUniformMat3("inverseModel", glm::mat3(glm::transpose(glm::inverse(packet->modelMatrix))));
+			// Set fragment shader uniforms
+			//	Set textures
+			for (int i = 0; i < 5; i++) {
+				mainSP.setUniformInt(textureNames[i].c_str(), i);
+				glActiveTexture(GL_TEXTURE0 + i);
+				glBindTexture(GL_TEXTURE_2D, textureHandles[i]);
+			}
+			//	Set shadow maps
+			shadowMaps.bind(mainSP, packet->shadowsEnabled);
+			//	Set the ambient probe, it is only re-projected for lights that changed
+			ambientProbe.update(packet->pointLights, packet->dirLight, packet->spotlights, glm::vec3(model.getBoundingSphere(packet->modelMatrix)), packet->ambientFillStrength);
+			ambientProbe.bind();
+			//	Set image-based lighting
+			if (environment) {
+				environment->bind(mainSP);
+			}
+			else {
+				mainSP.setUniformInt("environmentEnabled", 0);
+			}
+			//	Set point lights and number of them
+			mainSP.setUniformInt("numPointLights", packet->pointLights.size());
+			for (int i = 0; i < packet->pointLights.size(); i++) {
+				mainSP.setUniformVec3(renderArena.format("pointLights[%d].position", i), packet->pointLights[i].position);
+				mainSP.setUniformVec3(renderArena.format("pointLights[%d].color", i), packet->pointLights[i].color);
+				mainSP.setUniformFloat(renderArena.format("pointLights[%d].attConstant", i), packet->pointLights[i].attConstant);
+				mainSP.setUniformFloat(renderArena.format("pointLights[%d].attLinear", i), packet->pointLights[i].attLinear);
+				mainSP.setUniformFloat(renderArena.format("pointLights[%d].attQuadratic", i), packet->pointLights[i].attQuadratic);
+			}
+			//	Set directional light
+			mainSP.setUniformVec3("dirLight.direction", packet->dirLight.direction);
+			mainSP.setUniformVec3("dirLight.color", packet->dirLight.color);
+			//	Set spotlights and number of them
+			mainSP.setUniformInt("numSpotLights", packet->spotlights.size());
+			for (int i = 0; i < packet->spotlights.size(); i++) {
+				mainSP.setUniformVec3(renderArena.format("spotLights[%d].position", i), packet->spotlights[i].position);
+				mainSP.setUniformVec3(renderArena.format("spotLights[%d].direction", i), packet->spotlights[i].direction);
+				mainSP.setUniformFloat(renderArena.format("spotLights[%d].cosineInnerCutoff", i), packet->spotlights[i].cosineInnerCutoff);
+				mainSP.setUniformFloat(renderArena.format("spotLights[%d].cosineOuterCutoff", i), packet->spotlights[i].cosineOuterCutoff);
+				mainSP.setUniformVec3(renderArena.format("spotLights[%d].color", i), packet->spotlights[i].color);
+			}
+
+
+			profiler->endScope();
+
+
+			// Draw model
+			profiler->beginScope("Draw model", true);
+			model.draw(mainSP, packet->modelMatrix, camera, packet->meshletCulling ? cullSP : NULL);
+			profiler->endScope();
+			//	Captures leave out the GUI
+			profiler->beginScope("Capture");
+			frameCapture->endFrame(0, packet->framebufferWidth, packet->framebufferHeight);
+			profiler->endScope();
+
+
+			profiler->beginScope("Render UI", true);
+			ImGui_ImplOpenGL3_SetFastPath(packet->fastUiRenderer, uiAppState);
+			if (packet->cacheUiLayer) {
+				uiLayer->update(&packet->drawData);
+				uiLayer->composite();
+			}
+			else {
+				ImGui_ImplOpenGL3_RenderDrawData(&packet->drawData);
+			}
+			profiler->endScope();
+			profiler->beginScope("Swap");
+			glfwSwapBuffers(window);
+			profiler->endScope();
+			profiler->endFrame();
+			// The UI thread may be asleep, frames that have to follow this one are asked for here
+			if (model.geometryVersion != lastGeometryVersion || frameCapture->isBusy()) {
+				lastGeometryVersion = model.geometryVersion;
+				redrawScheduler.requestFrames(1);
+			}
+#ifndef NDEBUG
+			// A frame that drew the same GUI as the two before it did nothing new, so it mustn't touch
+			// the heap. Commands, captures and traces allocate as they go.
+			bool steadyFrame = !ranCommands && packet->uiHash == lastDrawnHashes[0] && packet->uiHash == lastDrawnHashes[1] && !frameCapture->isBusy() && !profiler->isTracing();
+			assert((!steadyFrame || AllocationCounter::get() == frameAllocations) && "A steady-state frame allocated, see AllocationCounter.h");
+			lastDrawnHashes[1] = lastDrawnHashes[0];
+			lastDrawnHashes[0] = packet->uiHash;
+#endif
+			renderArena.reset();
+		}
+		// Packets published before quitting weren't drawn, their commands still run, since some
+		// of them own what they upload, e.g. a loaded model
+		while (packets.readable() > (packet ? 1u : 0u)) {
+			if (packet) {
+				packets.pop();
+			}
+			packet = packets.front();
+			for (size_t i = 0; i < packet->commands.size(); i++) {
+				packet->commands[i]();
+			}
+		}
+		glfwMakeContextCurrent(NULL);
+	});
+
+
+	// Main loop, builds the GUI and handles input
+#ifndef NDEBUG
+	unsigned long long lastUiHashes[2] = { 0, 0 };
+#endif
+	// GL work for the render thread, collected while the GUI is built
+	std::vector<std::function<void()>> commands;
+	// What the menus need to know of the render thread's objects
+	bool environmentLoaded = false;
+	bool recording = false;
 	while (!glfwWindowShouldClose(window)) {
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		ImGui_ImplOpenGL3_NewFrame();
+#ifndef NDEBUG
+		unsigned long long frameAllocations = AllocationCounter::get();
+#endif
+		std::chrono::steady_clock::time_point uiStart = std::chrono::steady_clock::now();
 		ImGui_ImplGlfw_NewFrame();
+		// Set once per frame, the menu item may change parallelUiTessellation half way through it
+		io.ConfigDeferTessellation = parallelUiTessellation;
 		ImGui::NewFrame();
 
 
@@ -246,28 +564,60 @@ int main() {
 			}
 			if (ImGui::Button("Open Model")) {
 				pfd::open_file f = pfd::open_file("Select your file: ");
-				model = Model(f.result()[0].c_str());
+				// Loaded here, only the upload waits for the render thread
+				Model* loaded = new Model(f.result()[0].c_str(), compactVertices, false);
+				commands.push_back([&model, &shadowMaps, loaded] {
+					loaded->setupMeshes();
+					model = std::move(*loaded);
+					delete loaded;
+					shadowMaps.invalidate();
+				});
 			}
 			if (ImGui::BeginMenu("Textures")) {				
 				if (ImGui::Button("Choose Albedo Map")) {
 					pfd::open_file f = pfd::open_file("Select albedo map");
-					textureHandles[0] = createTexture(f.result()[0].c_str());
+					TextureImage image = loadTextureImage(f.result()[0].c_str());
+					commands.push_back([image] { textureHandles[0] = createTexture(image); });
 				}
 				if (ImGui::Button("Choose Normal Map")) {
 					pfd::open_file f = pfd::open_file("Select normal map");
-					textureHandles[1] = createTexture(f.result()[0].c_str());
+					TextureImage image = loadTextureImage(f.result()[0].c_str());
+					commands.push_back([image] { textureHandles[1] = createTexture(image); });
 				}
 				if (ImGui::Button("Choose Metallic Map")) {
 					pfd::open_file f = pfd::open_file("Select metallic map");
-					textureHandles[2] = createTexture(f.result()[0].c_str());
+					TextureImage image = loadTextureImage(f.result()[0].c_str());
+					commands.push_back([image] { textureHandles[2] = createTexture(image); });
 				}
 				if (ImGui::Button("Choose Roughness Map")) {
 					pfd::open_file f = pfd::open_file("Select roughness map");
-					textureHandles[3] = createTexture(f.result()[0].c_str());
+					TextureImage image = loadTextureImage(f.result()[0].c_str());
+					commands.push_back([image] { textureHandles[3] = createTexture(image); });
 				}
 				if (ImGui::Button("Choose AO Map")) {
 					pfd::open_file f = pfd::open_file("Select AO map");
-					textureHandles[4] = createTexture(f.result()[0].c_str());
+					TextureImage image = loadTextureImage(f.result()[0].c_str());
+					commands.push_back([image] { textureHandles[4] = createTexture(image); });
+				}
+				ImGui::EndMenu();
+			}
+			if (ImGui::BeginMenu("Environment")) {
+				if (ImGui::Button("Choose HDR Environment")) {
+					pfd::open_file f = pfd::open_file("Select equirectangular HDR image");
+					Environment* loaded = new Environment(f.result()[0].c_str());
+					commands.push_back([&environment, loaded] {
+						delete environment;
+						environment = loaded;
+						environment->setupTextures();
+					});
+					environmentLoaded = true;
+				}
+				if (environmentLoaded && ImGui::Button("Remove Environment")) {
+					commands.push_back([&environment] {
+						delete environment;
+						environment = NULL;
+					});
+					environmentLoaded = false;
 				}
 				ImGui::EndMenu();
 			}
@@ -278,13 +628,11 @@ int main() {
 							pointLightCreateWinOpen = true;
 						}
 					}
-					ImGui::Text((std::to_string(pointLights.size()) + "/16").c_str());
+					ImGui::Text("%d/16", (int)pointLights.size());
 					ImGui::Separator();
 
 					for (int i = 0; i < pointLights.size(); i++) {
-						std::string temp = "Point Light ";
-						temp += std::to_string(i + 1);
-						if (ImGui::MenuItem(temp.c_str())) {
+						if (ImGui::MenuItem(frameArena.format("Point Light %d", i + 1))) {
 							// Sets these global variables so that they can be modified
 							pointLightModWinOpen = true;
 							pointLightToMod = &pointLights[i];
@@ -295,19 +643,18 @@ int main() {
 				if (ImGui::MenuItem("Directional Light")) {
 					dirLightModWinOpen = true;
 				}
+				ImGui::InputFloat("Ambient fill", &ambientFillStrength);
 				if (ImGui::BeginMenu("Spotlights")) {
 					if (spotlights.size() <= 16) {
 						if (ImGui::Button("Add Spotlight")) {
 							spotlightCreateWinOpen = true;
 						}
 					}					
-					ImGui::Text((std::to_string(spotlights.size()) + "/16").c_str());
+					ImGui::Text("%d/16", (int)spotlights.size());
 					ImGui::Separator();
 
 					for (int i = 0; i < spotlights.size(); i++) {
-						std::string temp = "Spotlight ";
-						temp += std::to_string(i + 1);
-						if (ImGui::MenuItem(temp.c_str())) {
+						if (ImGui::MenuItem(frameArena.format("Spotlight %d", i + 1))) {
 							// Sets these global variables so that they can be modified
 							spotlightModWinOpen = true;
 							spotlightToMod = &spotlights[i];
@@ -317,10 +664,50 @@ int main() {
 				}
 				ImGui::EndMenu();
 			}
+			if (ImGui::BeginMenu("Capture")) {
+				if (ImGui::Button("Screenshot")) {
+					pfd::save_file f = pfd::save_file("Save screenshot", "screenshot.png", { "PNG Files", "*.png" });
+					if (!f.result().empty()) {
+						std::string path = f.result();
+						commands.push_back([frameCapture, path] { frameCapture->requestScreenshot(path); });
+					}
+				}
+				if (!recording && ImGui::Button("Start Recording")) {
+					pfd::select_folder f = pfd::select_folder("Select folder for the frames");
+					if (!f.result().empty()) {
+						std::string directory = f.result();
+						commands.push_back([frameCapture, directory] { frameCapture->startRecording(directory); });
+						recording = true;
+					}
+				}
+				else if (recording && ImGui::Button("Stop Recording")) {
+					commands.push_back([frameCapture] { frameCapture->stopRecording(); });
+					recording = false;
+				}
+				ImGui::EndMenu();
+			}
 			if (ImGui::BeginMenu("Settings")) {
 				if (ImGui::MenuItem("Control Sensitivities")) {
 					sensitivitesModWinOpen = true;
 				}
+				// Applies to the next model that is opened
+				ImGui::MenuItem("Compact Vertex Format", NULL, &compactVertices);
+				ImGui::MenuItem("GPU Cluster Culling", NULL, &meshletCulling, cullSP != NULL);
+				ImGui::MenuItem("Shadows", NULL, &shadowsEnabled);
+				ImGui::MenuItem("Render On Demand", NULL, &renderOnDemand);
+				ImGui::MenuItem("Fast GUI Renderer", NULL, &fastUiRenderer, GLAD_GL_VERSION_4_4 != 0);
+				ImGui::MenuItem("Cache GUI Layer", NULL, &cacheUiLayer);
+				ImGui::MenuItem("Parallel GUI Tessellation", NULL, &parallelUiTessellation);
+				ImGui::MenuItem("Profiler", NULL, &profilerWinOpen);
+				if (!profiler->isTracing() && ImGui::Button("Start Chrome Trace")) {
+					pfd::save_file f = pfd::save_file("Save trace", "trace.json", { "JSON Files", "*.json" });
+					if (!f.result().empty()) {
+						profiler->startTrace(f.result());
+					}
+				}
+				else if (profiler->isTracing() && ImGui::Button("Stop Chrome Trace")) {
+					profiler->stopTrace();
+				}
 				ImGui::EndMenu();
 			}
 			ImGui::EndMainMenuBar();
@@ -491,55 +878,98 @@ int main() {
 			ImGui::InputFloat("Zoom speed", &scaleFactor);
 			ImGui::End();
 		}
-
-
-		// Set vertex shader uniforms
-		mainSP.use();
-		mainSP.setUniformMat4("model", modelMatrix);
-		mainSP.setUniformMat3("inverseModel", glm::mat3(glm::transpose(glm::inverse(modelMatrix))));
-		// Set fragment shader uniforms
-		//	Set textures
-		for (int i = 0; i < 5; i++) {
-			mainSP.setUniformInt(textureNames[i].c_str(), i);
-			glActiveTexture(GL_TEXTURE0 + i);
-			glBindTexture(GL_TEXTURE_2D, textureHandles[i]);
-		}
-		//	Set point lights and number of them
-		mainSP.setUniformInt("numPointLights", pointLights.size());
-		for (int i = 0; i < pointLights.size(); i++) {
-			std::string temp = "pointLights[";
-			temp += std::to_string(i) + "]";
-			mainSP.setUniformVec3((temp + ".position").c_str(), pointLights[i].position);
-			mainSP.setUniformVec3((temp + ".color").c_str(), pointLights[i].color);
-			mainSP.setUniformFloat((temp + ".attConstant").c_str(), pointLights[i].attConstant);
-			mainSP.setUniformFloat((temp + ".attLinear").c_str(), pointLights[i].attLinear);
-			mainSP.setUniformFloat((temp + ".attQuadratic").c_str(), pointLights[i].attQuadratic);
-		}
-		//	Set directional light
-		mainSP.setUniformVec3("dirLight.direction", dirLight.direction);
-		mainSP.setUniformVec3("dirLight.color", dirLight.color);
-		//	Set spotlights and number of them
-		mainSP.setUniformInt("numSpotLights", spotlights.size());
-		for (int i = 0; i < spotlights.size(); i++) {
-			std::string temp = "spotLights[";
-			temp += std::to_string(i) + "]";
-			mainSP.setUniformVec3((temp + ".position").c_str(), spotlights[i].position);
-			mainSP.setUniformVec3((temp + ".direction").c_str(), spotlights[i].direction);
-			mainSP.setUniformFloat((temp + ".cosineInnerCutoff").c_str(), spotlights[i].cosineInnerCutoff);
-			mainSP.setUniformFloat((temp + ".cosineOuterCutoff").c_str(), spotlights[i].cosineOuterCutoff);
-			mainSP.setUniformVec3((temp + ".color").c_str(), spotlights[i].color);
+		//	Keep the profiler overlay open
+		if (profilerWinOpen) {
+			profiler->drawOverlay(&profilerWinOpen);
 		}
 
 
-		// Draw model
-		model.draw();
+		ImGui::Render();
+		ImDrawData* uiDrawData = ImGui::GetDrawData();
+		if (io.ConfigDeferTessellation) {
+			// Every window's list only reserved space for its lines and fills, they're written now, each
+			// list by one thread. The lists stay in the order Render() put them in.
+			JobSystem::shared().parallelFor(uiDrawData->CmdListsCount, 1, [&](size_t i) {
+				uiDrawData->CmdLists[i]->TessellateDeferred();
+			});
+		}
+		profiler->addCpuSample("Build UI", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uiStart).count());
 
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// Publish the frame, waiting while the render thread holds both packets
+		{
+			std::unique_lock<std::mutex> lock(packetsMutex);
+			packetsChanged.wait(lock, [&]() {
+				return packets.writable();
+			});
+		}
+		FramePacket* packet = packets.beginWrite();
+		packet->modelMatrix = modelMatrix;
+		packet->pointLights = pointLights;
+		packet->dirLight = dirLight;
+		packet->spotlights = spotlights;
+		packet->ambientFillStrength = ambientFillStrength;
+		packet->shadowsEnabled = shadowsEnabled;
+		packet->meshletCulling = meshletCulling;
+		packet->fastUiRenderer = fastUiRenderer;
+		packet->cacheUiLayer = cacheUiLayer;
+		packet->continuous = !renderOnDemand;
+		glfwGetFramebufferSize(window, &packet->framebufferWidth, &packet->framebufferHeight);
+		// The packet's previous commands already ran, their vector is reused for the next frame's
+#ifndef NDEBUG
+		bool sentCommands = !commands.empty();
+#endif
+		packet->commands.swap(commands);
+		commands.clear();
+		packet->copyDrawData(uiDrawData);
+#ifndef NDEBUG
+		unsigned long long uiHash = UiLayer::hashDrawData(uiDrawData);
+		packet->uiHash = uiHash;
+#endif
+		packets.endWrite();
+		wake();
 		glfwPollEvents();
-		glfwSwapBuffers(window);
+#ifndef NDEBUG
+		// Same check as on the render thread, for building the GUI and filling the packet
+		bool steadyFrame = !sentCommands && uiHash == lastUiHashes[0] && uiHash == lastUiHashes[1] && !profiler->isTracing();
+		assert((!steadyFrame || AllocationCounter::get() == frameAllocations) && "A steady-state frame allocated, see AllocationCounter.h");
+		lastUiHashes[1] = lastUiHashes[0];
+		lastUiHashes[0] = uiHash;
+#endif
+		frameArena.reset();
+
+
+		// Sleep until input arrives or something that affects the image changes. The render thread
+		// asks for the frames that only it knows are needed, e.g. while capturing.
+		if (renderOnDemand) {
+			redrawScheduler.hashState(modelMatrix);
+			redrawScheduler.hashState(pointLights);
+			redrawScheduler.hashState(dirLight);
+			redrawScheduler.hashState(spotlights);
+			redrawScheduler.hashState(shadowsEnabled);
+			redrawScheduler.hashState(meshletCulling);
+			redrawScheduler.hashState(ambientFillStrength);
+			// Keeps the text cursor blinking while a field is edited
+			redrawScheduler.waitForNextFrame(window, ImGui::GetIO().WantTextInput ? 0.4 : 0.0);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(packetsMutex);
+		quit = true;
 	}
+	packetsChanged.notify_all();
+	renderThread.join();
+	glfwMakeContextCurrent(window);
+	// And the ones collected in the last frame, which was never sent
+	for (size_t i = 0; i < commands.size(); i++) {
+		commands[i]();
+	}
+
+	delete cullSP;
+	delete environment;
+	delete frameCapture;
+	delete profiler;
+	delete uiLayer;
 
 	// Terminate Dear ImGUI and GLFW
 	ImGui_ImplOpenGL3_Shutdown();